@@ -0,0 +1,111 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author : Hyoukjun Kwon (hyoukjun@gatech.edu)
+Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
+
+*******************************************************************************/
+
+
+/*
+  Checks the maeri_compiler_api library against the command line compiler:
+  Compile() on the job that maeri_compiler ran in OutputDir must give the
+  packed words of its RN_Config.vmh, outputBuffValid.vmh and Layer_Info.vmh.
+  Non-uniform jobs read OutputDir/non_uniform_VN_sizes.txt, as the CLI does.
+  Usage: compiler_api_check NumMultSwitches VNSize VNNum NonUniform LayerFile OutputDir
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "compiler_api.hpp"
+#include "config_image.hpp"
+#include "vn_placement.hpp"
+#include "parser.hpp"
+
+using namespace MAERI;
+
+static bool ReadFile(const std::string& filename, std::string& text) {
+  std::ifstream file(filename);
+  if(!file.is_open()) {
+    std::cerr << "ERROR: Failed to open " << filename << std::endl;
+    return false;
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  text = contents.str();
+  return true;
+}
+
+template <typename Word>
+static int CountMismatches(std::string what, const std::vector<Word>& api, const std::vector<uint32_t>& cli) {
+  int num_mismatches = 0;
+  if(api.size() != cli.size()) {
+    std::cout << "MISMATCH: " << what << ": " << api.size() << " words from Compile(), " << cli.size() << " in the file" << std::endl;
+    return 1;
+  }
+  for(size_t idx = 0; idx < api.size(); idx++) {
+    if(static_cast<uint32_t>(api[idx]) != cli[idx]) {
+      std::cout << "MISMATCH: " << what << " word " << idx << ": " << static_cast<uint32_t>(api[idx]) << " from Compile(), " << cli[idx] << " in the file" << std::endl;
+      num_mismatches++;
+    }
+  }
+  return num_mismatches;
+}
+
+int main(int argc, char** argv) {
+  if(argc != 7) {
+    std::cerr << "Usage: compiler_api_check NumMultSwitches VNSize VNNum NonUniform LayerFile OutputDir" << std::endl;
+    return 1;
+  }
+  int num_mult_switches = std::stoi(argv[1]);
+  bool non_uniform = std::stoi(argv[4]) != 0;
+  std::string dir = argv[6];
+
+  Driver::VNLayout layout = non_uniform?
+                            Driver::VNLayout(ReductionNetwork::VNPlacement::ReadVNSizes(dir + "/non_uniform_VN_sizes.txt")) :
+                            Driver::VNLayout(std::stoi(argv[2]), std::stoi(argv[3]));
+  maestro::LayerParser layerParser(argv[5]);
+  auto result = Driver::Compile(Driver::AcceleratorParams(num_mult_switches), layout, layerParser.ParseLayer());
+  if(!result.success_) {
+    std::cout << "MISMATCH: Compile() failed on a job the CLI compiled" << std::endl;
+    return 1;
+  }
+
+  std::string text;
+  std::vector<uint32_t> rn_config, output_buff_valid, tile_info;
+  if(!ReadFile(dir + "/RN_Config.vmh", text) || !MachineCodeGenerator::VmhCodec::ParseRNConfig(text, "RN_Config.vmh", rn_config)
+     || !ReadFile(dir + "/outputBuffValid.vmh", text) || !MachineCodeGenerator::VmhCodec::ParseOutputBuffValid(text, "outputBuffValid.vmh", output_buff_valid)
+     || !ReadFile(dir + "/Layer_Info.vmh", text) || !MachineCodeGenerator::VmhCodec::ParseTileInfo(text, "Layer_Info.vmh", tile_info)) {
+    return 1;
+  }
+  // Compile() leaves out the @000 address line
+  if(!rn_config.empty()) {
+    rn_config.erase(rn_config.begin());
+  }
+
+  int num_mismatches = CountMismatches("RN_Config.vmh", result.rn_config_words_, rn_config)
+                       + CountMismatches("outputBuffValid.vmh", result.output_buff_valid_, output_buff_valid)
+                       + CountMismatches("Layer_Info.vmh", result.tile_info_words_, tile_info);
+  std::cout << rn_config.size() << " RN config words, " << output_buff_valid.size() << " outputBuffValid IDs, "
+            << tile_info.size() << " tile info words: " << num_mismatches << " mismatches" << std::endl;
+  return (num_mismatches == 0)? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author : Hyoukjun Kwon (hyoukjun@gatech.edu)
+Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
+
+*******************************************************************************/
+
+
+/*
+  Checks IncrementalRNConfigCompiler against a full recompilation: after
+  every random VN edit that places, the RN_Config.vmh words and the
+  outputBuffValid.vmh lines must equal those of ClosedFormRNConfigGenerator
+  on the edited layout, and GetChangedWords() must list every word that
+  differs from the previous configuration.
+  Usage: incremental_rn_config_check [NumEdits] [Seed]
+*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "vn_placement.hpp"
+#include "closed_form_rn_config.hpp"
+#include "incremental_rn_config.hpp"
+#include "vmh_writer.hpp"
+
+using namespace MAERI::ReductionNetwork;
+
+// PlaceNonUniform reports every rejected layout on stderr
+class MuteErrors {
+  protected:
+    std::ostringstream sink_;
+    std::streambuf* saved_;
+
+  public:
+    MuteErrors() : saved_(std::cerr.rdbuf(sink_.rdbuf())) {
+    }
+
+    ~MuteErrors() {
+      std::cerr.rdbuf(saved_);
+    }
+}; // End of class MuteErrors
+
+static std::vector<uint32_t> GetWords(const RNConfig& rnConfig) {
+  MAERI::MachineCodeGenerator::RNConfigEncoder encoder;
+  std::vector<uint32_t> words;
+  for(int word = 0; word < encoder.GetNumRNConfigWords(rnConfig); word++) {
+    words.push_back(encoder.GetRNConfigWordBits(rnConfig, word));
+  }
+  return words;
+}
+
+static void PrintCase(std::string what, int num_mult_switches, const std::vector<int>& vn_sizes) {
+  std::cout << "MISMATCH: " << what << " on " << num_mult_switches << " multiplier switches, VN sizes";
+  for(auto size : vn_sizes) {
+    std::cout << " " << size;
+  }
+  std::cout << std::endl;
+}
+
+static const int mult_switch_nums[] = {8, 9, 12, 16, 24, 32, 48, 64, 100, 128, 200, 256, 1000, 1024};
+
+// A random edit: mostly resizes, with removals and appends to change the number of VNs
+static std::vector<VNSizeChange> GetRandomDelta(std::mt19937& rng, int num_vns) {
+  std::vector<VNSizeChange> delta;
+  int num_changes = 1 + rng() % 3;
+  for(int change = 0; change < num_changes; change++) {
+    int kind = rng() % 4;
+    if(kind == 0 || num_vns == 0) {
+      delta.push_back(VNSizeChange(num_vns, 1 + rng() % 9));
+      num_vns++;
+    }
+    else if(kind == 1 && num_vns > 1) {
+      delta.push_back(VNSizeChange(rng() % num_vns, 0));
+      num_vns--;
+    }
+    else {
+      delta.push_back(VNSizeChange(rng() % num_vns, 1 + rng() % 9));
+    }
+  }
+  return delta;
+}
+
+// Returns the number of edits whose incremental result differs from a full recompilation
+static int CheckArray(std::mt19937& rng, int num_mult_switches, int num_edits, int& num_applied) {
+  MuteErrors mute;
+  IncrementalRNConfigCompiler compiler(num_mult_switches);
+
+  // A random layout that reaches the right edge, where the in-order IDs of a truncated tree differ from the compact ones
+  std::vector<int> vn_sizes;
+  for(int total = 0; total < num_mult_switches - 4; total += vn_sizes.back()) {
+    vn_sizes.push_back(1 + rng() % 9);
+  }
+  while(!vn_sizes.empty() && !compiler.Compile(vn_sizes)) {
+    vn_sizes.pop_back();
+  }
+  if(vn_sizes.empty()) {
+    return 0;
+  }
+
+  int num_mismatches = 0;
+  for(int edit = 0; edit < num_edits; edit++) {
+    auto old_words = GetWords(compiler.GetRNConfig());
+    auto old_output_buff_valid = compiler.GetRNConfig().output_buff_valid_;
+    if(!compiler.ApplyDelta(GetRandomDelta(rng, static_cast<int>(compiler.GetVNSizes().size())))) {
+      continue;
+    }
+    num_applied++;
+
+    auto& vn_sizes = compiler.GetVNSizes();
+    ClosedFormRNConfigGenerator generator(num_mult_switches);
+    auto full = generator.Generate(VNPlacement::PlaceNonUniform(num_mult_switches, vn_sizes));
+    auto words = GetWords(compiler.GetRNConfig());
+    auto full_words = GetWords(full);
+
+    if(words != full_words) {
+      PrintCase("RN_Config.vmh words differ from a full recompilation", num_mult_switches, vn_sizes);
+      num_mismatches++;
+    }
+    else if(compiler.GetRNConfig().output_buff_valid_ != full.output_buff_valid_) {
+      PrintCase("outputBuffValid.vmh differs from a full recompilation", num_mult_switches, vn_sizes);
+      num_mismatches++;
+    }
+    else {
+      auto& changed_words = compiler.GetChangedWords();
+      for(int word = 0; word < static_cast<int>(words.size()); word++) {
+        if(words[word] != old_words[word] && std::find(changed_words.begin(), changed_words.end(), word) == changed_words.end()) {
+          PrintCase("word " + std::to_string(word) + " changed but is not listed", num_mult_switches, vn_sizes);
+          num_mismatches++;
+          break;
+        }
+      }
+      if(full.output_buff_valid_ != old_output_buff_valid && !compiler.OutputBuffValidChanged()) {
+        PrintCase("outputBuffValid.vmh changed but is not flagged", num_mult_switches, vn_sizes);
+        num_mismatches++;
+      }
+    }
+
+    if(num_mismatches > 0) {
+      break;
+    }
+  }
+  return num_mismatches;
+}
+
+int main(int argc, char** argv) {
+  int num_edits = (argc > 1)? std::stoi(argv[1]) : 2000;
+  unsigned seed = (argc > 2)? std::stoul(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  int num_mismatches = 0;
+  for(auto num_mult_switches : mult_switch_nums) {
+    int num_applied = 0;
+    int num_array_mismatches = CheckArray(rng, num_mult_switches, num_edits, num_applied);
+    std::cout << num_mult_switches << " multiplier switches: " << num_applied << " of " << num_edits << " edits applied, "
+              << num_array_mismatches << " mismatches" << std::endl;
+    num_mismatches += num_array_mismatches;
+  }
+
+  return (num_mismatches == 0)? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author : Hyoukjun Kwon (hyoukjun@gatech.edu)
+Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
+
+*******************************************************************************/
+
+#define MAERI_INSTALL_ALLOCATION_COUNTER
+#include "allocation_counter.hpp"
+
+/*
+  Checks VNPlacementOptimizer against VNPlacement::PlaceNonUniform:
+  - the NextIndex transitions accept exactly the random VN orders that
+    PlaceNonUniform accepts, with the same active and first idle leaves;
+  - on small multisets, the optimizer's plan places validly and covers as
+    many leaves as the best subset and order found by brute force;
+  - on large multisets, past the exact search's state cap, the beam search
+    plan places validly and covers at least as many leaves as the input order.
+  Usage: vn_placement_check [NumOrders] [NumMultisets] [Seed]
+*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "vn_placement.hpp"
+#include "vn_placement_optimizer.hpp"
+
+using namespace MAERI::ReductionNetwork;
+
+// PlaceNonUniform reports every rejected order on stderr
+class MuteErrors {
+  protected:
+    std::ostringstream sink_;
+    std::streambuf* saved_;
+
+  public:
+    MuteErrors() : saved_(std::cerr.rdbuf(sink_.rdbuf())) {
+    }
+
+    ~MuteErrors() {
+      std::cerr.rdbuf(saved_);
+    }
+}; // End of class MuteErrors
+
+static int GetNumAssigned(const LeafAssignment& leaves) {
+  int num_assigned = 0;
+  for(int leaf = 0; leaf < leaves.GetNumLeaves(); leaf++) {
+    if(leaves.IsAssigned(leaf)) {
+      num_assigned++;
+    }
+  }
+  return num_assigned;
+}
+
+static LeafAssignment Place(int num_mult_switches, const std::vector<int>& vn_sizes) {
+  MuteErrors mute;
+  return VNPlacement::PlaceNonUniform(num_mult_switches, vn_sizes);
+}
+
+static void PrintCase(std::string what, int num_mult_switches, const std::vector<int>& vn_sizes) {
+  std::cout << "MISMATCH: " << what << " on " << num_mult_switches << " multiplier switches, VN sizes";
+  for(auto size : vn_sizes) {
+    std::cout << " " << size;
+  }
+  std::cout << std::endl;
+}
+
+static const int mult_switch_nums[] = {4, 8, 12, 16, 24, 32, 48, 64, 100, 128};
+
+// Returns the number of orders whose transitions disagree with PlaceNonUniform
+static int CheckTransitions(std::mt19937& rng, int num_orders, int& num_valid) {
+  int num_mismatches = 0;
+  for(int order = 0; order < num_orders; order++) {
+    int num_mult_switches = mult_switch_nums[rng() % (sizeof(mult_switch_nums) / sizeof(int))];
+    int max_size = (rng() % 2)? 3 : 9;
+    std::vector<int> vn_sizes(1 + rng() % 12);
+    for(auto& size : vn_sizes) {
+      size = 1 + rng() % max_size;
+    }
+
+    auto leaves = Place(num_mult_switches, vn_sizes);
+    VNPlacementOptimizer optimizer(num_mult_switches);
+    int num_active = optimizer.GetNumActive(vn_sizes);
+
+    int index = 0;
+    for(auto size : vn_sizes) {
+      index = (index == -1)? -1 : VNPlacementOptimizer::NextIndex(num_mult_switches, index, size);
+    }
+
+    if(leaves.valid_) {
+      num_valid++;
+    }
+    if(leaves.valid_ != (num_active > 0)) {
+      PrintCase(leaves.valid_? "transitions reject a valid order" : "transitions accept an invalid order", num_mult_switches, vn_sizes);
+      num_mismatches++;
+    }
+    else if(leaves.valid_ && (num_active != GetNumAssigned(leaves) || index != leaves.idle_start_)) {
+      PrintCase("active or first idle leaf differs", num_mult_switches, vn_sizes);
+      num_mismatches++;
+    }
+  }
+  return num_mismatches;
+}
+
+// Returns the number of multisets whose plan is invalid or not optimal
+static int CheckOptimality(std::mt19937& rng, int num_multisets, int& num_inexact) {
+  int num_mismatches = 0;
+  for(int multiset = 0; multiset < num_multisets; multiset++) {
+    int num_mult_switches = 8 << (rng() % 3);
+    std::vector<int> vn_sizes(1 + rng() % 7);
+    for(auto& size : vn_sizes) {
+      size = 1 + rng() % 6;
+    }
+
+    VNPlacementOptimizer optimizer(num_mult_switches);
+    auto plan = optimizer.Optimize(vn_sizes);
+    if(!plan.exact_) {
+      num_inexact++;
+    }
+    if(!plan.vn_sizes_.empty()) {
+      auto leaves = Place(num_mult_switches, plan.vn_sizes_);
+      if(!leaves.valid_ || GetNumAssigned(leaves) != plan.num_active_) {
+        PrintCase("the plan does not place as planned", num_mult_switches, vn_sizes);
+        num_mismatches++;
+        continue;
+      }
+    }
+
+    // Every subset in every order, placed by PlaceNonUniform itself
+    int best = 0;
+    int num_vns = static_cast<int>(vn_sizes.size());
+    for(int mask = 1; mask < (1 << num_vns); mask++) {
+      std::vector<int> subset;
+      for(int vn_id = 0; vn_id < num_vns; vn_id++) {
+        if(mask & (1 << vn_id)) {
+          subset.push_back(vn_sizes[vn_id]);
+        }
+      }
+      std::sort(subset.begin(), subset.end());
+      do {
+        auto leaves = Place(num_mult_switches, subset);
+        if(leaves.valid_) {
+          best = std::max(best, GetNumAssigned(leaves));
+        }
+      } while(std::next_permutation(subset.begin(), subset.end()));
+    }
+
+    if(best != plan.num_active_) {
+      PrintCase("the plan covers " + std::to_string(plan.num_active_) + " leaves instead of " + std::to_string(best), num_mult_switches, vn_sizes);
+      num_mismatches++;
+    }
+  }
+  return num_mismatches;
+}
+
+static const int large_mult_switch_nums[] = {1000, 4096, 16384, 65536};
+
+// Returns the number of large multisets whose beam search plan is invalid or worse than the input order
+static int CheckBeamSearch(std::mt19937& rng, int& num_inexact) {
+  int num_mismatches = 0;
+  for(auto num_mult_switches : large_mult_switch_nums) {
+    // Nine distinct sizes with dozens of VNs each have far more than 1 << 16 (counts, index) states
+    std::vector<int> vn_sizes;
+    int total = 0;
+    while(total < num_mult_switches * 3 / 4) {
+      vn_sizes.push_back(1 + rng() % 9);
+      total += vn_sizes.back();
+    }
+
+    VNPlacementOptimizer optimizer(num_mult_switches);
+    auto plan = optimizer.Optimize(vn_sizes);
+    if(!plan.exact_) {
+      num_inexact++;
+    }
+    else {
+      std::cout << "MISMATCH: " << vn_sizes.size() << " VNs on " << num_mult_switches << " multiplier switches did not reach the beam search" << std::endl;
+      num_mismatches++;
+    }
+
+    auto leaves = Place(num_mult_switches, plan.vn_sizes_);
+    int input_active = optimizer.GetNumActive(vn_sizes);
+    if(plan.vn_sizes_.empty() || !leaves.valid_ || GetNumAssigned(leaves) != plan.num_active_) {
+      std::cout << "MISMATCH: the beam search plan for " << vn_sizes.size() << " VNs on " << num_mult_switches << " multiplier switches does not place as planned" << std::endl;
+      num_mismatches++;
+    }
+    else if(plan.num_active_ < input_active) {
+      std::cout << "MISMATCH: the beam search plan on " << num_mult_switches << " multiplier switches covers " << plan.num_active_ << " leaves, the input order " << input_active << std::endl;
+      num_mismatches++;
+    }
+  }
+  return num_mismatches;
+}
+
+int main(int argc, char** argv) {
+  int num_orders = (argc > 1)? std::stoi(argv[1]) : 200000;
+  int num_multisets = (argc > 2)? std::stoi(argv[2]) : 3000;
+  unsigned seed = (argc > 3)? std::stoul(argv[3]) : 1;
+  std::mt19937 rng(seed);
+
+  int num_valid = 0;
+  int num_transition_mismatches = CheckTransitions(rng, num_orders, num_valid);
+  std::cout << "Transitions: " << num_orders << " orders (" << num_valid << " valid), " << num_transition_mismatches << " mismatches" << std::endl;
+
+  int num_inexact = 0;
+  int num_plan_mismatches = CheckOptimality(rng, num_multisets, num_inexact);
+  std::cout << "Optimizer: " << num_multisets << " multisets (" << num_inexact << " beam searched), " << num_plan_mismatches << " mismatches" << std::endl;
+
+  int num_large_inexact = 0;
+  int num_beam_mismatches = CheckBeamSearch(rng, num_large_inexact);
+  int num_large = sizeof(large_mult_switch_nums) / sizeof(int);
+  std::cout << "Beam search: " << num_large << " large multisets (" << num_large_inexact << " beam searched), " << num_beam_mismatches << " mismatches" << std::endl;
+
+  return (num_transition_mismatches == 0 && num_plan_mismatches == 0 && num_beam_mismatches == 0)? 0 : 1;
+}
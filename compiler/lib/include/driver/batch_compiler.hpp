@@ -0,0 +1,149 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DRIVER_BATCH_COMPILER_H_
+#define DRIVER_BATCH_COMPILER_H_
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+
+#include "compile_job.hpp"
+#include "rn_config_cache.hpp"
+
+namespace MAERI {
+  namespace Driver {
+
+    /*
+      Compiles the jobs of a manifest on a pool of worker threads.
+      Manifest lines (blank lines and lines starting with # are skipped):
+        NumMultSwitches VNSize VNNum NonUniform LayerFile OutputDir [VNSizesFile]
+      VNSizesFile defaults to OutputDir/non_uniform_VN_sizes.txt. Output
+      directories must be distinct; workers share nothing but the index of
+      the next job to take and the optional RN config cache.
+    */
+    class BatchCompiler {
+      protected:
+        std::vector<CompileJob> jobs_;
+        std::vector<char> succeeded_;   // One slot per job, written only by the worker that ran it
+
+      public:
+        bool ReadManifest(std::string filename) {
+          std::ifstream manifest(filename);
+          if(!manifest) {
+            std::cerr << "ERROR: Failed to open the manifest " << filename << std::endl;
+            return false;
+          }
+
+          std::set<std::string> output_dirs;
+          std::string line;
+          int line_num = 0;
+          while(std::getline(manifest, line)) {
+            line_num++;
+            std::istringstream fields(line);
+            std::string first;
+            if(!(fields >> first) || first[0] == '#') {
+              continue;
+            }
+
+            int vn_size, vn_num, non_uniform;
+            std::string layer_file, output_dir, vn_sizes_file;
+            if(!(fields >> vn_size >> vn_num >> non_uniform >> layer_file >> output_dir)) {
+              std::cerr << "ERROR: " << filename << ":" << line_num << ": expected NumMultSwitches VNSize VNNum NonUniform LayerFile OutputDir [VNSizesFile]" << std::endl;
+              return false;
+            }
+            fields >> vn_sizes_file;
+
+            if(!output_dirs.insert(output_dir).second) {
+              std::cerr << "ERROR: " << filename << ":" << line_num << ": output directory " << output_dir << " is used by another job" << std::endl;
+              return false;
+            }
+
+            jobs_.emplace_back(std::atoi(first.c_str()), vn_size, vn_num, non_uniform != 0, layer_file, output_dir, vn_sizes_file);
+          }
+
+          return true;
+        }
+
+        void AddJob(const CompileJob& job) {
+          jobs_.push_back(job);
+        }
+
+        int GetNumJobs() {
+          return static_cast<int>(jobs_.size());
+        }
+
+        // Returns the number of failed jobs
+        int Run(RNGenerator generator, int num_threads, std::shared_ptr<RNConfigCache> cache = nullptr, bool optimize_placement = false, bool compress_rn_config = false) {
+          CompileJobRunner runner(generator, false, cache, optimize_placement, compress_rn_config);
+          succeeded_.assign(jobs_.size(), 0);
+
+          std::atomic<int> next_job(0);
+          auto worker = [&]() {
+            for(int idx = next_job++; idx < GetNumJobs(); idx = next_job++) {
+              auto& job = jobs_[idx];
+              std::error_code ec;
+              std::filesystem::create_directories(job.output_dir_, ec);
+              if(ec) {
+                std::cerr << "ERROR: Failed to create output directory " << job.output_dir_ << ": " << ec.message() << std::endl;
+                continue;
+              }
+              succeeded_[idx] = runner.Run(job);
+            }
+          };
+
+          num_threads = std::max(1, std::min(num_threads, GetNumJobs()));
+          std::vector<std::thread> workers;
+          for(int tid = 0; tid < num_threads; tid++) {
+            workers.emplace_back(worker);
+          }
+          for(auto& thread : workers) {
+            thread.join();
+          }
+
+          int num_failed = 0;
+          for(int idx = 0; idx < GetNumJobs(); idx++) {
+            if(!succeeded_[idx]) {
+              std::cerr << "ERROR: Job " << idx << " (" << jobs_[idx].ToString() << ") failed" << std::endl;
+              num_failed++;
+            }
+          }
+          return num_failed;
+        }
+
+    }; // End of class BatchCompiler
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
+
+#endif
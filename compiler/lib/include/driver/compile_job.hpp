@@ -0,0 +1,348 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DRIVER_COMPILE_JOB_H_
+#define DRIVER_COMPILE_JOB_H_
+
+#include <iostream>
+#include <string>
+#include <memory>
+
+#include "abstract_reduction_network.hpp"
+#include "closed_form_rn_config.hpp"
+#include "switch_config.hpp"
+#include "vn_placement.hpp"
+#include "vn_placement_optimizer.hpp"
+#include "analysis-structure.hpp"
+#include "parser.hpp"
+#include "vmh_writer.hpp"
+#include "allocation_counter.hpp"
+#include "rn_config_cache.hpp"
+
+namespace MAERI {
+  namespace Driver {
+
+    enum class RNGenerator {Simulation, ClosedForm, Check};
+
+    // Returns false if the name is not one of simulation, closed-form, check
+    inline bool ParseRNGenerator(std::string name, RNGenerator& generator) {
+      if(name == "simulation") {
+        generator = RNGenerator::Simulation;
+      }
+      else if(name == "closed-form") {
+        generator = RNGenerator::ClosedForm;
+      }
+      else if(name == "check") {
+        generator = RNGenerator::Check;
+      }
+      else {
+        return false;
+      }
+      return true;
+    }
+
+    // Reports the first switch whose configuration differs; returns true if both are identical
+    inline bool CompareRNConfig(const ReductionNetwork::RNConfig& simulated, const ReductionNetwork::RNConfig& closed_form) {
+      if(simulated.switches_.size() != closed_form.switches_.size()) {
+        std::cerr << "ERROR: RN config length mismatch (simulation: " << simulated.switches_.size() << ", closed-form: " << closed_form.switches_.size() << ")" << std::endl;
+        return false;
+      }
+
+      for(size_t idx = 0; idx < simulated.switches_.size(); idx++) {
+        if(simulated.switches_[idx] != closed_form.switches_[idx]) {
+          std::cerr << "ERROR: RN config mismatch at traversal position " << idx << std::endl;
+          return false;
+        }
+      }
+
+      if(simulated.output_buff_valid_ != closed_form.output_buff_valid_) {
+        std::cerr << "ERROR: outputBuffValid mismatch" << std::endl;
+        return false;
+      }
+
+      return true;
+    }
+
+    /*
+      Compiles the RN configuration of a leaf assignment with the selected
+      generator. Check mode runs both generators and returns the simulated
+      configuration only if the closed-form one matches it. With
+      count_allocations, the heap allocations of the generator are printed.
+    */
+    inline bool GenerateRNConfig(RNGenerator generator, int numMultSwitches, const ReductionNetwork::LeafAssignment& leaves, ReductionNetwork::RNConfig& rn_config, bool verbose = false,
+                                 bool count_allocations = false) {
+      if(generator == RNGenerator::ClosedForm) {
+        ReductionNetwork::ClosedFormRNConfigGenerator closed_form(numMultSwitches);
+
+        long num_allocations_before = Util::AllocationCounter::GetCount();
+        rn_config = closed_form.Generate(leaves);
+        if(count_allocations) {
+          std::cout << "Heap allocations during reduction network compile: " << Util::AllocationCounter::GetCount() - num_allocations_before << std::endl;
+        }
+        return true;
+      }
+
+      // The VN sizes only matter to the leaf placement, which is given
+      ReductionNetwork::AbstractReductionNetwork ars(numMultSwitches, 1, 1, false);
+
+      long num_allocations_before = Util::AllocationCounter::GetCount();
+      ars.ProcessAbstractReductionNetwork(leaves);
+      if(count_allocations) {
+        std::cout << "Heap allocations during reduction network compile: " << Util::AllocationCounter::GetCount() - num_allocations_before << std::endl;
+      }
+      if(verbose) {
+        //ars.PrintConfig();
+        ars.PrintConfig_Inorder();
+      }
+
+      rn_config = ars.GetRNConfig();
+
+      if(generator == RNGenerator::Check) {
+        ReductionNetwork::ClosedFormRNConfigGenerator closed_form(numMultSwitches);
+        if(!CompareRNConfig(rn_config, closed_form.Generate(leaves))) {
+          return false;
+        }
+        if(verbose) {
+          std::cout << "RN config check passed: closed-form output matches simulation" << std::endl;
+        }
+      }
+      return true;
+    }
+
+    // Returns false, with an error, if the layer lacks one of the loops Layer_Info.vmh encodes; a null layer failed to parse and was reported already
+    inline bool CheckLayerLoops(std::shared_ptr<maestro::LoopInfoTable> layerInfo, std::string layer_name) {
+      if(layerInfo == nullptr) {
+        return false;
+      }
+      for(auto loop_var : {"K", "C", "R", "S", "Y", "X"}) {
+        if(layerInfo->FindLoops(loop_var)->empty()) {
+          std::cerr << "ERROR: Layer " << layer_name << " does not describe loop " << loop_var << std::endl;
+          return false;
+        }
+      }
+      return true;
+    }
+
+    /*
+      One (NumMultSwitches, VNSize, VNNum, NonUniform, layer) compilation.
+      Every file the job reads or writes is named here, so jobs that use
+      different output directories never touch each other's files.
+    */
+    class CompileJob {
+      public:
+        int num_mult_switches_;
+        int vn_size_;
+        int vn_num_;
+        bool non_uniform_;
+        std::string layer_file_;
+        std::string output_dir_;
+        std::string vn_sizes_file_;
+
+        CompileJob(int numMultSwitches, int vn_size, int vn_num, bool non_uniform, std::string layer_file, std::string output_dir = ".", std::string vn_sizes_file = "") :
+          num_mult_switches_(numMultSwitches),
+          vn_size_(vn_size),
+          vn_num_(vn_num),
+          non_uniform_(non_uniform),
+          layer_file_(layer_file),
+          output_dir_(output_dir),
+          vn_sizes_file_(vn_sizes_file) {
+          if(vn_sizes_file_ == "") {
+            vn_sizes_file_ = GetOutputPath("non_uniform_VN_sizes.txt");
+          }
+        }
+
+        std::string GetOutputPath(std::string filename) const {
+          return (output_dir_ == ".")? filename : output_dir_ + "/" + filename;
+        }
+
+        std::string GetRNConfigFile() const {
+          return GetOutputPath("RN_Config.vmh");
+        }
+
+        std::string GetOutputBuffValidFile() const {
+          return GetOutputPath("outputBuffValid.vmh");
+        }
+
+        std::string GetRNConfigDictionaryFile() const {
+          return GetOutputPath("RN_Config_Dict.vmh");
+        }
+
+        std::string GetRNConfigIndexFile() const {
+          return GetOutputPath("RN_Config_Index.vmh");
+        }
+
+        std::string GetLayerInfoFile() const {
+          return GetOutputPath("Layer_Info.vmh");
+        }
+
+        std::string GetOptimizedVNSizesFile() const {
+          return GetOutputPath("optimized_VN_sizes.txt");
+        }
+
+        std::string ToString() const {
+          return std::to_string(num_mult_switches_) + " " + std::to_string(vn_size_) + " " + std::to_string(vn_num_) + " "
+                 + std::to_string(non_uniform_? 1 : 0) + " " + layer_file_ + " -> " + output_dir_;
+        }
+    }; // End of class CompileJob
+
+    /*
+      Compiles one job into its RN_Config, outputBuffValid and Layer_Info
+      files. A runner only holds its own settings and an optional RN config
+      cache, which is safe to share, so one runner can serve many threads.
+    */
+    class CompileJobRunner {
+      protected:
+        RNGenerator generator_;
+        bool verbose_;
+        std::shared_ptr<RNConfigCache> cache_;
+        bool optimize_placement_;
+        bool compress_rn_config_;
+        bool count_allocations_;
+
+        // Non-uniform VNs are reordered by the placement optimizer if requested; the chosen order is written next to the outputs
+        ReductionNetwork::LeafAssignment PlaceLeaves(const CompileJob& job) const {
+          if(!optimize_placement_ || !job.non_uniform_) {
+            return ReductionNetwork::VNPlacement::Place(job.num_mult_switches_, job.vn_size_, job.vn_num_, job.non_uniform_, job.vn_sizes_file_);
+          }
+
+          auto vn_sizes = ReductionNetwork::VNPlacement::ReadVNSizes(job.vn_sizes_file_);
+          ReductionNetwork::VNPlacementOptimizer optimizer(job.num_mult_switches_);
+          auto plan = optimizer.Optimize(vn_sizes);
+
+          // Dropping a VN would silently lose its outputs
+          if(!plan.dropped_.empty()) {
+            std::cerr << "ERROR: The VN placement optimizer cannot fit VNs";
+            for(auto vn_id : plan.dropped_) {
+              std::cerr << " " << vn_id << "(size " << vn_sizes[vn_id] << ")";
+            }
+            std::cerr << " of " << job.vn_sizes_file_ << " on " << job.num_mult_switches_ << " multiplier switches" << std::endl;
+            ReductionNetwork::LeafAssignment failed(ReductionNetwork::TreeShape::NextPowerOfTwo(job.num_mult_switches_));
+            failed.valid_ = false;
+            return failed;
+          }
+
+          std::ofstream optimizedSizes(job.GetOptimizedVNSizesFile());
+          for(int idx = 0; idx < static_cast<int>(plan.vn_sizes_.size()); idx++) {
+            optimizedSizes << ((idx == 0)? "" : " ") << plan.vn_sizes_[idx];
+          }
+          optimizedSizes << "\n";
+
+          if(verbose_) {
+            std::cout << "VN placement optimizer (" << (plan.exact_? "exact" : "beam search") << "): " << plan.num_active_ << " of "
+                      << job.num_mult_switches_ << " multiplier switches active, " << optimizer.GetNumActive(vn_sizes) << " in the given order" << std::endl;
+          }
+
+          return ReductionNetwork::VNPlacement::PlaceNonUniform(job.num_mult_switches_, plan.vn_sizes_);
+        }
+
+        bool CompileReductionNetwork(const CompileJob& job) const {
+          // The placement reported why the layout is invalid; no outputs are written for it
+          auto leaves = PlaceLeaves(job);
+          if(!leaves.valid_) {
+            return false;
+          }
+
+          MachineCodeGenerator::RNConfigWriter outputFileWriter(job.GetRNConfigFile(), job.GetOutputBuffValidFile());
+          if(compress_rn_config_) {
+            outputFileWriter.EnableCompression(job.num_mult_switches_, job.GetRNConfigDictionaryFile(), job.GetRNConfigIndexFile());
+          }
+
+          // Check mode always compiles
+          std::string cache_key = "";
+          if(cache_ != nullptr && generator_ != RNGenerator::Check) {
+            cache_key = RNConfigCache::GetCanonicalKey(job.num_mult_switches_, leaves);
+
+            RNConfigCacheEntry entry;
+            if(cache_->Lookup(cache_key, entry)) {
+              if(verbose_) {
+                std::cout << "RN config cache hit" << std::endl;
+              }
+              return outputFileWriter.WritePayload(entry.rn_config_, entry.output_buff_valid_);
+            }
+          }
+
+          ReductionNetwork::RNConfig rn_config;
+          bool success = GenerateRNConfig(generator_, job.num_mult_switches_, leaves, rn_config, verbose_, count_allocations_);
+          if(generator_ == RNGenerator::Check) {
+            // The simulated configuration is written even if the check fails
+            return outputFileWriter.WriteVN_Config(rn_config) && success;
+          }
+
+          RNConfigCacheEntry entry;
+          MachineCodeGenerator::RNConfigEncoder encoder;
+          entry.rn_config_ = encoder.GetRNConfigPayload(rn_config);
+          entry.output_buff_valid_ = encoder.GetOutputBuffValidPayload(rn_config);
+          if(cache_key != "") {
+            cache_->Store(cache_key, entry);
+          }
+          return outputFileWriter.WritePayload(entry.rn_config_, entry.output_buff_valid_);
+        }
+
+        bool CompileTileInfo(const CompileJob& job) const {
+          maestro::LayerParser layerParser(job.layer_file_);
+
+          auto layerInfo = layerParser.ParseLayer();
+          if(verbose_) {
+            std::cout << "Parse finished" << std::endl;
+          }
+
+          if(!CheckLayerLoops(layerInfo, job.layer_file_)) {
+            return false;
+          }
+
+          MachineCodeGenerator::TileInfoWriter tileInfoWriter(job.GetLayerInfoFile());
+
+          if(verbose_) {
+            std::cout << layerInfo->ToString() << std::endl;
+          }
+
+          tileInfoWriter.WriteTileInfo(layerInfo, job.num_mult_switches_, job.vn_size_, job.vn_num_);
+          return true;
+        }
+
+      public:
+        CompileJobRunner(RNGenerator generator = RNGenerator::Simulation, bool verbose = true, std::shared_ptr<RNConfigCache> cache = nullptr, bool optimize_placement = false,
+                         bool compress_rn_config = false, bool count_allocations = false) :
+          generator_(generator),
+          verbose_(verbose),
+          cache_(cache),
+          optimize_placement_(optimize_placement),
+          compress_rn_config_(compress_rn_config),
+          count_allocations_(count_allocations) {
+        }
+
+        bool Run(const CompileJob& job) const {
+          if(!CompileReductionNetwork(job)) {
+            return false;
+          }
+          return CompileTileInfo(job);
+        }
+    }; // End of class CompileJobRunner
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,101 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DRIVER_COMPILER_API_H_
+#define DRIVER_COMPILER_API_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "analysis-structure.hpp"
+#include "compile_job.hpp"
+
+/*
+  In-memory entry point of the MAERI compiler, built as the
+  maeri_compiler_api library. Nothing is read from or written to disk.
+*/
+
+namespace MAERI {
+  namespace Driver {
+
+    class AcceleratorParams {
+      public:
+        int num_mult_switches_;
+        RNGenerator rn_generator_;
+
+        AcceleratorParams(int numMultSwitches, RNGenerator rn_generator = RNGenerator::ClosedForm) :
+          num_mult_switches_(numMultSwitches),
+          rn_generator_(rn_generator) {
+        }
+    }; // End of class AcceleratorParams
+
+    // Uniform layouts use vn_size_ and vn_num_; non-uniform layouts list the size of every VN and keep VNSize = VNNum = 1 as on the command line
+    class VNLayout {
+      public:
+        int vn_size_;
+        int vn_num_;
+        bool non_uniform_;
+        std::vector<int> vn_sizes_;
+
+        VNLayout(int vn_size, int vn_num) :
+          vn_size_(vn_size),
+          vn_num_(vn_num),
+          non_uniform_(false) {
+        }
+
+        VNLayout(std::vector<int> vn_sizes) :
+          vn_size_(1),
+          vn_num_(1),
+          non_uniform_(true),
+          vn_sizes_(vn_sizes) {
+        }
+    }; // End of class VNLayout
+
+    /*
+      Contents of the files maeri_compiler writes, encoded like a
+      ConfigImageEntry: one packed word per RN_Config.vmh switch line (digits
+      in bits 0..23, last digit in bit 0, digit count in bits 24..31), the
+      outputBuffValid.vmh entries, and the Layer_Info.vmh words. The @000
+      address line of RN_Config.vmh is left out; VmhCodec::FormatRNConfig
+      and FormatTileInfo give back the rest of the VMH text.
+    */
+    class CompileResult {
+      public:
+        bool success_ = false;
+        std::vector<uint32_t> rn_config_words_;
+        std::vector<int> output_buff_valid_;
+        std::vector<uint32_t> tile_info_words_;
+    }; // End of class CompileResult
+
+    // Errors (invalid VN layout, missing loops, failed generator check) are reported on std::cerr and leave success_ false
+    CompileResult Compile(const AcceleratorParams& params, const VNLayout& layout, std::shared_ptr<maestro::LoopInfoTable> loopInfoTable);
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,332 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DRIVER_DESIGN_SPACE_EXPLORER_H_
+#define DRIVER_DESIGN_SPACE_EXPLORER_H_
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "compile_job.hpp"
+#include "cycle_model.hpp"
+#include "mapping_check.hpp"
+#include "parser.hpp"
+
+namespace MAERI {
+  namespace Driver {
+
+    // Best uniform VN mapping of one layer on one accelerator
+    class LayerMapping {
+      public:
+        int vn_size_ = 0;
+        int vn_num_ = 0;
+        long cycles_ = -1;   // -1: no mapping fits
+    }; // End of class LayerMapping
+
+    class DesignPoint {
+      public:
+        int num_mult_switches_;
+        int distribution_bandwidth_;
+        int collection_bandwidth_;
+        std::vector<LayerMapping> mappings_;   // One per layer
+        long total_cycles_ = -1;               // Sum over the layers; -1 if some layer has no mapping
+
+        DesignPoint(int numMultSwitches, int distributionBandwidth, int collectionBandwidth) :
+          num_mult_switches_(numMultSwitches),
+          distribution_bandwidth_(distributionBandwidth),
+          collection_bandwidth_(collectionBandwidth) {
+        }
+
+        int GetBandwidth() const {
+          return distribution_bandwidth_ + collection_bandwidth_;
+        }
+
+        bool IsFeasible() const {
+          return total_cycles_ >= 0;
+        }
+
+        // No worse in cycles, multipliers and bandwidth, and better in at least one
+        bool Dominates(const DesignPoint& other) const {
+          bool no_worse = total_cycles_ <= other.total_cycles_ && num_mult_switches_ <= other.num_mult_switches_
+                          && GetBandwidth() <= other.GetBandwidth();
+          bool better = total_cycles_ < other.total_cycles_ || num_mult_switches_ < other.num_mult_switches_
+                        || GetBandwidth() < other.GetBandwidth();
+          return no_worse && better;
+        }
+    }; // End of class DesignPoint
+
+    /*
+      Sweeps accelerator parameters and per-layer VN mappings, scoring every
+      point with the analytical cycle model. Spec lines (blank lines and
+      lines starting with # are skipped):
+        MultSwitches N...
+        DistributionBandwidth B...
+        CollectionBandwidth B...
+        VNSizes S...            (optional; defaults to R*S of each layer)
+        Layer LayerFile         (one line per layer file; every layer of the file is explored)
+      Every combination of the three parameter lists is a hardware point;
+      for each layer the VN size and count with the fewest cycles are kept,
+      among the mappings that pass PerformanceModel::MappingCheck with all
+      VNs and with the fewer VNs of the last K fold.
+      Hardware points are spread over worker threads, which share only the
+      index of the next point.
+    */
+    class DesignSpaceExplorer {
+      protected:
+        std::vector<int> mult_switches_;
+        std::vector<int> distribution_bandwidths_;
+        std::vector<int> collection_bandwidths_;
+        std::vector<int> vn_sizes_;
+        std::vector<std::string> layer_files_;
+        std::vector<PerformanceModel::LayerDims> layers_;
+        std::vector<std::string> layer_names_;   // Layer file, with :index for files holding several layers
+
+        std::vector<DesignPoint> points_;
+
+        LayerMapping MapLayer(PerformanceModel::AnalyticalCycleModel& model, PerformanceModel::MappingCheck& mapping_check, int num_mult_switches,
+                              const PerformanceModel::LayerDims& layer) {
+          LayerMapping best;
+          std::vector<int> candidates = vn_sizes_;
+          if(candidates.empty()) {
+            candidates.push_back(layer.r_ * layer.s_);
+          }
+
+          for(auto vn_size : candidates) {
+            if(vn_size < 1 || vn_size > num_mult_switches) {
+              continue;
+            }
+            // Single-multiplier VNs each take a whole lowest-level switch
+            int max_vn_num = (vn_size == 1)? num_mult_switches / 2 : num_mult_switches / vn_size;
+            for(int vn_num = 1; vn_num <= max_vn_num; vn_num++) {
+              int last_num_vns = (layer.k_ - 1) % vn_num + 1;
+              if(!mapping_check.IsValid(vn_size, vn_num, std::min(vn_num, layer.k_)) || !mapping_check.IsValid(vn_size, vn_num, last_num_vns)) {
+                continue;
+              }
+              auto estimate = model.Estimate(layer, vn_size, vn_num);
+              if(estimate.valid_ && (best.cycles_ < 0 || estimate.total_cycles_ < best.cycles_)) {
+                best.vn_size_ = vn_size;
+                best.vn_num_ = vn_num;
+                best.cycles_ = estimate.total_cycles_;
+              }
+            }
+          }
+          return best;
+        }
+
+        void Evaluate(DesignPoint& point) {
+          PerformanceModel::AnalyticalCycleModel model(PerformanceModel::HardwareParams(point.num_mult_switches_, point.distribution_bandwidth_, point.collection_bandwidth_));
+          PerformanceModel::MappingCheck mapping_check(point.num_mult_switches_);
+          point.total_cycles_ = 0;
+          for(auto& layer : layers_) {
+            point.mappings_.push_back(MapLayer(model, mapping_check, point.num_mult_switches_, layer));
+            if(point.mappings_.back().cycles_ < 0) {
+              point.total_cycles_ = -1;
+            } else if(point.total_cycles_ >= 0) {
+              point.total_cycles_ += point.mappings_.back().cycles_;
+            }
+          }
+        }
+
+      public:
+        bool ReadSpec(std::string filename) {
+          std::ifstream spec(filename);
+          if(!spec) {
+            std::cerr << "ERROR: Failed to open the DSE spec " << filename << std::endl;
+            return false;
+          }
+
+          std::string line;
+          int line_num = 0;
+          while(std::getline(spec, line)) {
+            line_num++;
+            std::istringstream fields(line);
+            std::string key;
+            if(!(fields >> key) || key[0] == '#') {
+              continue;
+            }
+
+            std::vector<int>* values = nullptr;
+            if(key == "MultSwitches") {
+              values = &mult_switches_;
+            }
+            else if(key == "DistributionBandwidth") {
+              values = &distribution_bandwidths_;
+            }
+            else if(key == "CollectionBandwidth") {
+              values = &collection_bandwidths_;
+            }
+            else if(key == "VNSizes") {
+              values = &vn_sizes_;
+            }
+            else if(key == "Layer") {
+              std::string layer_file;
+              if(!(fields >> layer_file)) {
+                std::cerr << "ERROR: " << filename << ":" << line_num << ": expected Layer LayerFile" << std::endl;
+                return false;
+              }
+              layer_files_.push_back(layer_file);
+              continue;
+            }
+            else {
+              std::cerr << "ERROR: " << filename << ":" << line_num << ": unknown key " << key << std::endl;
+              return false;
+            }
+
+            int value;
+            while(fields >> value) {
+              values->push_back(value);
+            }
+            if(!fields.eof()) {
+              std::cerr << "ERROR: " << filename << ":" << line_num << ": expected integers after " << key << std::endl;
+              return false;
+            }
+          }
+
+          if(mult_switches_.empty() || distribution_bandwidths_.empty() || collection_bandwidths_.empty() || layer_files_.empty()) {
+            std::cerr << "ERROR: " << filename << ": MultSwitches, DistributionBandwidth, CollectionBandwidth and Layer are required" << std::endl;
+            return false;
+          }
+          return true;
+        }
+
+        bool ParseLayers() {
+          // A layer file may hold a whole network
+          for(auto& layer_file : layer_files_) {
+            maestro::LayerParser layerParser(layer_file);
+            auto layerInfos = layerParser.ParseLayers();
+            if(layerInfos.empty()) {
+              return false;
+            }
+            for(int idx = 0; idx < static_cast<int>(layerInfos.size()); idx++) {
+              if(!CheckLayerLoops(layerInfos[idx], layer_file)) {
+                return false;
+              }
+              layers_.push_back(PerformanceModel::LayerDims::FromLoopInfoTable(layerInfos[idx]));
+              layer_names_.push_back((layerInfos.size() > 1)? layer_file + ":" + std::to_string(idx) : layer_file);
+            }
+          }
+          return true;
+        }
+
+        // Returns the number of evaluated hardware points; combinations the accelerator cannot be built with are skipped
+        int Run(int num_threads) {
+          points_.clear();
+          for(auto num_mult_switches : mult_switches_) {
+            for(auto distribution_bandwidth : distribution_bandwidths_) {
+              for(auto collection_bandwidth : collection_bandwidths_) {
+                if(PerformanceModel::HardwareParams(num_mult_switches, distribution_bandwidth, collection_bandwidth).IsValid()) {
+                  points_.emplace_back(num_mult_switches, distribution_bandwidth, collection_bandwidth);
+                }
+              }
+            }
+          }
+
+          int num_points = static_cast<int>(points_.size());
+          std::atomic<int> next_point(0);
+          auto worker = [&]() {
+            for(int idx = next_point++; idx < num_points; idx = next_point++) {
+              Evaluate(points_[idx]);
+            }
+          };
+
+          num_threads = std::max(1, std::min(num_threads, num_points));
+          std::vector<std::thread> workers;
+          for(int tid = 0; tid < num_threads; tid++) {
+            workers.emplace_back(worker);
+          }
+          for(auto& thread : workers) {
+            thread.join();
+          }
+          return num_points;
+        }
+
+        // Feasible points no other feasible point dominates, by multipliers, bandwidth and cycles
+        std::vector<DesignPoint> GetParetoFront() {
+          std::vector<DesignPoint> front;
+          for(auto& point : points_) {
+            if(!point.IsFeasible()) {
+              continue;
+            }
+            bool dominated = false;
+            for(auto& other : points_) {
+              if(other.IsFeasible() && other.Dominates(point)) {
+                dominated = true;
+                break;
+              }
+            }
+            if(!dominated) {
+              front.push_back(point);
+            }
+          }
+
+          std::sort(front.begin(), front.end(), [](const DesignPoint& a, const DesignPoint& b) {
+            if(a.num_mult_switches_ != b.num_mult_switches_) {
+              return a.num_mult_switches_ < b.num_mult_switches_;
+            }
+            if(a.GetBandwidth() != b.GetBandwidth()) {
+              return a.GetBandwidth() < b.GetBandwidth();
+            }
+            return a.total_cycles_ < b.total_cycles_;
+          });
+          return front;
+        }
+
+        // One row per front point and layer
+        bool WriteParetoFront(std::string filename) {
+          std::ofstream csv(filename);
+          if(!csv) {
+            std::cerr << "ERROR: Failed to open " << filename << std::endl;
+            return false;
+          }
+
+          csv << "NumMultSwitches,DistributionBandwidth,CollectionBandwidth,Bandwidth,TotalCycles,Layer,VNSize,VNNum,LayerCycles\n";
+          for(auto& point : GetParetoFront()) {
+            for(int layer = 0; layer < static_cast<int>(layers_.size()); layer++) {
+              auto& mapping = point.mappings_[layer];
+              csv << point.num_mult_switches_ << "," << point.distribution_bandwidth_ << "," << point.collection_bandwidth_ << ","
+                  << point.GetBandwidth() << "," << point.total_cycles_ << "," << layer_names_[layer] << ","
+                  << mapping.vn_size_ << "," << mapping.vn_num_ << "," << mapping.cycles_ << "\n";
+            }
+          }
+          return true;
+        }
+
+        int GetNumFeasiblePoints() {
+          return static_cast<int>(std::count_if(points_.begin(), points_.end(), [](const DesignPoint& point) { return point.IsFeasible(); }));
+        }
+
+    }; // End of class DesignSpaceExplorer
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,176 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DRIVER_NETWORK_COMPILER_H_
+#define DRIVER_NETWORK_COMPILER_H_
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "compile_job.hpp"
+#include "batch_compiler.hpp"
+#include "rn_config_cache.hpp"
+#include "vmh_writer.hpp"
+
+namespace MAERI {
+  namespace Driver {
+
+    /*
+      Compiles every layer of a network and links them into the multi-layer
+      Layer_Info.vmh and RN_Config.vmh images that CR_TileInfoMemory and
+      CR_RN_ConfigurationMemory step through. Network description lines
+      (blank lines and lines starting with # are skipped):
+        NumMultSwitches N                               (once, first)
+        LayerFile VNSize VNNum NonUniform [VNSizesFile] (one line per layer, in execution order)
+      Layer i is compiled into OutputDir/layer_<i>/ as a regular job; the
+      images are written to OutputDir.
+    */
+    class NetworkCompiler {
+      protected:
+        int num_mult_switches_ = 0;
+        std::string output_dir_;
+        std::vector<CompileJob> layers_;
+
+        // Payload lines of a vmh file, without its address directives
+        static bool ReadVmhWords(std::string filename, std::vector<std::string>& words) {
+          std::ifstream vmh(filename);
+          if(!vmh) {
+            std::cerr << "ERROR: Failed to open " << filename << std::endl;
+            return false;
+          }
+          std::string line;
+          while(std::getline(vmh, line)) {
+            if(line != "" && line[0] != '@') {
+              words.push_back(line);
+            }
+          }
+          return true;
+        }
+
+        std::string GetOutputPath(std::string filename) const {
+          return (output_dir_ == ".")? filename : output_dir_ + "/" + filename;
+        }
+
+      public:
+        NetworkCompiler(std::string output_dir = ".") :
+          output_dir_(output_dir) {
+        }
+
+        bool ReadNetwork(std::string filename) {
+          std::ifstream network(filename);
+          if(!network) {
+            std::cerr << "ERROR: Failed to open the network description " << filename << std::endl;
+            return false;
+          }
+
+          std::string line;
+          int line_num = 0;
+          while(std::getline(network, line)) {
+            line_num++;
+            std::istringstream fields(line);
+            std::string first;
+            if(!(fields >> first) || first[0] == '#') {
+              continue;
+            }
+
+            if(first == "NumMultSwitches") {
+              if(num_mult_switches_ != 0 || !layers_.empty() || !(fields >> num_mult_switches_) || num_mult_switches_ < 2) {
+                std::cerr << "ERROR: " << filename << ":" << line_num << ": NumMultSwitches must be given once, before the layers" << std::endl;
+                return false;
+              }
+              continue;
+            }
+            if(num_mult_switches_ == 0) {
+              std::cerr << "ERROR: " << filename << ":" << line_num << ": NumMultSwitches must be given before the layers" << std::endl;
+              return false;
+            }
+
+            int vn_size, vn_num, non_uniform;
+            std::string vn_sizes_file;
+            if(!(fields >> vn_size >> vn_num >> non_uniform)) {
+              std::cerr << "ERROR: " << filename << ":" << line_num << ": expected LayerFile VNSize VNNum NonUniform [VNSizesFile]" << std::endl;
+              return false;
+            }
+            fields >> vn_sizes_file;
+
+            std::string layer_dir = GetOutputPath("layer_" + std::to_string(layers_.size()));
+            layers_.emplace_back(num_mult_switches_, vn_size, vn_num, non_uniform != 0, first, layer_dir, vn_sizes_file);
+          }
+
+          if(layers_.empty()) {
+            std::cerr << "ERROR: " << filename << ": the network has no layers" << std::endl;
+            return false;
+          }
+          return true;
+        }
+
+        int GetNumLayers() {
+          return static_cast<int>(layers_.size());
+        }
+
+        // Layers are compiled in parallel; the images are only written if every layer compiled
+        // With compress_rn_config, the layers' RN configs are also linked into one RN_Config_Dict.vmh and RN_Config_Index.vmh
+        bool Run(RNGenerator generator, int num_threads, std::shared_ptr<RNConfigCache> cache = nullptr, bool optimize_placement = false, bool compress_rn_config = false) {
+          BatchCompiler batchCompiler;
+          for(auto& layer : layers_) {
+            batchCompiler.AddJob(layer);
+          }
+          if(batchCompiler.Run(generator, num_threads, cache, optimize_placement) != 0) {
+            return false;
+          }
+
+          std::vector<std::vector<std::string>> tile_info_words(layers_.size());
+          std::vector<std::vector<std::string>> rn_config_words(layers_.size());
+          for(int layer = 0; layer < GetNumLayers(); layer++) {
+            if(!ReadVmhWords(layers_[layer].GetLayerInfoFile(), tile_info_words[layer])
+               || !ReadVmhWords(layers_[layer].GetRNConfigFile(), rn_config_words[layer])) {
+              return false;
+            }
+            if(static_cast<int>(tile_info_words[layer].size()) != MachineCodeGenerator::TileInfoEncoder::NUM_TILE_INFO_WORDS) {
+              std::cerr << "ERROR: " << layers_[layer].GetLayerInfoFile() << " is not a single-layer tile info record" << std::endl;
+              return false;
+            }
+          }
+
+          MachineCodeGenerator::MultiLayerTileInfoWriter tileInfoWriter(GetOutputPath("Layer_Info.vmh"));
+          tileInfoWriter.WriteLayers(tile_info_words);
+
+          MachineCodeGenerator::MultiLayerRNConfigWriter rnConfigWriter(GetOutputPath("RN_Config.vmh"), num_mult_switches_);
+          if(compress_rn_config) {
+            rnConfigWriter.EnableCompression(GetOutputPath("RN_Config_Dict.vmh"), GetOutputPath("RN_Config_Index.vmh"));
+          }
+          return rnConfigWriter.WriteLayers(rn_config_words);
+        }
+
+    }; // End of class NetworkCompiler
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
+
+#endif
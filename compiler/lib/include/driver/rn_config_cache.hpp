@@ -0,0 +1,185 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DRIVER_RN_CONFIG_CACHE_H_
+#define DRIVER_RN_CONFIG_CACHE_H_
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+
+#include <unistd.h>
+
+#include "vn_placement.hpp"
+
+namespace MAERI {
+  namespace Driver {
+
+    class RNConfigCacheEntry {
+      public:
+        std::string rn_config_;           // RN_Config.vmh lines after the address header
+        std::string output_buff_valid_;   // outputBuffValid.vmh contents
+    }; // End of class RNConfigCacheEntry
+
+    /*
+      On-disk cache of compiled RN configurations.
+      The RN configuration depends only on the array size and the VN of every
+      leaf, so the key is a run-length encoding of the leaf assignment; any
+      (VNSize, VNNum, NonUniform) description that places the same leaves
+      shares an entry. Entries are named by a 64-bit FNV-1a hash of the key
+      and store the key itself, so a hash collision is a miss, never a wrong
+      hit. Entries are published by rename, so concurrent writers (threads or
+      processes) never expose a partial entry.
+    */
+    class RNConfigCache {
+      protected:
+        // 2: entries of version 1 may hold configurations of layouts that VNPlacement::CheckReducible now rejects
+        const std::string FORMAT_TAG = "MAERI_RN_CONFIG_CACHE 2";
+
+        std::string cache_dir_;
+        std::atomic<long> num_hits_;
+        std::atomic<long> num_misses_;
+        std::atomic<long> num_temp_files_;
+
+        static bool ReadSection(std::istream& in, std::string& section) {
+          size_t length;
+          if(!(in >> length) || in.get() != '\n') {
+            return false;
+          }
+          section.resize(length);
+          return static_cast<bool>(in.read(&section[0], length));
+        }
+
+        static void WriteSection(std::ostream& out, const std::string& section) {
+          out << section.size() << "\n" << section;
+        }
+
+      public:
+        RNConfigCache(std::string cache_dir) :
+          cache_dir_(cache_dir),
+          num_hits_(0),
+          num_misses_(0),
+          num_temp_files_(0) {
+          std::error_code ec;
+          std::filesystem::create_directories(cache_dir_, ec);
+          if(ec) {
+            std::cerr << "ERROR: Failed to create cache directory " << cache_dir_ << ": " << ec.message() << std::endl;
+          }
+        }
+
+        // Leaves are encoded as runs of "vn_id/vn_size*count"; unassigned leaves use vn_id -1
+        static std::string GetCanonicalKey(int num_mult_switches, const ReductionNetwork::LeafAssignment& leaves) {
+          std::ostringstream key;
+          key << "N=" << num_mult_switches << " idle=" << leaves.idle_start_ << " leaves=";
+
+          int num_leaves = leaves.GetNumLeaves();
+          int run_start = 0;
+          for(int leaf = 1; leaf <= num_leaves; leaf++) {
+            if(leaf == num_leaves || leaves.vn_id_[leaf] != leaves.vn_id_[run_start] || leaves.vn_size_[leaf] != leaves.vn_size_[run_start]) {
+              key << leaves.vn_id_[run_start] << "/" << leaves.vn_size_[run_start] << "*" << leaf - run_start << ",";
+              run_start = leaf;
+            }
+          }
+          return key.str();
+        }
+
+        static uint64_t Hash(const std::string& key) {
+          uint64_t hash = 0xcbf29ce484222325ULL;
+          for(unsigned char c : key) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+          }
+          return hash;
+        }
+
+        std::string GetEntryPath(const std::string& key) {
+          std::ostringstream name;
+          name << std::hex << Hash(key);
+          return cache_dir_ + "/" + name.str() + ".rnc";
+        }
+
+        bool Lookup(const std::string& key, RNConfigCacheEntry& entry) {
+          std::ifstream in(GetEntryPath(key), std::ios::binary);
+
+          std::string tag, stored_key;
+          bool hit = in
+                     && std::getline(in, tag) && tag == FORMAT_TAG
+                     && ReadSection(in, stored_key) && stored_key == key
+                     && ReadSection(in, entry.rn_config_)
+                     && ReadSection(in, entry.output_buff_valid_);
+
+          if(hit) {
+            num_hits_++;
+          } else {
+            num_misses_++;
+          }
+          return hit;
+        }
+
+        void Store(const std::string& key, const RNConfigCacheEntry& entry) {
+          std::string path = GetEntryPath(key);
+          std::ostringstream temp_path;
+          temp_path << path << ".tmp." << getpid() << "." << std::this_thread::get_id() << "." << num_temp_files_++;
+
+          {
+            std::ofstream out(temp_path.str(), std::ios::binary);
+            out << FORMAT_TAG << "\n";
+            WriteSection(out, key);
+            WriteSection(out, entry.rn_config_);
+            WriteSection(out, entry.output_buff_valid_);
+            if(!out) {
+              std::cerr << "ERROR: Failed to write cache entry " << temp_path.str() << std::endl;
+              return;
+            }
+          }
+
+          std::error_code ec;
+          std::filesystem::rename(temp_path.str(), path, ec);
+          if(ec) {
+            std::cerr << "ERROR: Failed to publish cache entry " << path << ": " << ec.message() << std::endl;
+            std::filesystem::remove(temp_path.str(), ec);
+          }
+        }
+
+        long GetNumHits() {
+          return num_hits_;
+        }
+
+        long GetNumMisses() {
+          return num_misses_;
+        }
+
+    }; // End of class RNConfigCache
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
+
+#endif
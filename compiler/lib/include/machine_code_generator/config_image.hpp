@@ -0,0 +1,453 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author : Hyoukjun Kwon (hyoukjun@gatech.edu)
+Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
+
+*******************************************************************************/
+
+#ifndef CONFIG_IMAGE_H_
+#define CONFIG_IMAGE_H_
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+#include "layer_file_parser.hpp"
+#include "number_system_converter.hpp"
+
+namespace MAERI {
+  namespace MachineCodeGenerator {
+
+    /*
+      The three configuration files of one compile as 32-bit words:
+        rn_config_          one word per RN_Config.vmh line. Switch lines
+                            (binary digits) keep the digits in bits 0..23,
+                            last digit in bit 0, and the digit count in bits
+                            24..30; address lines (@addr) set bit 31 and keep
+                            the address in bits 0..23 and its hex digit count
+                            in bits 24..30.
+        output_buff_valid_  the outputBuffValid.vmh IDs, in file order.
+        tile_info_          the Layer_Info.vmh words after the @00 header.
+      The encoding is exact: converting back gives the same VMH text.
+    */
+    class ConfigImageEntry {
+      public:
+        std::vector<uint32_t> rn_config_;
+        std::vector<uint32_t> output_buff_valid_;
+        std::vector<uint32_t> tile_info_;
+        bool has_output_buff_valid_ = true;   // Multi-layer images have no outputBuffValid.vmh
+    }; // End of class ConfigImageEntry
+
+    // Conversion between VMH text and the word encoding; errors are reported with the file name and line
+    class VmhCodec {
+      protected:
+        static constexpr uint32_t ADDRESS_FLAG = 0x80000000u;
+        static constexpr int DIGIT_COUNT_SHIFT = 24;
+        static constexpr int MAX_RN_DIGITS = 24;
+
+        static bool ParseHex(std::string_view digits, uint32_t& value) {
+          if(digits.empty() || digits.size() > 8) {
+            return false;
+          }
+          value = 0;
+          for(char c : digits) {
+            int digit = (c >= '0' && c <= '9')? c - '0' : (c >= 'A' && c <= 'F')? c - 'A' + 10 : (c >= 'a' && c <= 'f')? c - 'a' + 10 : -1;
+            if(digit < 0) {
+              return false;
+            }
+            value = (value << 4) | static_cast<uint32_t>(digit);
+          }
+          return true;
+        }
+
+        // Calls on_line(line, line_num) for every line; a missing final newline is accepted
+        template <typename LineHandler>
+        static bool ForEachLine(std::string_view text, LineHandler on_line) {
+          int line_num = 0;
+          while(!text.empty()) {
+            size_t end = text.find('\n');
+            std::string_view line = text.substr(0, end);
+            if(!line.empty() && line.back() == '\r') {
+              line.remove_suffix(1);
+            }
+            if(!on_line(line, ++line_num)) {
+              return false;
+            }
+            text = (end == std::string_view::npos)? std::string_view() : text.substr(end + 1);
+          }
+          return true;
+        }
+
+        static bool ReportError(const std::string& name, int line_num, const char* message) {
+          std::cerr << "ERROR: " << name << ":" << line_num << ": " << message << std::endl;
+          return false;
+        }
+
+      public:
+        static bool ParseRNConfig(std::string_view text, const std::string& name, std::vector<uint32_t>& words) {
+          words.clear();
+          return ForEachLine(text, [&](std::string_view line, int line_num) {
+            uint32_t value = 0;
+            if(!line.empty() && line[0] == '@') {
+              if(!ParseHex(line.substr(1), value) || line.size() > 7) {
+                return ReportError(name, line_num, "expected an address of at most 6 hex digits");
+              }
+              words.push_back(ADDRESS_FLAG | (static_cast<uint32_t>(line.size() - 1) << DIGIT_COUNT_SHIFT) | value);
+              return true;
+            }
+            if(static_cast<int>(line.size()) > MAX_RN_DIGITS) {
+              return ReportError(name, line_num, "a switch line holds at most 24 binary digits");
+            }
+            for(char c : line) {
+              if(c != '0' && c != '1') {
+                return ReportError(name, line_num, "expected binary digits");
+              }
+              value = (value << 1) | static_cast<uint32_t>(c - '0');
+            }
+            words.push_back((static_cast<uint32_t>(line.size()) << DIGIT_COUNT_SHIFT) | value);
+            return true;
+          });
+        }
+
+        static std::string FormatRNConfig(const uint32_t* words, size_t num_words) {
+          std::string text;
+          text.reserve(num_words * (MAX_RN_DIGITS + 1));
+          for(size_t idx = 0; idx < num_words; idx++) {
+            uint32_t word = words[idx];
+            int num_digits = static_cast<int>((word & ~ADDRESS_FLAG) >> DIGIT_COUNT_SHIFT);
+            size_t pos = text.size();
+            if(word & ADDRESS_FLAG) {
+              text.resize(pos + num_digits + 2);
+              text[pos] = '@';
+              DigitTables::WriteHexDigits(&text[pos + 1], word, num_digits);
+            } else {
+              text.resize(pos + num_digits + 1);
+              DigitTables::WriteBinaryDigits(&text[pos], word, num_digits);
+            }
+            text.back() = '\n';
+          }
+          return text;
+        }
+
+        static bool ParseOutputBuffValid(std::string_view text, const std::string& name, std::vector<uint32_t>& ids) {
+          ids.clear();
+          return ForEachLine(text, [&](std::string_view line, int line_num) {
+            if(line.empty() || line.size() > 9) {
+              return line.empty() || ReportError(name, line_num, "expected a switch ID");
+            }
+            uint32_t id = 0;
+            for(char c : line) {
+              if(c < '0' || c > '9') {
+                return ReportError(name, line_num, "expected a switch ID");
+              }
+              id = id * 10 + static_cast<uint32_t>(c - '0');
+            }
+            ids.push_back(id);
+            return true;
+          });
+        }
+
+        static std::string FormatOutputBuffValid(const uint32_t* ids, size_t num_ids) {
+          std::string text;
+          for(size_t idx = 0; idx < num_ids; idx++) {
+            text += std::to_string(ids[idx]);
+            text += '\n';
+          }
+          return text;
+        }
+
+        // Only the @00 header the tile info writers emit is accepted
+        static bool ParseTileInfo(std::string_view text, const std::string& name, std::vector<uint32_t>& words) {
+          words.clear();
+          return ForEachLine(text, [&](std::string_view line, int line_num) {
+            uint32_t value;
+            if(line.empty()) {
+              return true;
+            }
+            if(line[0] == '@') {
+              if(!words.empty() || !ParseHex(line.substr(1), value) || value != 0) {
+                return ReportError(name, line_num, "only a leading @00 address is supported");
+              }
+              return true;
+            }
+            if(line.size() != 8 || !ParseHex(line, value)) {
+              return ReportError(name, line_num, "expected a word of 8 hex digits");
+            }
+            words.push_back(value);
+            return true;
+          });
+        }
+
+        static std::string FormatTileInfo(const uint32_t* words, size_t num_words) {
+          std::string text = "@00\n";
+          text.reserve(4 + num_words * 9);
+          for(size_t idx = 0; idx < num_words; idx++) {
+            IntToHex::AppendHexString(text, static_cast<int>(words[idx]), 8);
+            text += '\n';
+          }
+          return text;
+        }
+    }; // End of class VmhCodec
+
+    /*
+      Layout of a configuration image, in native-endian 32-bit words:
+        header   "MAERICFG", version, byte-order mark, number of entries,
+                 offset of the entry table, two reserved words
+        entries  ENTRY_WORDS words each: NumMultSwitches (0 if unknown),
+                 then offset and length of the RN config, outputBuffValid
+                 and tile info sections, and a flags word
+        sections the words of every entry
+      Offsets and lengths count words, so a mapped image is used in place.
+    */
+    class ConfigImageFormat {
+      public:
+        static constexpr char MAGIC[8] = {'M', 'A', 'E', 'R', 'I', 'C', 'F', 'G'};
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304u;
+        static constexpr int HEADER_WORDS = 8;
+        static constexpr int ENTRY_WORDS = 8;
+
+        enum HeaderWord {MAGIC_LO = 0, MAGIC_HI = 1, VERSION_WORD = 2, BYTE_ORDER_WORD = 3, NUM_ENTRIES_WORD = 4, ENTRY_TABLE_WORD = 5};
+        enum EntryWord {MULT_SWITCHES = 0, RN_CONFIG_OFFSET = 1, RN_CONFIG_LENGTH = 2, OUTPUT_BUFF_VALID_OFFSET = 3,
+                        OUTPUT_BUFF_VALID_LENGTH = 4, TILE_INFO_OFFSET = 5, TILE_INFO_LENGTH = 6, FLAGS = 7};
+
+        static constexpr uint32_t FLAG_OUTPUT_BUFF_VALID = 1;
+
+        // NumMultSwitches is the upper half of tile info word 12
+        static uint32_t GetNumMultSwitches(const std::vector<uint32_t>& tile_info) {
+          return (tile_info.size() > 12)? tile_info[12] >> 16 : 0;
+        }
+    }; // End of class ConfigImageFormat
+
+    class ConfigImageWriter {
+      protected:
+        std::vector<ConfigImageEntry> entries_;
+
+        static bool ReadText(const std::string& filename, std::string_view& text, std::unique_ptr<maestro::MappedFile>& file) {
+          file = std::make_unique<maestro::MappedFile>(filename);
+          if(!file->IsOpen()) {
+            std::cerr << "ERROR: Failed to open " << filename << ": " << file->GetError() << std::endl;
+            return false;
+          }
+          text = file->GetContents();
+          return true;
+        }
+
+      public:
+        void AddEntry(ConfigImageEntry entry) {
+          entries_.push_back(std::move(entry));
+        }
+
+        // Adds the RN_Config.vmh, outputBuffValid.vmh and Layer_Info.vmh of one compile; multi-layer images have no outputBuffValid.vmh and pass ""
+        bool AddVmhFiles(const std::string& rnConfigFile, const std::string& outputBuffValidFile, const std::string& tileInfoFile) {
+          ConfigImageEntry entry;
+          std::unique_ptr<maestro::MappedFile> file;
+          std::string_view text;
+          if(!ReadText(rnConfigFile, text, file) || !VmhCodec::ParseRNConfig(text, rnConfigFile, entry.rn_config_)
+             || !ReadText(tileInfoFile, text, file) || !VmhCodec::ParseTileInfo(text, tileInfoFile, entry.tile_info_)) {
+            return false;
+          }
+          entry.has_output_buff_valid_ = (outputBuffValidFile != "");
+          if(entry.has_output_buff_valid_
+             && (!ReadText(outputBuffValidFile, text, file) || !VmhCodec::ParseOutputBuffValid(text, outputBuffValidFile, entry.output_buff_valid_))) {
+            return false;
+          }
+          AddEntry(std::move(entry));
+          return true;
+        }
+
+        int GetNumEntries() const {
+          return static_cast<int>(entries_.size());
+        }
+
+        bool Write(const std::string& filename) const {
+          using Format = ConfigImageFormat;
+          std::vector<uint32_t> image(Format::HEADER_WORDS + entries_.size() * Format::ENTRY_WORDS, 0);
+          std::memcpy(image.data(), Format::MAGIC, sizeof(Format::MAGIC));
+          image[Format::VERSION_WORD] = Format::VERSION;
+          image[Format::BYTE_ORDER_WORD] = Format::BYTE_ORDER_MARK;
+          image[Format::NUM_ENTRIES_WORD] = static_cast<uint32_t>(entries_.size());
+          image[Format::ENTRY_TABLE_WORD] = Format::HEADER_WORDS;
+
+          auto append_section = [&](size_t entry_word, const std::vector<uint32_t>& section) {
+            image[entry_word] = static_cast<uint32_t>(image.size());
+            image[entry_word + 1] = static_cast<uint32_t>(section.size());
+            image.insert(image.end(), section.begin(), section.end());
+          };
+
+          for(size_t idx = 0; idx < entries_.size(); idx++) {
+            size_t entry_base = Format::HEADER_WORDS + idx * Format::ENTRY_WORDS;
+            image[entry_base + Format::MULT_SWITCHES] = Format::GetNumMultSwitches(entries_[idx].tile_info_);
+            image[entry_base + Format::FLAGS] = entries_[idx].has_output_buff_valid_? Format::FLAG_OUTPUT_BUFF_VALID : 0;
+            append_section(entry_base + Format::RN_CONFIG_OFFSET, entries_[idx].rn_config_);
+            append_section(entry_base + Format::OUTPUT_BUFF_VALID_OFFSET, entries_[idx].output_buff_valid_);
+            append_section(entry_base + Format::TILE_INFO_OFFSET, entries_[idx].tile_info_);
+          }
+
+          std::ofstream out(filename, std::ios::binary);
+          out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size() * sizeof(uint32_t)));
+          if(!out) {
+            std::cerr << "ERROR: Failed to write the configuration image " << filename << std::endl;
+            return false;
+          }
+          return true;
+        }
+    }; // End of class ConfigImageWriter
+
+    // One entry of a mapped image; the pointers stay valid while the ConfigImage lives
+    class ConfigImageView {
+      public:
+        uint32_t num_mult_switches_ = 0;
+        const uint32_t* rn_config_ = nullptr;
+        size_t num_rn_config_words_ = 0;
+        const uint32_t* output_buff_valid_ = nullptr;
+        size_t num_output_buff_valid_ = 0;
+        const uint32_t* tile_info_ = nullptr;
+        size_t num_tile_info_words_ = 0;
+        bool has_output_buff_valid_ = true;
+
+        ConfigImageEntry ToEntry() const {
+          ConfigImageEntry entry;
+          entry.rn_config_.assign(rn_config_, rn_config_ + num_rn_config_words_);
+          entry.output_buff_valid_.assign(output_buff_valid_, output_buff_valid_ + num_output_buff_valid_);
+          entry.tile_info_.assign(tile_info_, tile_info_ + num_tile_info_words_);
+          entry.has_output_buff_valid_ = has_output_buff_valid_;
+          return entry;
+        }
+
+        // outputBuffValid.vmh is only written if the entry has one
+        bool WriteVmhFiles(const std::string& rnConfigFile, const std::string& outputBuffValidFile, const std::string& tileInfoFile) const {
+          std::ofstream rnConfig(rnConfigFile), tileInfo(tileInfoFile);
+          rnConfig << VmhCodec::FormatRNConfig(rn_config_, num_rn_config_words_);
+          tileInfo << VmhCodec::FormatTileInfo(tile_info_, num_tile_info_words_);
+          bool output_buff_valid_ok = true;
+          if(has_output_buff_valid_) {
+            std::ofstream outputBuffValid(outputBuffValidFile);
+            outputBuffValid << VmhCodec::FormatOutputBuffValid(output_buff_valid_, num_output_buff_valid_);
+            output_buff_valid_ok = static_cast<bool>(outputBuffValid);
+          }
+          if(!rnConfig || !tileInfo || !output_buff_valid_ok) {
+            std::cerr << "ERROR: Failed to write " << rnConfigFile << ", " << outputBuffValidFile << " or " << tileInfoFile << std::endl;
+            return false;
+          }
+          return true;
+        }
+    }; // End of class ConfigImageView
+
+    /*
+      Read-only, memory-mapped configuration image. The header and the
+      entry table are checked once when the image is opened; entries are
+      then read in place without parsing or copying.
+    */
+    class ConfigImage {
+      protected:
+        maestro::MappedFile file_;
+        const uint32_t* words_ = nullptr;
+        size_t num_words_ = 0;
+        uint32_t num_entries_ = 0;
+        const uint32_t* entry_table_ = nullptr;
+        bool valid_ = false;
+
+        bool CheckSection(uint32_t offset, uint32_t length) const {
+          return offset <= num_words_ && length <= num_words_ - offset;
+        }
+
+        bool Check(const std::string& filename) {
+          using Format = ConfigImageFormat;
+          if(!file_.IsOpen()) {
+            std::cerr << "ERROR: Failed to open the configuration image " << filename << ": " << file_.GetError() << std::endl;
+            return false;
+          }
+          auto contents = file_.GetContents();
+          words_ = reinterpret_cast<const uint32_t*>(contents.data());
+          num_words_ = contents.size() / sizeof(uint32_t);
+
+          if(contents.size() % sizeof(uint32_t) != 0 || num_words_ < Format::HEADER_WORDS
+             || std::memcmp(words_, Format::MAGIC, sizeof(Format::MAGIC)) != 0) {
+            std::cerr << "ERROR: " << filename << " is not a MAERI configuration image" << std::endl;
+            return false;
+          }
+          if(words_[Format::BYTE_ORDER_WORD] != Format::BYTE_ORDER_MARK) {
+            std::cerr << "ERROR: " << filename << " was written on a machine of the other byte order" << std::endl;
+            return false;
+          }
+          if(words_[Format::VERSION_WORD] != Format::VERSION) {
+            std::cerr << "ERROR: " << filename << " has image version " << words_[Format::VERSION_WORD] << "; version " << Format::VERSION << " is supported" << std::endl;
+            return false;
+          }
+
+          num_entries_ = words_[Format::NUM_ENTRIES_WORD];
+          uint32_t table_offset = words_[Format::ENTRY_TABLE_WORD];
+          if(num_entries_ > num_words_ / Format::ENTRY_WORDS || !CheckSection(table_offset, num_entries_ * Format::ENTRY_WORDS)) {
+            std::cerr << "ERROR: " << filename << ": the entry table exceeds the file" << std::endl;
+            return false;
+          }
+          entry_table_ = words_ + table_offset;
+
+          for(uint32_t idx = 0; idx < num_entries_; idx++) {
+            const uint32_t* entry = entry_table_ + idx * Format::ENTRY_WORDS;
+            if(!CheckSection(entry[Format::RN_CONFIG_OFFSET], entry[Format::RN_CONFIG_LENGTH])
+               || !CheckSection(entry[Format::OUTPUT_BUFF_VALID_OFFSET], entry[Format::OUTPUT_BUFF_VALID_LENGTH])
+               || !CheckSection(entry[Format::TILE_INFO_OFFSET], entry[Format::TILE_INFO_LENGTH])) {
+              std::cerr << "ERROR: " << filename << ": a section of entry " << idx << " exceeds the file" << std::endl;
+              return false;
+            }
+          }
+          return true;
+        }
+
+      public:
+        ConfigImage(const std::string& filename) :
+          file_(filename) {
+          valid_ = Check(filename);
+        }
+
+        bool IsValid() const {
+          return valid_;
+        }
+
+        int GetNumEntries() const {
+          return valid_? static_cast<int>(num_entries_) : 0;
+        }
+
+        ConfigImageView GetEntry(int idx) const {
+          using Format = ConfigImageFormat;
+          const uint32_t* entry = entry_table_ + idx * Format::ENTRY_WORDS;
+          ConfigImageView view;
+          view.num_mult_switches_ = entry[Format::MULT_SWITCHES];
+          view.rn_config_ = words_ + entry[Format::RN_CONFIG_OFFSET];
+          view.num_rn_config_words_ = entry[Format::RN_CONFIG_LENGTH];
+          view.output_buff_valid_ = words_ + entry[Format::OUTPUT_BUFF_VALID_OFFSET];
+          view.num_output_buff_valid_ = entry[Format::OUTPUT_BUFF_VALID_LENGTH];
+          view.tile_info_ = words_ + entry[Format::TILE_INFO_OFFSET];
+          view.num_tile_info_words_ = entry[Format::TILE_INFO_LENGTH];
+          view.has_output_buff_valid_ = (entry[Format::FLAGS] & Format::FLAG_OUTPUT_BUFF_VALID) != 0;
+          return view;
+        }
+    }; // End of class ConfigImage
+
+  }; // End of namesapce MachineCodeGenerator
+}; // End of namespace MAERI
+
+#endif
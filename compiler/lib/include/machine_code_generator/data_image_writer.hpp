@@ -0,0 +1,244 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef DATA_IMAGE_WRITER_H_
+#define DATA_IMAGE_WRITER_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+#include "vmh_writer.hpp"
+#include "compiled_config.hpp"
+#include "tensor_file.hpp"
+
+namespace MAERI {
+  namespace MachineCodeGenerator {
+
+    // One line per beat: a 16-bit value per DN port, port 0 in the least significant digits
+    class DataBeatWriter : public VmhWriter {
+      protected:
+        std::string line_;
+        long num_beats_ = 0;
+
+      public:
+        DataBeatWriter(std::string filename, int distributionBandwidth) :
+          VmhWriter(filename),
+          line_(4 * distributionBandwidth + 1, '\n') {
+          outputFile_ << "@00\n";
+        }
+
+        bool IsGood() const {
+          return outputFile_.good();
+        }
+
+        long GetNumBeats() const {
+          return num_beats_;
+        }
+
+        void WriteBeat(const std::vector<int16_t>& ports) {
+          static const char hex_digits[] = "0123456789ABCDEF";
+          int num_ports = static_cast<int>(ports.size());
+          for(int prt = 0; prt < num_ports; prt++) {
+            uint16_t value = static_cast<uint16_t>(ports[prt]);
+            char* digits = &line_[4 * (num_ports - 1 - prt)];
+            for(int digit = 3; digit >= 0; digit--) {
+              digits[digit] = hex_digits[value & 0xF];
+              value >>= 4;
+            }
+          }
+          outputFile_.write(line_.data(), line_.size());
+          num_beats_++;
+        }
+    }; // End of class DataBeatWriter
+
+    /*
+      Weight_Data.vmh and Input_Data.vmh, which Testbench_MAERI built with
+      TESTBENCH_DATA_IMAGES reads instead of synthesizing data. Each line
+      is one firing of doWeightInitData (weight image), or of
+      doInputInitData or doSteadyState (input image), in which at least one
+      subtree port injects. A port sends the value of the first
+      multiplier switch of its subtree that the beat targets: filter tap
+      ms % VNSize of output channel k + ms / VNSize for weights, the
+      window tap for inputs, and for steady-state beats the new input
+      column x + S - 1 of row t. Padding reads as zero. Beats are written
+      as they are generated from the mapped tensors, so neither the
+      tensors nor the images have to fit in memory.
+    */
+    class DataImageGenerator {
+      protected:
+        int num_mult_switches_;
+        int distribution_bandwidth_;
+        int subtree_size_;
+        DataBeatWriter weights_;
+        DataBeatWriter inputs_;
+        std::vector<int16_t> beat_;
+
+        // Fills beat_ from the first targeted switch of every subtree; returns false if no port injects
+        bool FillBeat(int num_active, const std::function<bool(int)>& is_target, const std::function<int16_t(int)>& get_value) {
+          bool any = false;
+          for(int prt = 0; prt < distribution_bandwidth_; prt++) {
+            beat_[prt] = 0;
+            int end = std::min(num_active, (prt + 1) * subtree_size_);
+            for(int ms = prt * subtree_size_; ms < end; ms++) {
+              if(is_target(ms)) {
+                beat_[prt] = get_value(ms);
+                any = true;
+                break;
+              }
+            }
+          }
+          return any;
+        }
+
+      public:
+        DataImageGenerator(std::string weightFilename, std::string inputFilename, int numMultSwitches, int distributionBandwidth) :
+          num_mult_switches_(numMultSwitches),
+          distribution_bandwidth_(distributionBandwidth),
+          subtree_size_(numMultSwitches / distributionBandwidth),
+          weights_(weightFilename, distributionBandwidth),
+          inputs_(inputFilename, distributionBandwidth),
+          beat_(distributionBandwidth, 0) {
+        }
+
+        // Appends one layer; weights are [K][C][R][S] and inputs [C][Y][X] ([K][Y][X] for depthwise layers) of the lowered layer
+        bool WriteLayer(const PerformanceModel::TileInfoLayer& layer, Util::TensorFile& weightTensor, Util::TensorFile& inputTensor) {
+          auto& dims = layer.dims_;
+          int vn_size = layer.vn_size_;
+          bool depthwise = (layer.layer_type_ == static_cast<int>(maestro::LayerType::DWCONV));
+          int num_input_channels = depthwise? dims.k_ : dims.c_;
+
+          if(distribution_bandwidth_ < 1 || num_mult_switches_ % distribution_bandwidth_ != 0) {
+            std::cerr << "ERROR: DistributionBandwidth " << distribution_bandwidth_ << " does not divide " << num_mult_switches_ << " multiplier switches" << std::endl;
+            return false;
+          }
+          if(vn_size != dims.r_ * dims.s_) {
+            std::cerr << "ERROR: VN size " << vn_size << " differs from R x S = " << dims.r_ * dims.s_
+                      << "; Testbench_MAERI maps one filter window per VN" << std::endl;
+            return false;
+          }
+          if(!weightTensor.CheckNumElements(static_cast<size_t>(dims.k_) * dims.c_ * dims.r_ * dims.s_, "K x C x R x S")
+             || !inputTensor.CheckNumElements(static_cast<size_t>(num_input_channels) * dims.y_ * dims.x_, depthwise? "K x Y x X" : "C x Y x X")) {
+            return false;
+          }
+          // One value per subtree and beat: the VNs of a depthwise layer read different channels, so they may not share a subtree
+          int num_active_vns = std::min(layer.num_mapped_vns_, dims.k_);
+          for(int prt = 0; depthwise && prt < distribution_bandwidth_; prt++) {
+            int first_ms = prt * subtree_size_;
+            int last_ms = std::min(num_active_vns * vn_size, first_ms + subtree_size_) - 1;
+            if(last_ms > first_ms && first_ms / vn_size != last_ms / vn_size) {
+              std::cerr << "ERROR: Depthwise VNs " << first_ms / vn_size << " and " << last_ms / vn_size << " share DN subtree " << prt
+                        << " of " << subtree_size_ << " multiplier switches, but a data image beat carries one input channel per subtree;"
+                        << " map at most one VN per subtree (VN size a multiple of " << subtree_size_ << ", or a single VN)" << std::endl;
+              return false;
+            }
+          }
+
+          auto weight = [&](int k, int c, int r, int s) {
+            return weightTensor.Get(((static_cast<size_t>(k) * dims.c_ + c) * dims.r_ + r) * dims.s_ + s);
+          };
+          // Coordinates of the padded input, as yCounter and xCounter count them
+          auto input = [&](int channel, int padded_y, int padded_x) -> int16_t {
+            int iy = padded_y - dims.pad_y_;
+            int ix = padded_x - dims.pad_x_;
+            if(iy < 0 || iy >= dims.y_ || ix < 0 || ix >= dims.x_) {
+              return 0;
+            }
+            return inputTensor.Get((static_cast<size_t>(channel) * dims.y_ + iy) * dims.x_ + ix);
+          };
+
+          int output_height = dims.GetOutputHeight();
+          int output_width = dims.GetOutputWidth();
+          bool strided_x = (dims.stride_x_ > 1);
+
+          for(int c = 0; c < dims.c_; c++) {
+            for(int k_base = 0; k_base < dims.k_; k_base += layer.num_mapped_vns_) {
+              int num_active = std::min(layer.num_mapped_vns_, dims.k_ - k_base) * vn_size;
+              auto get_channel = [&](int ms) {
+                return depthwise? k_base + ms / vn_size : c;
+              };
+
+              // doWeightInitData: switch prt * DN_SubTreeSz + t of every subtree
+              for(int t = 0; t < subtree_size_; t++) {
+                auto is_target = [&](int ms) { return ms % subtree_size_ == t; };
+                auto get_value = [&](int ms) { return weight(k_base + ms / vn_size, c, (ms % vn_size) / dims.s_, (ms % vn_size) % dims.s_); };
+                if(FillBeat(num_active, is_target, get_value)) {
+                  weights_.WriteBeat(beat_);
+                }
+              }
+
+              auto write_input_beat = [&](const std::function<bool(int)>& is_target, int padded_y, int padded_x) {
+                if(FillBeat(num_active, is_target, [&](int ms) { return input(get_channel(ms), padded_y, padded_x); })) {
+                  inputs_.WriteBeat(beat_);
+                }
+              };
+
+              for(int y = 0; y <= (output_height - 1) * dims.stride_y_; y += dims.stride_y_) {
+                for(int x = 0; ; x += dims.stride_x_) {
+                  // doInputInitData: window tap t of every VN
+                  for(int t = 0; t < vn_size; t++) {
+                    write_input_beat([&](int ms) { return ms % vn_size == t; }, y + t / dims.s_, x + t % dims.s_);
+                  }
+                  if(!strided_x) {
+                    // doSteadyState: the new column enters the left-edge switch of filter row t
+                    for(int steady_x = 1; steady_x < output_width; steady_x++) {
+                      for(int t = 0; t < dims.r_; t++) {
+                        write_input_beat([&](int ms) { return (ms / dims.s_) % dims.r_ == t && ms % dims.s_ == 0; }, y + t, steady_x + dims.s_ - 1);
+                      }
+                    }
+                    break;
+                  }
+                  if(x == (output_width - 1) * dims.stride_x_) {
+                    break;
+                  }
+                }
+              }
+            }
+          }
+
+          if(!weights_.IsGood() || !inputs_.IsGood()) {
+            std::cerr << "ERROR: Failed to write the data images" << std::endl;
+            return false;
+          }
+          return true;
+        }
+
+        long GetNumWeightBeats() const {
+          return weights_.GetNumBeats();
+        }
+
+        long GetNumInputBeats() const {
+          return inputs_.GetNumBeats();
+        }
+    }; // End of class DataImageGenerator
+
+  }; // End of namespace MachineCodeGenerator
+}; // End of namespace MAERI
+
+#endif
@@ -29,128 +29,112 @@ Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
 
 #include <iostream>
 #include <string>
-#include <cmath>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 namespace MAERI {
   namespace MachineCodeGenerator {
 
+    // Table-driven digit emission shared by the VMH encoders
+    class DigitTables {
+      public:
+        static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+        // The 8 binary digits of every byte value, most significant first
+        static const std::array<std::array<char, 8>, 256>& GetByteDigits() {
+          static const auto table = [] {
+            std::array<std::array<char, 8>, 256> ret;
+            for(int value = 0; value < 256; value++) {
+              for(int bit = 0; bit < 8; bit++) {
+                ret[value][bit] = ((value >> (7 - bit)) & 1)? '1' : '0';
+              }
+            }
+            return ret;
+          }();
+          return table;
+        }
+
+        // Writes the low num_digits bits of value (at most 32) as binary digits; returns the end of the written digits
+        static char* WriteBinaryDigits(char* out, uint32_t value, int num_digits) {
+          auto& byte_digits = GetByteDigits();
+          int lead = num_digits % 8;
+          if(lead != 0) {
+            std::memcpy(out, byte_digits[(value >> (num_digits - lead)) & 0xFF].data() + 8 - lead, lead);
+            out += lead;
+          }
+          for(int shift = num_digits - lead - 8; shift >= 0; shift -= 8) {
+            std::memcpy(out, byte_digits[(value >> shift) & 0xFF].data(), 8);
+            out += 8;
+          }
+          return out;
+        }
+
+        // Writes the low num_digits hex digits of value; returns the end of the written digits
+        static char* WriteHexDigits(char* out, uint32_t value, int num_digits) {
+          for(int digit = num_digits - 1; digit >= 0; digit--) {
+            *out++ = HEX_DIGITS[(value >> (4 * digit)) & 0xF];
+          }
+          return out;
+        }
+
+        static int GetNumHexDigits(uint32_t value) {
+          int num_digits = 1;
+          while(num_digits < 8 && (value >> (4 * num_digits)) != 0) {
+            num_digits++;
+          }
+          return num_digits;
+        }
+    }; // End of class DigitTables
+
     class BinaryToHex {
       public:
-        std::string GetHexString(std::string binaryString) {
-          std::string one = "1";
+        // Any string of binary digits whose length is a multiple of 4
+        std::string GetHexString(const std::string& binaryString) {
           std::string ret = "";
-          if(binaryString.length() != 24) {
-            std::cout << "GetHexString: input binary must be 32-bit data" << std::endl;
+          if(binaryString.length() % 4 != 0) {
+            std::cout << "GetHexString: input binary must be a multiple of 4 bits" << std::endl;
             return ret;
           }
 
-          int sum = 0;
-          for(int digit = 0; digit < 24; digit++) {
-            if(binaryString.substr(digit, 1) == one) {
-              sum += 8 / pow(2, digit % 4);
-            }
-            if(digit % 4 == 3) {
-              ret += ConvertIntToHex(sum);
-              sum = 0;
+          ret.resize(binaryString.length() / 4);
+          for(size_t digit = 0; digit < ret.length(); digit++) {
+            int value = 0;
+            for(int bit = 0; bit < 4; bit++) {
+              value = (value << 1) | (binaryString[4 * digit + bit] == '1'? 1 : 0);
             }
-
+            ret[digit] = DigitTables::HEX_DIGITS[value];
           }
-
           return ret;
         }
 
         std::string ConvertIntToHex(int value) {
-          std::string ret = "";
-          if(value>15 || value < 0) {
+          if(value > 15 || value < 0) {
             std::cout << "[ConverIntToHex] out of bound " << value << std::endl;
             return "";
           }
-          else {
-            switch(value) {
-              case 0:
-                ret = "0";
-                break;
-              case 1:
-                ret = "1";
-                break;
-              case 2:
-                ret = "2";
-                break;
-              case 3:
-                ret = "3";
-                break;
-              case 4:
-                ret = "4";
-                break;
-              case 5:
-                ret = "5";
-                break;
-              case 6:
-                ret = "6";
-                break;
-              case 7:
-                ret = "7";
-                break;
-              case 8:
-                ret = "8";
-                break;
-              case 9:
-                ret = "9";
-                break;
-              case 10:
-                ret = "A";
-                break;
-              case 11:
-                ret = "B";
-                break;
-              case 12:
-                ret = "C";
-                break;
-              case 13:
-                ret = "D";
-                break;
-              case 14:
-                ret = "E";
-                break;
-              case 15:
-                ret = "F";
-                break;
-              default:
-                ret = "0";
-            }
-          }
-
-          return ret;
+          return std::string(1, DigitTables::HEX_DIGITS[value]);
         }
 
     }; // End of class BinaryToHex
 
     class IntToHex {
-      protected:
-        BinaryToHex bin2hex;
       public:
+        // Zero-padded to size digits; longer values keep all their digits
         std::string GetHexString(int targVal, int size) {
           std::string ret = "";
-
-          int remainingVal = targVal;
-
-          while(remainingVal != 0) {
-            int hex_digit_val = remainingVal % 16;
-            ret.insert(0, bin2hex.ConvertIntToHex(hex_digit_val));
-            remainingVal = remainingVal / 16;
-          }
-
-          if(ret.length() < size) {
-            int num_pad_digit = size - ret.length();
-
-            for(int i=0; i < num_pad_digit; i++) {
-              ret.insert(0, "0");
-            }
-          }
-
+          AppendHexString(ret, targVal, size);
           return ret;
         }
 
+        static void AppendHexString(std::string& out, int targVal, int size) {
+          uint32_t value = static_cast<uint32_t>(targVal);
+          int num_digits = std::max(size, DigitTables::GetNumHexDigits(value));
+          size_t pos = out.size();
+          out.resize(pos + num_digits);
+          DigitTables::WriteHexDigits(&out[pos], value, num_digits);
+        }
 
     }; // End of clas IntTOHex
 
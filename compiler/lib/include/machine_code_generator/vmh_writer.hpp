@@ -29,8 +29,13 @@ Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
 #include <iostream>
 #include <fstream>
 #include <memory>
-#include <stack>
 #include <utility>
+#include <algorithm>
+#include <cctype>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <sstream>
 
 #include "switch_modes.hpp"
 #include "encoding_table.hpp"
@@ -55,139 +60,133 @@ namespace MAERI {
         }
     }; // End of class VmhWriter
 
-    class RNConfigWriter : public VmhWriter {
-      protected:
-        BinaryToHex bin2hex;
-
+    // Encodes a compiled RN configuration into RN_Config.vmh words and outputBuffValid.vmh lines
+    class RNConfigEncoder {
       public:
-        RNConfigWriter(std::string filename) :
-          VmhWriter(filename) {
-          outputFile_ << "@000\n";
+        static constexpr int SWITCHES_PER_WORD = 8;
+
+        /*
+          Words reserved for each layer in a multi-layer RN_Config.vmh image:
+          CR_SGRS_ConfigAddressBound of CR_Types.bsv, i.e. ceil(DBRSes / 4) +
+          ceil(SGRSes / 4) of the full tree, which always covers the words of
+          one layer.
+        */
+        static int GetRNConfigLayerStride(int numMultSwitches) {
+          int num_levels = 0;
+          while((1 << num_levels) < numMultSwitches) {
+            num_levels++;
+          }
+          int num_sgrs = 2 * num_levels - 1;
+          int num_dbrs = ((1 << num_levels) - 1 - num_sgrs) / 2;
+          return (num_dbrs + 3) / 4 + (num_sgrs + 3) / 4;
         }
 
-        void WriteVN_Config(std::vector<std::vector<std::shared_ptr<MAERI::ReductionNetwork::DoubleReductionSwitch>>> double_reduction_switches_,
-                            std::vector<std::vector<std::shared_ptr<MAERI::ReductionNetwork::SingleReductionSwitch>>> single_reduction_switches_,
-                            std::map<int, std::pair<int, int>> DBRS_mapping,
-                            std::map<int, std::pair<int, int>> SGRS_mapping,
-                            int num_levels,
-                            int num_adder_switches) {
-          std::ofstream outputBuffValid_;
-          outputBuffValid_.open("outputBuffValid.vmh");
-          std::stack<int> stack;
-          stack.push(num_adder_switches / 2);
-          std::string line = "";
-          std::string buffid = "";
-          int count = 0;
-#ifdef DEBUG
-          std::cout << "numLvs: " << num_levels << ", num_adder_switches: " << num_adder_switches << std::endl;
-#endif
-          while (!stack.empty()) {
-            int id = stack.top();
-            stack.pop();
-            if (id == -1) {
-              continue;
-            }
-#ifdef DEBUG
-            std::cout << "id:" << id << std::endl;
-#endif
-            std::map<int, std::pair<int, int>>::iterator it;
-            it = SGRS_mapping.find(id);
-            if (it != SGRS_mapping.end()) {
-              int level = std::get<0>(SGRS_mapping[id]);
-              int pos = std::get<1>(SGRS_mapping[id]);
-#ifdef DEBUG
-              std::cout << "Level & position:" << level << ", " << pos << std::endl;
-#endif
-              if (single_reduction_switches_[level][pos]->GetGenOutput()) {
-                      outputBuffValid_ << std::to_string(id) + "\n";
-              }
-              line.append(WriteRN_SGRS_One(single_reduction_switches_[level][pos]));
-#ifdef DEBUG
-              std::cout << "ID_L: " << single_reduction_switches_[level][pos]->GetInput_ID_L() << std::endl;
-              std::cout << "ID_R: " << single_reduction_switches_[level][pos]->GetInput_ID_R() << std::endl;
-#endif
-              stack.push(single_reduction_switches_[level][pos]->GetInput_ID_L());
-              stack.push(single_reduction_switches_[level][pos]->GetInput_ID_R());
-            } else {
-              it = DBRS_mapping.find(id);
-              if (it != DBRS_mapping.end()) {
-                int level = std::get<0>(DBRS_mapping[id]);
-                int pos = std::get<1>(DBRS_mapping[id]);  
-#ifdef DEBUG
-                std::cout << "DBRS Level & position:" << level << ", " << pos << std::endl;
-#endif
-                int inorder_id_left = id - 2 * pow(2, num_levels - 1 - level);
-                it = DBRS_mapping.find(inorder_id_left);
-                std::map<int, std::pair<int, int>>::iterator it_left = SGRS_mapping.find(inorder_id_left);
-#ifdef DEBUG
-                std::cout << "inorder_id_left: " << inorder_id_left << std::endl;
-#endif
-                if (it != DBRS_mapping.end()) {
-                  int pos_left = std::get<1>(DBRS_mapping[inorder_id_left]);
-                  if (pos == pos_left) {
-                    if (double_reduction_switches_[level][pos]->GetGenOutputR()) {
-                      outputBuffValid_ << std::to_string(id) + "\n";
-                    }
-                    line.append(WriteRN_DBRS_Right(double_reduction_switches_[level][pos]));
-#ifdef DEBUG
-                    std::cout << "ID_RL: " << double_reduction_switches_[level][pos]->GetInput_ID_RL() << std::endl;
-                    std::cout << "ID_RR: " << double_reduction_switches_[level][pos]->GetInput_ID_RR() << std::endl;
-#endif
-                    stack.push(double_reduction_switches_[level][pos]->GetInput_ID_RL());
-                    stack.push(double_reduction_switches_[level][pos]->GetInput_ID_RR());
-                  } else {
-                    if (double_reduction_switches_[level][pos]->GetGenOutputL()) {
-                      outputBuffValid_ << std::to_string(id) + "\n";
-                    }
-                    line.append(WriteRN_DBRS_Left(double_reduction_switches_[level][pos]));
-#ifdef DEBUG 
-                    std::cout << "ID_LL: " << double_reduction_switches_[level][pos]->GetInput_ID_LL() << std::endl;
-                    std::cout << "ID_LR: " << double_reduction_switches_[level][pos]->GetInput_ID_LR() << std::endl;
-#endif
-                    stack.push(double_reduction_switches_[level][pos]->GetInput_ID_LL());
-                    stack.push(double_reduction_switches_[level][pos]->GetInput_ID_LR());
-                  }
-                } else if (it_left != SGRS_mapping.end()) {
-                  if (double_reduction_switches_[level][pos]->GetGenOutputL()) {
-                      outputBuffValid_ << std::to_string(id) + "\n";
+        int GetNumRNConfigWords(const MAERI::ReductionNetwork::RNConfig& rnConfig) {
+          return (static_cast<int>(rnConfig.switches_.size()) + SWITCHES_PER_WORD - 1) / SWITCHES_PER_WORD;
+        }
+
+        // Digits of one switch: the code in the low num_digits_ bits, last digit in bit 0
+        class SwitchCode {
+          public:
+            uint8_t bits_ = 0;
+            uint8_t num_digits_ = 0;
+        }; // End of class SwitchCode
+
+        static int GetSwitchCodeIndex(const MAERI::ReductionNetwork::AdderSwitchConfig& config) {
+          int mode = (config.type_ == MAERI::ReductionNetwork::SwitchType::SGRS)? static_cast<int>(config.sgrs_mode_) : static_cast<int>(config.dbrs_mode_);
+          return (static_cast<int>(config.type_) * 2 + (config.genOutput_? 1 : 0)) * 4 + mode;
+        }
+
+        // Codes of every (type, genOutput, mode), built once from the ISA encoding strings
+        static const std::array<SwitchCode, 24>& GetSwitchCodes() {
+          static const auto codes = [] {
+            std::array<SwitchCode, 24> ret;
+            RNConfigEncoder encoder;
+            MAERI::ReductionNetwork::AdderSwitchConfig config;
+            for(auto type : {MAERI::ReductionNetwork::SwitchType::SGRS, MAERI::ReductionNetwork::SwitchType::DBRS}) {
+              for(int gen_output = 0; gen_output < 2; gen_output++) {
+                for(int mode = 0; mode < 4; mode++) {
+                  config.type_ = type;
+                  config.genOutput_ = (gen_output == 1);
+                  config.sgrs_mode_ = static_cast<MAERI::ReductionNetwork::SGRS_Mode>(mode);
+                  config.dbrs_mode_ = static_cast<MAERI::ReductionNetwork::DBRS_SubMode>(mode);
+                  std::string digits = (type == MAERI::ReductionNetwork::SwitchType::SGRS)? encoder.WriteRN_SGRS_One(config) : encoder.WriteRN_DBRS_One(config);
+                  auto& code = ret[GetSwitchCodeIndex(config)];
+                  for(char digit : digits) {
+                    code.bits_ = static_cast<uint8_t>((code.bits_ << 1) | (digit == '1'? 1 : 0));
                   }
-                  line.append(WriteRN_DBRS_Left(double_reduction_switches_[level][pos]));
-#ifdef DEBUG
-                  std::cout << "ID_LL: " << double_reduction_switches_[level][pos]->GetInput_ID_LL() << std::endl;
-                  std::cout << "ID_LR: " << double_reduction_switches_[level][pos]->GetInput_ID_LR() << std::endl;
-#endif
-                  stack.push(double_reduction_switches_[level][pos]->GetInput_ID_LL());
-                  stack.push(double_reduction_switches_[level][pos]->GetInput_ID_LR());
+                  code.num_digits_ = static_cast<uint8_t>(digits.size());
                 }
               }
             }
-            if(count == 7) {
-              //Flush
-              outputFile_ << line + "\n";
-              line = "";
-              count = 0;
-            } else {
-              count++;
-            }
+            return ret;
+          }();
+          return codes;
+        }
+
+        /*
+          One CR_ConfigData word of RN_Config.vmh, bit-packed: the digits of
+          the switches at traversal positions [8 * word, 8 * word + 8) in bits
+          0..23, last digit in bit 0, and the digit count in bits 24..31.
+          This is also the RN config word encoding of configuration images.
+        */
+        uint32_t GetRNConfigWordBits(const MAERI::ReductionNetwork::RNConfig& rnConfig, int word) {
+          auto& codes = GetSwitchCodes();
+          uint32_t bits = 0;
+          uint32_t num_digits = 0;
+          int end = std::min(static_cast<int>(rnConfig.switches_.size()), (word + 1) * SWITCHES_PER_WORD);
+          for (int pos = word * SWITCHES_PER_WORD; pos < end; pos++) {
+            auto& code = codes[GetSwitchCodeIndex(rnConfig.switches_[pos])];
+            bits = (bits << code.num_digits_) | code.bits_;
+            num_digits += code.num_digits_;
           }
+          return (num_digits << 24) | bits;
+        }
+
+        // One RN_Config.vmh line: the switches at traversal positions [8 * word, 8 * word + 8)
+        std::string GetRNConfigWord(const MAERI::ReductionNetwork::RNConfig& rnConfig, int word) {
+          uint32_t packed = GetRNConfigWordBits(rnConfig, word);
+          std::string line(packed >> 24, '0');
+          DigitTables::WriteBinaryDigits(&line[0], packed, static_cast<int>(packed >> 24));
+          return line;
+        }
 
-          if(line != "") {
-            outputFile_ << line + "\n";
+        // Lines of RN_Config.vmh that follow the address header, written into one preallocated buffer
+        std::string GetRNConfigPayload(const MAERI::ReductionNetwork::RNConfig& rnConfig) {
+          int num_words = GetNumRNConfigWords(rnConfig);
+          std::string payload(static_cast<size_t>(num_words) * (3 * SWITCHES_PER_WORD + 1), '\0');
+          char* out = &payload[0];
+          for (int word = 0; word < num_words; word++) {
+            uint32_t packed = GetRNConfigWordBits(rnConfig, word);
+            int num_digits = static_cast<int>(packed >> 24);
+            // A partial last word is only flushed if it holds any switch
+            bool full = (word + 1) * SWITCHES_PER_WORD <= static_cast<int>(rnConfig.switches_.size());
+            if(full || num_digits != 0) {
+              out = DigitTables::WriteBinaryDigits(out, packed, num_digits);
+              *out++ = '\n';
+            }
           }
+          payload.resize(out - payload.data());
+          return payload;
+        }
 
+        std::string GetOutputBuffValidPayload(const MAERI::ReductionNetwork::RNConfig& rnConfig) {
+          std::string payload = "";
+          for (auto id : rnConfig.output_buff_valid_) {
+            payload += std::to_string(id) + "\n";
+          }
+          return payload;
         }
 
-        std::string WriteRN_SGRS_One(std::shared_ptr<MAERI::ReductionNetwork::SingleReductionSwitch> it) {
+        std::string WriteRN_SGRS_One(const MAERI::ReductionNetwork::AdderSwitchConfig& config) {
           std::string line = "";
-          auto mode = it->GetMode();
-          auto genOutput = it->GetGenOutput();
-          if(genOutput) {
+          if(config.genOutput_) {
             line.append("1");
           }
           else {
             line.append("0");
           }
-          switch(mode) {
+          switch(config.sgrs_mode_) {
             case ReductionNetwork::SGRS_Mode::Idle:
               line.append(ISA::SGRS_MODE_IDLE);
               break;
@@ -210,17 +209,15 @@ namespace MAERI {
           return line;
         }
 
-        std::string WriteRN_DBRS_Right(std::shared_ptr<MAERI::ReductionNetwork::DoubleReductionSwitch> it) {
+        std::string WriteRN_DBRS_One(const MAERI::ReductionNetwork::AdderSwitchConfig& config) {
           std::string line = "";
-          auto modeR = it->GetModeR();
-          auto genOutputR = it->GetGenOutputR();
-          if(genOutputR) {
+          if(config.genOutput_) {
             line.append("1");
           }
           else {
             line.append("0");
           }
-          switch(modeR) {
+          switch(config.dbrs_mode_) {
             case ReductionNetwork::DBRS_SubMode::Idle:
               line.append(ISA::DBRS_MODE_IDLE);
               break;
@@ -234,144 +231,366 @@ namespace MAERI {
               line.append(ISA::DBRS_MODE_ADDTHREE);
               break;
             default:
-              line.append(ISA::DBRS_MODE_IDLE);
+              line.append(ISA::DBRS_MODE_PADDING);
               break;
           }
 #ifdef DEBUG
-          std::cout << "DBRS_R Command:" << line << std::endl;
+          std::cout << "DBRS Command:" << line << std::endl;
 #endif
           return line;
         }
+    }; // End of class RNConfigEncoder
+
+    /*
+      Dictionary-compressed RN configuration. Uniform VN layouts repeat a few
+      distinct CR_ConfigData words across the whole tree, so every distinct
+      word is stored once in RN_Config_Dict.vmh (entry 0 is the all-zero
+      word) and RN_Config_Index.vmh holds the dictionary entry of every
+      word, INDICES_PER_WORD 8-bit indices per line, first word in the low
+      byte. The indices of layer i start at line i * GetIndexWordsPerLayer();
+      words past the end of a layer's payload use entry 0.
+      CR_RN_ConfigurationMemory built with RN_CONFIG_COMPRESSED applies
+      INDICES_PER_WORD words per cycle.
+    */
+    class RNConfigDictionaryEncoder {
+      protected:
+        IntToHex int2hex;
 
-        std::string WriteRN_DBRS_Left(std::shared_ptr<MAERI::ReductionNetwork::DoubleReductionSwitch> it) {
-          std::string line = "";
-          auto modeL = it->GetModeL();
-          auto genOutputL = it->GetGenOutputL();
-          if(genOutputL) {
-            line.append("1");
+        // Words are read with $readmemh, so words that differ only in leading zeros are the same word
+        static std::string GetKey(const std::string& word) {
+          size_t first = word.find_first_not_of('0');
+          return (first == std::string::npos)? "" : word.substr(first);
+        }
+
+      public:
+        static constexpr int INDICES_PER_WORD = 4;
+        // 8-bit indices (CR_RN_DictIdx)
+        static constexpr int MAX_DICTIONARY_WORDS = 256;
+
+        static int GetIndexWordsPerLayer(int numMultSwitches) {
+          return (RNConfigEncoder::GetRNConfigLayerStride(numMultSwitches) + INDICES_PER_WORD - 1) / INDICES_PER_WORD;
+        }
+
+        // Returns false if the layers need more than MAX_DICTIONARY_WORDS distinct words or a layer exceeds its words
+        bool Encode(const std::vector<std::vector<std::string>>& layerWords, int numMultSwitches, std::string& dictionary, std::string& indices) {
+          int layer_stride = RNConfigEncoder::GetRNConfigLayerStride(numMultSwitches);
+          std::map<std::string, int> entries = {{"", 0}};
+          dictionary = "@00\n0\n";
+          indices = "@000\n";
+
+          for(int layer = 0; layer < static_cast<int>(layerWords.size()); layer++) {
+            auto& words = layerWords[layer];
+            if(static_cast<int>(words.size()) > layer_stride) {
+              std::cerr << "ERROR: The RN config of layer " << layer << " exceeds " << layer_stride << " words" << std::endl;
+              return false;
+            }
+
+            uint32_t index_word = 0;
+            int num_words = GetIndexWordsPerLayer(numMultSwitches) * INDICES_PER_WORD;
+            for(int word = 0; word < num_words; word++) {
+              int entry = 0;
+              if(word < static_cast<int>(words.size())) {
+                auto inserted = entries.emplace(GetKey(words[word]), static_cast<int>(entries.size()));
+                if(inserted.second) {
+                  dictionary += words[word] + "\n";
+                }
+                entry = inserted.first->second;
+              }
+              index_word |= static_cast<uint32_t>(entry) << (8 * (word % INDICES_PER_WORD));
+              if(word % INDICES_PER_WORD == INDICES_PER_WORD - 1) {
+                int2hex.AppendHexString(indices, static_cast<int>(index_word), 8);
+                indices += "\n";
+                index_word = 0;
+              }
+            }
           }
-          else {
-            line.append("0");
+
+          // Large non-uniform layouts have many distinct words; RN_Config.vmh is still written
+          if(static_cast<int>(entries.size()) > MAX_DICTIONARY_WORDS) {
+            std::cerr << "ERROR: --compress-rn-config: the RN config has " << entries.size() << " distinct words, but RN_CONFIG_COMPRESSED hardware holds "
+                      << MAX_DICTIONARY_WORDS << " (CR_RN_DictIdx); compile without --compress-rn-config for this layout" << std::endl;
+            return false;
           }
-          switch(modeL) {
-            case ReductionNetwork::DBRS_SubMode::Idle:
-              line.append(ISA::DBRS_MODE_IDLE);
-              break;
-            case ReductionNetwork::DBRS_SubMode::AddOne:
-              line.append(ISA::DBRS_MODE_ADDONE);
-              break;
-            case ReductionNetwork::DBRS_SubMode::AddTwo:
-              line.append(ISA::DBRS_MODE_ADDTWO);
-              break;
-            case ReductionNetwork::DBRS_SubMode::AddThree:
-              line.append(ISA::DBRS_MODE_ADDTHREE);
-              break;
-            default:
-              line.append(ISA::DBRS_MODE_PADDING);
-              break;
+          return true;
+        }
+    }; // End of class RNConfigDictionaryEncoder
+
+    class RNConfigWriter : public VmhWriter {
+      protected:
+        BinaryToHex bin2hex;
+        RNConfigEncoder encoder_;
+        std::string outputBuffValidFilename_;
+
+        // Compressed files are only written if EnableCompression was called
+        int num_mult_switches_ = 0;
+        std::string dictionaryFilename_;
+        std::string indexFilename_;
+
+      public:
+        RNConfigWriter(std::string filename, std::string outputBuffValidFilename = "outputBuffValid.vmh") :
+          VmhWriter(filename),
+          outputBuffValidFilename_(outputBuffValidFilename) {
+          outputFile_ << "@000\n";
+        }
+
+        // Also write the payload as RN_Config_Dict.vmh and RN_Config_Index.vmh (see RNConfigDictionaryEncoder)
+        void EnableCompression(int numMultSwitches, std::string dictionaryFilename = "RN_Config_Dict.vmh", std::string indexFilename = "RN_Config_Index.vmh") {
+          num_mult_switches_ = numMultSwitches;
+          dictionaryFilename_ = dictionaryFilename;
+          indexFilename_ = indexFilename;
+        }
+
+        // Returns false only if compression is enabled and fails; RN_Config.vmh is written regardless
+        bool WritePayload(const std::string& rnConfigPayload, const std::string& outputBuffValidPayload) {
+          std::ofstream outputBuffValid_;
+          outputBuffValid_.open(outputBuffValidFilename_);
+          outputBuffValid_ << outputBuffValidPayload;
+
+          outputFile_ << rnConfigPayload;
+
+          if(num_mult_switches_ == 0) {
+            return true;
           }
-#ifdef DEBUG
-          std::cout << "DBRS_L Command:" << line << std::endl;
-#endif
-          return line;
+          std::vector<std::vector<std::string>> layerWords(1);
+          std::istringstream lines(rnConfigPayload);
+          std::string line;
+          while(std::getline(lines, line)) {
+            layerWords[0].push_back(line);
+          }
+          return WriteCompressedFiles(layerWords, num_mult_switches_, dictionaryFilename_, indexFilename_);
+        }
+
+        static bool WriteCompressedFiles(const std::vector<std::vector<std::string>>& layerWords, int numMultSwitches, std::string dictionaryFilename, std::string indexFilename) {
+          std::string dictionary, indices;
+          RNConfigDictionaryEncoder dictionaryEncoder;
+          if(!dictionaryEncoder.Encode(layerWords, numMultSwitches, dictionary, indices)) {
+            return false;
+          }
+          std::ofstream dictionaryFile(dictionaryFilename);
+          std::ofstream indexFile(indexFilename);
+          dictionaryFile << dictionary;
+          indexFile << indices;
+          return true;
+        }
+
+        bool WriteVN_Config(const MAERI::ReductionNetwork::RNConfig& rnConfig) {
+          return WritePayload(encoder_.GetRNConfigPayload(rnConfig), encoder_.GetOutputBuffValidPayload(rnConfig));
         }
     }; // End of class RNConfigWriter
 
-    class TileInfoWriter : public VmhWriter {
+    // Encodes the loop bounds and tile sizes of a layer into Layer_Info.vmh words
+    class TileInfoEncoder {
       protected:
         IntToHex int2hex;
       public:
-        TileInfoWriter(std::string filename) :
-          VmhWriter(filename) {
-          outputFile_ << "@00\n";
+        static constexpr int NUM_TILE_INFO_WORDS = 16;
+        static constexpr int VN_SIZE_WORD = 13;
+
+        // Bit 31 of the VN size word tells CR_TileInfoMemory that another layer follows
+        static std::string SetMoreLayersFlag(std::string vnSizeWord) {
+          const std::string hex_digits = "0123456789ABCDEF";
+          int top_digit = static_cast<int>(hex_digits.find(toupper(vnSizeWord[0])));
+          vnSizeWord[0] = hex_digits[top_digit | 8];
+          return vnSizeWord;
         }
 
-        void WriteTileInfo(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable, int numMultSwitches, int vnSz, int numMappedVNs) {
+        std::vector<std::string> GetTileInfoWords(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable, int numMultSwitches, int vnSz, int numMappedVNs) {
+          std::vector<std::string> words;
           std::string line = "";
-          auto loopK = loopInfoTable->FindLoops("K")->front();
-          auto loopC = loopInfoTable->FindLoops("C")->front();
-          auto loopR = loopInfoTable->FindLoops("R")->front();
-          auto loopS = loopInfoTable->FindLoops("S")->front();
-          auto loopY = loopInfoTable->FindLoops("Y")->front();
-          auto loopX = loopInfoTable->FindLoops("X")->front();
+          auto loopK = loopInfoTable->GetLoop("K");
+          auto loopC = loopInfoTable->GetLoop("C");
+          auto loopR = loopInfoTable->GetLoop("R");
+          auto loopS = loopInfoTable->GetLoop("S");
+          auto loopY = loopInfoTable->GetLoop("Y");
+          auto loopX = loopInfoTable->GetLoop("X");
+          if(!loopK || !loopC || !loopR || !loopS || !loopY || !loopX) {
+            std::cerr << "ERROR: Tile info needs the K, C, R, S, Y and X loops of the (lowered) layer" << std::endl;
+            return words;
+          }
 
           line += int2hex.GetHexString(loopK->GetBound(), 4);
           line += int2hex.GetHexString(loopK->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
           line += int2hex.GetHexString(loopK->GetBound() % loopK->GetTileSz(), 4);
           line += int2hex.GetHexString(loopK->GetBound() / loopK->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
 
           line += int2hex.GetHexString(loopC->GetBound(), 4);
           line += int2hex.GetHexString(loopC->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
           line += int2hex.GetHexString(loopC->GetBound() % loopC->GetTileSz(), 4);
           line += int2hex.GetHexString(loopC->GetBound() / loopC->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
 
           line += int2hex.GetHexString(loopR->GetBound(), 4);
           line += int2hex.GetHexString(loopR->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
           line += int2hex.GetHexString(loopR->GetBound() % loopR->GetTileSz(), 4);
           line += int2hex.GetHexString(loopR->GetBound() / loopR->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
 
           line += int2hex.GetHexString(loopS->GetBound(), 4);
           line += int2hex.GetHexString(loopS->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
           line += int2hex.GetHexString(loopS->GetBound() % loopS->GetTileSz(), 4);
           line += int2hex.GetHexString(loopS->GetBound() / loopS->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
           line += int2hex.GetHexString(loopY->GetBound(), 4);
           line += int2hex.GetHexString(loopY->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
-          line += int2hex.GetHexString((loopY->GetBound() - loopR->GetBound() +1 ) % loopY->GetTileSz(), 4);
-          line += int2hex.GetHexString((loopY->GetBound() - loopR->GetBound() +1 ) / loopY->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          line += int2hex.GetHexString(loopY->GetNumOutputs(loopR->GetBound()) % loopY->GetTileSz(), 4);
+          line += int2hex.GetHexString(loopY->GetNumOutputs(loopR->GetBound()) / loopY->GetTileSz(), 4);
+          words.push_back(line);
           line = "";
 
 
           line += int2hex.GetHexString(loopX->GetBound(), 4);
           line += int2hex.GetHexString(loopX->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
           line = "";
 
-          line += int2hex.GetHexString((loopX->GetBound() - loopS->GetBound() +1 ) % loopX->GetTileSz(), 4);
-          line += int2hex.GetHexString((loopX->GetBound() - loopS->GetBound() +1 ) / loopX->GetTileSz(), 4);
-          outputFile_ << line << "\n";
+          line += int2hex.GetHexString(loopX->GetNumOutputs(loopS->GetBound()) % loopX->GetTileSz(), 4);
+          line += int2hex.GetHexString(loopX->GetNumOutputs(loopS->GetBound()) / loopX->GetTileSz(), 4);
+          words.push_back(line);
           line = "";
 
           line += int2hex.GetHexString(numMultSwitches, 4);
           line += int2hex.GetHexString(numMappedVNs, 4);
-          outputFile_ << line << "\n";
+          words.push_back(line);
+          line = "";
+
+          // Bits 16..30 of the VN size word hold the layer type
+          line += int2hex.GetHexString(static_cast<int>(loopInfoTable->GetLayerType()), 4);
+          line += int2hex.GetHexString(vnSz, 4);
+          words.push_back(line);
           line = "";
 
-          line += int2hex.GetHexString(vnSz, 8);
-          outputFile_ << line << "\n";
+          line += int2hex.GetHexString(loopY->GetStride(), 4);
+          line += int2hex.GetHexString(loopX->GetStride(), 4);
+          words.push_back(line);
           line = "";
 
+          line += int2hex.GetHexString(loopY->GetPadding(), 4);
+          line += int2hex.GetHexString(loopX->GetPadding(), 4);
+          words.push_back(line);
+          line = "";
+
+          return words;
+        }
+
+        // The same words as integers, as ConfigImageEntry::tile_info_ holds them; empty if the loops are missing
+        std::vector<uint32_t> GetTileInfoWordBits(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable, int numMultSwitches, int vnSz, int numMappedVNs) {
+          std::vector<uint32_t> ret;
+          for(auto& word : GetTileInfoWords(loopInfoTable, numMultSwitches, vnSz, numMappedVNs)) {
+            ret.push_back(static_cast<uint32_t>(std::stoul(word, nullptr, 16)));
+          }
+          return ret;
+        }
+
+    }; // End of class TileInfoEncoder
+
+    class TileInfoWriter : public VmhWriter {
+      protected:
+        TileInfoEncoder encoder_;
+      public:
+        TileInfoWriter(std::string filename) :
+          VmhWriter(filename) {
+          outputFile_ << "@00\n";
+        }
+
+        void WriteTileInfo(const std::vector<std::string>& words) {
+          for(auto& word : words) {
+            outputFile_ << word << "\n";
+          }
+        }
+
+        void WriteTileInfo(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable, int numMultSwitches, int vnSz, int numMappedVNs) {
+          WriteTileInfo(encoder_.GetTileInfoWords(loopInfoTable, numMultSwitches, vnSz, numMappedVNs));
         }
 
     }; // End of class TileInfoWriter
 
+    // Layer_Info.vmh of a whole network: the NUM_TILE_INFO_WORDS-word records of all layers back to back
+    class MultiLayerTileInfoWriter : public VmhWriter {
+      public:
+        MultiLayerTileInfoWriter(std::string filename) :
+          VmhWriter(filename) {
+          outputFile_ << "@00\n";
+        }
+
+        void WriteLayers(const std::vector<std::vector<std::string>>& layerWords) {
+          for(int layer = 0; layer < static_cast<int>(layerWords.size()); layer++) {
+            auto words = layerWords[layer];
+            if(layer + 1 < static_cast<int>(layerWords.size())) {
+              words[TileInfoEncoder::VN_SIZE_WORD] = TileInfoEncoder::SetMoreLayersFlag(words[TileInfoEncoder::VN_SIZE_WORD]);
+            }
+            for(auto& word : words) {
+              outputFile_ << word << "\n";
+            }
+          }
+        }
+    }; // End of class MultiLayerTileInfoWriter
+
+    // RN_Config.vmh of a whole network: layer i starts at word i * GetRNConfigLayerStride()
+    class MultiLayerRNConfigWriter : public VmhWriter {
+      protected:
+        IntToHex int2hex;
+        int num_mult_switches_;
+        int layer_stride_;
+        bool compress_ = false;
+        std::string dictionaryFilename_;
+        std::string indexFilename_;
+
+      public:
+        MultiLayerRNConfigWriter(std::string filename, int numMultSwitches) :
+          VmhWriter(filename),
+          num_mult_switches_(numMultSwitches),
+          layer_stride_(RNConfigEncoder::GetRNConfigLayerStride(numMultSwitches)) {
+        }
+
+        // Also write all layers into one dictionary and index image (see RNConfigDictionaryEncoder)
+        void EnableCompression(std::string dictionaryFilename, std::string indexFilename) {
+          compress_ = true;
+          dictionaryFilename_ = dictionaryFilename;
+          indexFilename_ = indexFilename;
+        }
+
+        bool WriteLayers(const std::vector<std::vector<std::string>>& layerWords) {
+          // Addresses are as wide as the last layer's needs, and at least 3 digits
+          int num_layers = static_cast<int>(layerWords.size());
+          int address_digits = std::max(3, DigitTables::GetNumHexDigits(static_cast<uint32_t>(std::max(0, num_layers - 1) * layer_stride_)));
+          for(int layer = 0; layer < num_layers; layer++) {
+            if(static_cast<int>(layerWords[layer].size()) > layer_stride_) {
+              std::cerr << "ERROR: The RN config of layer " << layer << " exceeds " << layer_stride_ << " words" << std::endl;
+              return false;
+            }
+            outputFile_ << "@" << int2hex.GetHexString(layer * layer_stride_, address_digits) << "\n";
+            for(auto& word : layerWords[layer]) {
+              outputFile_ << word << "\n";
+            }
+          }
+          return !compress_ || RNConfigWriter::WriteCompressedFiles(layerWords, num_mult_switches_, dictionaryFilename_, indexFilename_);
+        }
+    }; // End of class MultiLayerRNConfigWriter
+
   }; // End of namesapce MachineCodeGenerator
 }; // End of namespace MAERI
 
@@ -43,6 +43,41 @@ Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
 
 namespace maestro {
 
+  /*
+    Layer types a layer file can describe (Type line). GEMM and depthwise
+    layers are lowered by LayerParser to the K, C, R, S, Y, X loop nest the
+    accelerator runs; the type is kept for Layer_Info.vmh.
+  */
+  enum class LayerType {CONV = 0, GEMM = 1, DWCONV = 2};
+
+  inline bool ParseLayerType(std::string name, LayerType& layer_type) {
+    boost::to_upper(name);
+    if(name == "CONV") {
+      layer_type = LayerType::CONV;
+    }
+    else if(name == "GEMM" || name == "FC") {
+      layer_type = LayerType::GEMM;
+    }
+    else if(name == "DWCONV" || name == "DEPTHWISE") {
+      layer_type = LayerType::DWCONV;
+    }
+    else {
+      return false;
+    }
+    return true;
+  }
+
+  inline std::string GetLayerTypeName(LayerType layer_type) {
+    switch(layer_type) {
+      case LayerType::GEMM:
+        return "GEMM";
+      case LayerType::DWCONV:
+        return "DWCONV";
+      default:
+        return "CONV";
+    }
+  }
+
   class LoopInformation {
     protected:
       int loop_id_;
@@ -51,19 +86,28 @@ namespace maestro {
       int bound_;
       int incr_;
       int tile_sz_;
+      int stride_;    // Filter window step along this (input) loop
+      int padding_;   // Zero rows/columns added to each side of this (input) loop
 
     public:
-      LoopInformation(std::string loop_var, int base, int bound, int tile_sz) :
+      LoopInformation(std::string loop_var, int base, int bound, int tile_sz, int stride = 1, int padding = 0) :
         loop_id_(-1),
         incr_(1),
         loop_var_(loop_var),
         base_(base),
         bound_(bound),
-        tile_sz_(tile_sz)
+        tile_sz_(tile_sz),
+        stride_(stride),
+        padding_(padding)
       {
         if(bound < base) {
           std::cout << "Warning: invalid loop" << std::endl;
         }
+        if(stride < 1 || padding < 0) {
+          std::cout << "Warning: invalid stride or padding of loop " << loop_var << "; using stride 1 and no padding" << std::endl;
+          stride_ = 1;
+          padding_ = 0;
+        }
       }
 
       std::string ToString() {
@@ -72,6 +116,9 @@ namespace maestro {
                                         % base_
                                         % bound_
                                         % tile_sz_);
+        if(stride_ != 1 || padding_ != 0) {
+          ret += boost::str(boost::format(", stride: %d, padding: %d") % stride_ % padding_);
+        }
         return ret;
       }
 
@@ -96,6 +143,19 @@ namespace maestro {
         return tile_sz_;
       }
 
+      int GetStride() {
+        return stride_;
+      }
+
+      int GetPadding() {
+        return padding_;
+      }
+
+      // Output extent of a filter of filter_sz sliding over the padded loop
+      int GetNumOutputs(int filter_sz) {
+        return (bound_ + 2 * padding_ - filter_sz) / stride_ + 1;
+      }
+
       int GetNumTiledNormalIter() {
         int ret = (bound_-base_) / tile_sz_;
         return ret;
@@ -111,14 +171,21 @@ namespace maestro {
   class LoopInfoTable {
     protected:
       std::shared_ptr<std::vector<std::shared_ptr<maestro::LoopInformation>>> info_table_;
+      LayerType layer_type_;
 
     public:
-      LoopInfoTable() {
+      LoopInfoTable(LayerType layer_type = LayerType::CONV) :
+        layer_type_(layer_type)
+      {
         info_table_ = std::make_shared<std::vector<std::shared_ptr<maestro::LoopInformation>>>();
       }
 
+      LayerType GetLayerType() {
+        return layer_type_;
+      }
+
       std::string ToString() {
-        std::string ret = "";
+        std::string ret = (layer_type_ == LayerType::CONV)? "" : "Layer type " + GetLayerTypeName(layer_type_) + "\n";
 
         for(auto& loop : *info_table_) {
           ret += loop->ToString() + "\n";
@@ -144,6 +211,12 @@ namespace maestro {
         return ret;
       }
 
+      // First loop over loop_var; nullptr if the layer does not describe it
+      std::shared_ptr<LoopInformation> GetLoop(std::string loop_var) {
+        auto loops = FindLoops(loop_var);
+        return loops->empty()? nullptr : loops->front();
+      }
+
       long GetTotalIterations() {
       	long ret = 1;
 
@@ -0,0 +1,524 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef MAESTRO_LAYER_FILE_PARSER_HPP_
+#define MAESTRO_LAYER_FILE_PARSER_HPP_
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "analysis-structure.hpp"
+
+namespace maestro {
+
+  // Read-only, memory-mapped contents of a file
+  class MappedFile {
+    protected:
+      const char* data_ = nullptr;
+      size_t size_ = 0;
+      bool is_open_ = false;
+      std::string error_;
+
+    public:
+      MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if(fd < 0) {
+          error_ = std::strerror(errno);
+          return;
+        }
+
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0) {
+          error_ = std::strerror(errno);
+          close(fd);
+          return;
+        }
+
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if(size_ > 0) {
+          void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+          if(addr == MAP_FAILED) {
+            error_ = std::strerror(errno);
+            size_ = 0;
+            close(fd);
+            return;
+          }
+          madvise(addr, size_, MADV_SEQUENTIAL);
+          data_ = static_cast<const char*>(addr);
+        }
+        close(fd);
+        is_open_ = true;
+      }
+
+      ~MappedFile() {
+        if(data_ != nullptr) {
+          munmap(const_cast<char*>(data_), size_);
+        }
+      }
+
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      bool IsOpen() const {
+        return is_open_;
+      }
+
+      std::string GetError() const {
+        return error_;
+      }
+
+      std::string_view GetContents() const {
+        return std::string_view(data_, size_);
+      }
+  }; // End of class MappedFile
+
+  class LayerFileError {
+    public:
+      int line_;
+      int column_;
+      std::string message_;
+
+      LayerFileError(int line, int column, std::string message) :
+        line_(line),
+        column_(column),
+        message_(message) {
+      }
+  }; // End of class LayerFileError
+
+  // One loop line; loop_var_ points into the mapped file
+  class LoopDescription {
+    public:
+      std::string_view loop_var_;
+      int bound_ = 0;
+      int tile_sz_ = 0;
+      int stride_ = 1;
+      int padding_ = 0;
+      int line_ = 0;
+  }; // End of class LoopDescription
+
+  // Loops first_loop_ .. first_loop_ + num_loops_ - 1 of the parser's loop list
+  class LayerDescription {
+    public:
+      std::string_view name_;   // Empty for a file without Layer lines
+      LayerType layer_type_ = LayerType::CONV;
+      int line_ = 1;
+      int first_loop_ = 0;
+      int num_loops_ = 0;
+  }; // End of class LayerDescription
+
+  /*
+    Single-pass parser of layer files. The file is memory-mapped and scanned
+    in place; the layers of a file share one loop list, and loop names are
+    views into the mapping, so parsing allocates per file rather than per
+    loop. Syntax, one item per line (tokens are separated by blanks or any
+    of ",->()"; # starts a comment):
+      Layer [Name]                                 starts a new layer; lines before the first Layer line form a layer of their own
+      Type CONV|GEMM|FC|DWCONV|DEPTHWISE           layer type, CONV by default
+      LoopVar Bound TileSize [Stride [Padding]]    one loop; stride and padding apply to Y and X
+    Every problem is reported with its line and column.
+    GEMM and depthwise layers are lowered to the K, C, R, S, Y, X loop nest
+    the accelerator runs:
+      GEMM:   loops M, N, K computing out[M][N] = sum over K; lowered to
+              K = N, C = ceil(K / TileK), R = 1, S = X = TileK, Y = M, so
+              every VN reduces TileK products (K is zero-padded to a
+              multiple of TileK).
+      DWCONV: loops C, R, S, Y, X; lowered to K = C, C = 1, so each VN
+              reduces one channel's window without a cross-channel loop.
+              The layer type is kept, since each VN reads its own input
+              channel (see Testbench_MAERI for what the RTL testbench does).
+  */
+  class LayerFileParser {
+    protected:
+      static constexpr int MAX_ERRORS = 20;
+      static constexpr int MAX_TOKENS = 6;
+
+      std::string file_name_;
+      MappedFile file_;
+      bool parsed_ = false;
+      bool has_explicit_layer_ = false;
+      size_t layer_first_error_ = 0;    // Errors reported before the current layer started
+
+      std::vector<LayerDescription> layers_;
+      std::vector<LoopDescription> loops_;
+      std::vector<LayerFileError> errors_;
+
+      enum CharClass : unsigned char {TOKEN_CHAR = 0, SEPARATOR = 1, LINE_END = 2};
+
+      static const CharClass* GetCharClasses() {
+        static const auto classes = [] {
+          std::array<CharClass, 256> ret;
+          ret.fill(TOKEN_CHAR);
+          for(unsigned char c : std::string_view(" \t\r,->()")) {
+            ret[c] = SEPARATOR;
+          }
+          ret[static_cast<unsigned char>('\n')] = LINE_END;
+          ret[static_cast<unsigned char>('#')] = LINE_END;
+          return ret;
+        }();
+        return classes.data();
+      }
+
+      void AddError(int line, int column, std::string message) {
+        if(static_cast<int>(errors_.size()) < MAX_ERRORS) {
+          errors_.emplace_back(line, column, message);
+        }
+      }
+
+      bool ParseInt(std::string_view token, int line, int column, const char* what, int& value) {
+        long ret = 0;
+        for(char c : token) {
+          if(c < '0' || c > '9') {
+            AddError(line, column, std::string("expected a non-negative integer ") + what + ", found '" + std::string(token) + "'");
+            return false;
+          }
+          ret = ret * 10 + (c - '0');
+          if(ret > INT_MAX) {
+            AddError(line, column, std::string(what) + " " + std::string(token) + " is too large");
+            return false;
+          }
+        }
+        value = static_cast<int>(ret);
+        return true;
+      }
+
+      const LoopDescription* FindLoop(const LayerDescription& layer, std::string_view loop_var) const {
+        for(int idx = layer.first_loop_; idx < layer.first_loop_ + layer.num_loops_; idx++) {
+          if(loops_[idx].loop_var_ == loop_var) {
+            return &loops_[idx];
+          }
+        }
+        return nullptr;
+      }
+
+      std::string GetLayerLabel(const LayerDescription& layer) const {
+        std::string ret = GetLayerTypeName(layer.layer_type_) + " layer";
+        if(!layer.name_.empty()) {
+          ret += " " + std::string(layer.name_);
+        }
+        return ret;
+      }
+
+      // Reports the loops the layer type needs but the layer lacks
+      void CheckLayer(const LayerDescription& layer) {
+        if(layer.num_loops_ == 0) {
+          AddError(layer.line_, 1, GetLayerLabel(layer) + " has no loops");
+          return;
+        }
+        // A malformed loop line was reported already
+        if(errors_.size() > layer_first_error_) {
+          return;
+        }
+
+        static const char* const conv_loops[] = {"K", "C", "R", "S", "Y", "X", nullptr};
+        static const char* const gemm_loops[] = {"M", "N", "K", nullptr};
+        static const char* const dwconv_loops[] = {"C", "R", "S", "Y", "X", nullptr};
+        const char* const* needed = (layer.layer_type_ == LayerType::GEMM)? gemm_loops
+                                    : (layer.layer_type_ == LayerType::DWCONV)? dwconv_loops : conv_loops;
+        for(; *needed != nullptr; needed++) {
+          std::string_view loop_var = *needed;
+          if(FindLoop(layer, loop_var) == nullptr) {
+            AddError(layer.line_, 1, GetLayerLabel(layer) + " does not describe loop " + std::string(loop_var));
+          }
+        }
+      }
+
+      void StartLayer(std::string_view name, int line) {
+        // A file's leading lines only form a layer if they describe something
+        if(!layers_.empty() && !has_explicit_layer_ && layers_.back().num_loops_ == 0 && layers_.back().layer_type_ == LayerType::CONV) {
+          layers_.pop_back();
+        }
+        else if(!layers_.empty()) {
+          CheckLayer(layers_.back());
+        }
+
+        layer_first_error_ = errors_.size();
+        LayerDescription layer;
+        layer.name_ = name;
+        layer.line_ = line;
+        layer.first_loop_ = static_cast<int>(loops_.size());
+        layers_.push_back(layer);
+      }
+
+      void ParseLine(std::string_view* tokens, int* columns, int num_tokens, int line) {
+        auto& layer = layers_.back();
+
+        if(tokens[0] == "Layer") {
+          if(num_tokens > 2) {
+            AddError(line, columns[2], "unexpected argument '" + std::string(tokens[2]) + "' after the layer name");
+          }
+          StartLayer((num_tokens > 1)? tokens[1] : std::string_view(), line);
+          has_explicit_layer_ = true;
+          return;
+        }
+
+        if(tokens[0] == "Type") {
+          if(num_tokens < 2) {
+            AddError(line, columns[0] + 4, "expected a layer type after Type");
+          }
+          else if(!ParseLayerType(std::string(tokens[1]), layer.layer_type_)) {
+            AddError(line, columns[1], "unknown layer type '" + std::string(tokens[1]) + "'; expected CONV, GEMM, FC, DWCONV or DEPTHWISE");
+          }
+          else if(num_tokens > 2) {
+            AddError(line, columns[2], "unexpected argument '" + std::string(tokens[2]) + "' after the layer type");
+          }
+          return;
+        }
+
+        if(num_tokens < 3) {
+          int column = columns[num_tokens - 1] + static_cast<int>(tokens[num_tokens - 1].size()) + 1;
+          AddError(line, column, "expected 'LoopVar Bound TileSize [Stride [Padding]]'");
+          return;
+        }
+        if(num_tokens > 5) {
+          AddError(line, columns[5], "unexpected argument '" + std::string(tokens[5]) + "' after the padding");
+          return;
+        }
+
+        LoopDescription loop;
+        loop.loop_var_ = tokens[0];
+        loop.line_ = line;
+        bool valid = ParseInt(tokens[1], line, columns[1], "bound", loop.bound_)
+                     & ParseInt(tokens[2], line, columns[2], "tile size", loop.tile_sz_);
+        if(num_tokens > 3) {
+          valid &= ParseInt(tokens[3], line, columns[3], "stride", loop.stride_);
+        }
+        if(num_tokens > 4) {
+          valid &= ParseInt(tokens[4], line, columns[4], "padding", loop.padding_);
+        }
+        if(!valid) {
+          return;
+        }
+
+        if(loop.bound_ < 1) {
+          AddError(line, columns[1], "the bound of loop " + std::string(loop.loop_var_) + " must be at least 1");
+        }
+        else if(loop.tile_sz_ < 1) {
+          AddError(line, columns[2], "the tile size of loop " + std::string(loop.loop_var_) + " must be at least 1");
+        }
+        else if(loop.stride_ < 1) {
+          AddError(line, columns[3], "the stride of loop " + std::string(loop.loop_var_) + " must be at least 1");
+        }
+        else if(FindLoop(layer, loop.loop_var_) != nullptr) {
+          AddError(line, columns[0], "loop " + std::string(loop.loop_var_) + " is described twice in " + GetLayerLabel(layer));
+        }
+        else {
+          loops_.push_back(loop);
+          layer.num_loops_++;
+        }
+      }
+
+      static int GetTileSz(const LoopDescription& loop, int default_tile_sz) {
+        return (loop.tile_sz_ <= loop.bound_)? loop.tile_sz_ : default_tile_sz;
+      }
+
+      static std::shared_ptr<LoopInformation> MakeLoop(std::string loop_var, int bound, int tile_sz, int stride = 1, int padding = 0) {
+        return std::make_shared<LoopInformation>(loop_var, 0, bound, tile_sz, stride, padding);
+      }
+
+    public:
+      LayerFileParser(std::string filename) :
+        file_name_(filename),
+        file_(filename) {
+      }
+
+      // Parses every layer of the file; false if the file cannot be read or has errors
+      bool Parse() {
+        if(parsed_) {
+          return errors_.empty();
+        }
+        parsed_ = true;
+
+        if(!file_.IsOpen()) {
+          AddError(0, 0, "cannot open the layer file: " + file_.GetError());
+          return false;
+        }
+
+        auto contents = file_.GetContents();
+        const char* pos = contents.data();
+        const char* end = pos + contents.size();
+
+        // Growing the lists would copy and fault in every loop again; a line holds at most one loop or layer
+        size_t num_lines = 1;
+        for(const char* nl = pos; (nl = static_cast<const char*>(std::memchr(nl, '\n', end - nl))) != nullptr; nl++) {
+          num_lines++;
+        }
+        loops_.reserve(num_lines);
+        layers_.reserve(num_lines);
+
+        std::string_view tokens[MAX_TOKENS];
+        int columns[MAX_TOKENS];
+        const CharClass* char_class = GetCharClasses();
+        auto get_class = [&](const char* p) {
+          return char_class[static_cast<unsigned char>(*p)];
+        };
+
+        StartLayer(std::string_view(), 1);
+        for(int line = 1; pos < end; line++) {
+          const char* line_begin = pos;
+          int num_tokens = 0;
+          bool too_many = false;
+
+          while(pos < end && get_class(pos) != LINE_END) {
+            if(get_class(pos) == SEPARATOR) {
+              pos++;
+              continue;
+            }
+            const char* token_begin = pos;
+            while(pos < end && get_class(pos) == TOKEN_CHAR) {
+              pos++;
+            }
+            if(num_tokens < MAX_TOKENS) {
+              tokens[num_tokens] = std::string_view(token_begin, pos - token_begin);
+              columns[num_tokens] = static_cast<int>(token_begin - line_begin) + 1;
+              num_tokens++;
+            }
+            else {
+              too_many = true;
+            }
+          }
+          // Skip a comment
+          if(pos < end && *pos != '\n') {
+            auto nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+            pos = (nl != nullptr)? nl : end;
+          }
+          pos++;
+
+          if(num_tokens == 0) {
+            continue;
+          }
+          if(too_many && tokens[0] != "Layer" && tokens[0] != "Type") {
+            AddError(line, columns[MAX_TOKENS - 1], "unexpected argument '" + std::string(tokens[MAX_TOKENS - 1]) + "' after the padding");
+            continue;
+          }
+          ParseLine(tokens, columns, num_tokens, line);
+        }
+
+        if(!has_explicit_layer_ && layers_.back().num_loops_ == 0 && layers_.back().layer_type_ == LayerType::CONV) {
+          AddError(0, 0, "the file describes no layers");
+        }
+        else {
+          CheckLayer(layers_.back());
+        }
+        return errors_.empty();
+      }
+
+      int GetNumLayers() const {
+        return static_cast<int>(layers_.size());
+      }
+
+      const std::vector<LayerDescription>& GetLayers() const {
+        return layers_;
+      }
+
+      const std::vector<LayerFileError>& GetErrors() const {
+        return errors_;
+      }
+
+      void PrintErrors(std::ostream& out = std::cerr) const {
+        for(auto& error : errors_) {
+          out << "ERROR: " << file_name_;
+          if(error.line_ > 0) {
+            out << ":" << error.line_ << ":" << error.column_;
+          }
+          out << ": " << error.message_ << std::endl;
+        }
+        if(static_cast<int>(errors_.size()) == MAX_ERRORS) {
+          out << "ERROR: " << file_name_ << ": too many errors; stopped reporting" << std::endl;
+        }
+      }
+
+      // Loop nest the accelerator runs for a layer of a successfully parsed file
+      std::shared_ptr<LoopInfoTable> GetLoopInfoTable(int layer_idx) const {
+        auto& layer = layers_[layer_idx];
+
+        if(layer.layer_type_ == LayerType::GEMM) {
+          auto& loopM = *FindLoop(layer, "M");
+          auto& loopN = *FindLoop(layer, "N");
+          auto& loopK = *FindLoop(layer, "K");
+          int tileK = GetTileSz(loopK, loopK.bound_);
+          int numKTiles = (loopK.bound_ + tileK - 1) / tileK;
+
+          auto ret = std::make_shared<LoopInfoTable>(LayerType::GEMM);
+          ret->AddLoop(MakeLoop("K", loopN.bound_, GetTileSz(loopN, 1)));
+          ret->AddLoop(MakeLoop("C", numKTiles, 1));
+          ret->AddLoop(MakeLoop("R", 1, 1));
+          ret->AddLoop(MakeLoop("S", tileK, tileK));
+          ret->AddLoop(MakeLoop("Y", loopM.bound_, GetTileSz(loopM, 1)));
+          ret->AddLoop(MakeLoop("X", tileK, 1));
+          return ret;
+        }
+
+        if(layer.layer_type_ == LayerType::DWCONV) {
+          auto& loopC = *FindLoop(layer, "C");
+          auto loopK = FindLoop(layer, "K");
+          if(loopK != nullptr && loopK->bound_ != loopC.bound_) {
+            std::cout << "[ProblemParser]Warning: K of a depthwise layer is C. Ignoring K" << std::endl;
+          }
+
+          auto ret = std::make_shared<LoopInfoTable>(LayerType::DWCONV);
+          ret->AddLoop(MakeLoop("K", loopC.bound_, GetTileSz(loopC, 1)));
+          ret->AddLoop(MakeLoop("C", 1, 1));
+          for(auto loop_var : {"R", "S", "Y", "X"}) {
+            auto& loop = *FindLoop(layer, loop_var);
+            ret->AddLoop(MakeLoop(loop_var, loop.bound_, loop.tile_sz_, loop.stride_, loop.padding_));
+          }
+          return ret;
+        }
+
+        auto ret = std::make_shared<LoopInfoTable>();
+        for(int idx = layer.first_loop_; idx < layer.first_loop_ + layer.num_loops_; idx++) {
+          auto& loop = loops_[idx];
+          ret->AddLoop(MakeLoop(std::string(loop.loop_var_), loop.bound_, loop.tile_sz_, loop.stride_, loop.padding_));
+        }
+        return ret;
+      }
+
+      std::vector<std::shared_ptr<LoopInfoTable>> GetLoopInfoTables() const {
+        std::vector<std::shared_ptr<LoopInfoTable>> ret;
+        ret.reserve(layers_.size());
+        for(int layer_idx = 0; layer_idx < GetNumLayers(); layer_idx++) {
+          ret.push_back(GetLoopInfoTable(layer_idx));
+        }
+        return ret;
+      }
+
+  }; // End of class LayerFileParser
+
+}; // End of namespace maestro
+
+#endif
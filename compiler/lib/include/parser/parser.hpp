@@ -30,11 +30,11 @@ Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
-
-#include<boost/tokenizer.hpp>
-#include<boost/format.hpp>
+#include <memory>
+#include <vector>
 
 #include "analysis-structure.hpp"
+#include "layer_file_parser.hpp"
 
 namespace maestro {
 
@@ -55,59 +55,36 @@ namespace maestro {
   }; // End of class InputParser
 
 
-  class LayerParser : public InputParser {
+  // Reads the layer files described in LayerFileParser
+  class LayerParser {
     protected:
+      LayerFileParser file_parser_;
 
     public:
       LayerParser(std::string file_nm) :
-        InputParser(file_nm)
+        file_parser_(file_nm)
       {
       }
 
+      // Loop nest of the file's first layer; nullptr, once the diagnostics are printed, if the file is malformed
       std::shared_ptr<LoopInfoTable> ParseLayer() {
-        auto prob_table = std::make_shared<LoopInfoTable>();
-        std::string line;
-
-        //Read a line of the file
-        while(std::getline(in_file_, line)) {
-          boost::char_separator<char> sep(" ,->()");
-          boost::tokenizer<boost::char_separator<char>> tokn(line, sep);
-
-          std::string loop_var;
-
-          bool saw_var = false;
-          bool saw_size = false;
-          bool saw_tile = false;
-          int size = 0;
-          int tileSz = 0;
-
-          for(auto& tok : tokn) {
-            if(!saw_var) {
-              loop_var = tok;
-              saw_var = true;
-            }
-            else if (!saw_size){
-              size = std::atoi(tok.c_str());
-              saw_size = true;
-            }
-            else if(!saw_tile) {
-              tileSz = std::atoi(tok.c_str());
-              saw_tile = true;
-            }
-            else {
-              //TODO: Update error message with a better version
-              std::cout << "[ProblemParser]Warning: Located extra arguments in problem dimension description. Ignoring extra arguments " << std::endl;
-            }
-          }
-
-          auto loop_info = std::make_shared<LoopInformation>(loop_var, 0, size, tileSz);
-          prob_table->AddLoop(loop_info);
+        if(!file_parser_.Parse()) {
+          file_parser_.PrintErrors();
+          return nullptr;
+        }
+        return file_parser_.GetLoopInfoTable(0);
+      }
 
+      // Loop nests of every layer of the file, in order; empty, once the diagnostics are printed, if the file is malformed
+      std::vector<std::shared_ptr<LoopInfoTable>> ParseLayers() {
+        if(!file_parser_.Parse()) {
+          file_parser_.PrintErrors();
+          return {};
         }
-        return prob_table;
+        return file_parser_.GetLoopInfoTables();
       }
 
-  }; // End of class ProblemParser
+  }; // End of class LayerParser
 
 
 
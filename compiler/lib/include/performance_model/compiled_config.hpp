@@ -0,0 +1,320 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_COMPILED_CONFIG_H_
+#define PM_COMPILED_CONFIG_H_
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+#include "cycle_model.hpp"
+#include "config_image.hpp"
+#include "vmh_writer.hpp"
+#include "switch_modes.hpp"
+#include "switch_config.hpp"
+#include "vn_placement.hpp"
+#include "closed_form_rn_config.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    // One layer of Layer_Info.vmh, as CR_TileInfoMemory decodes it
+    class TileInfoLayer {
+      public:
+        static constexpr int NUM_WORDS = 16;
+
+        LayerDims dims_;
+        int num_mult_switches_ = 0;
+        int num_mapped_vns_ = 0;
+        int vn_size_ = 0;
+        int layer_type_ = 0;
+        bool more_layers_ = false;
+
+        static TileInfoLayer Decode(const uint32_t* words) {
+          TileInfoLayer ret;
+          auto high = [](uint32_t word) { return static_cast<int>(word >> 16); };
+          auto low = [](uint32_t word) { return static_cast<int>(word & 0xFFFF); };
+          ret.dims_ = LayerDims(high(words[0]), high(words[2]), high(words[4]), high(words[6]), high(words[8]), high(words[10]),
+                                std::max(1, high(words[14])), std::max(1, low(words[14])), high(words[15]), low(words[15]));
+          ret.num_mult_switches_ = high(words[12]);
+          ret.num_mapped_vns_ = low(words[12]);
+          ret.vn_size_ = low(words[13]);
+          ret.layer_type_ = static_cast<int>((words[13] >> 16) & 0x7FFF);
+          ret.dims_.depthwise_ = (ret.layer_type_ == static_cast<int>(maestro::LayerType::DWCONV));
+          ret.more_layers_ = (words[13] >> 31) != 0;
+          return ret;
+        }
+
+        std::string GetLayerTypeName() const {
+          switch(layer_type_) {
+            case 0:
+              return "convolution";
+            case 1:
+              return "GEMM";
+            case 2:
+              return "depthwise convolution";
+            default:
+              return "unknown";
+          }
+        }
+    }; // End of class TileInfoLayer
+
+    /*
+      Input ports each adder rule of RN_SGRS_Datapath and RN_DBRS_Datapath
+      consumes, as a mask of in0/in1 (SGRS) or LL/LR/RL/RR (DBRS); 0 if the
+      half is idle. Half 0 is the SGRS itself or the left half of the DBRS.
+    */
+    class AdderPorts {
+      public:
+        static int Get(bool is_dbrs, const ReductionNetwork::AdderSwitchConfig& config_L, const ReductionNetwork::AdderSwitchConfig& config_R, int half) {
+          using ReductionNetwork::SGRS_Mode;
+          using ReductionNetwork::DBRS_SubMode;
+          if(!is_dbrs) {
+            switch(config_L.sgrs_mode_) {
+              case SGRS_Mode::AddTwo:
+                return 0x3;
+              case SGRS_Mode::FlowLeft:
+                return 0x1;
+              case SGRS_Mode::FlowRight:
+                return 0x2;
+              default:
+                return 0;
+            }
+          }
+          auto mode_L = config_L.dbrs_mode_;
+          auto mode_R = config_R.dbrs_mode_;
+          if(half == 0) {
+            return (mode_L == DBRS_SubMode::AddThree && (mode_R == DBRS_SubMode::AddOne || mode_R == DBRS_SubMode::Idle))? 0x7
+                   : (mode_L == DBRS_SubMode::AddTwo && mode_R != DBRS_SubMode::AddThree)? 0x3
+                   : (mode_L == DBRS_SubMode::AddOne)? 0x1 : 0;
+          }
+          // doRightThreeSum does not depend on the left mode
+          return (mode_R == DBRS_SubMode::AddThree)? 0xE
+                 : (mode_R == DBRS_SubMode::AddTwo && mode_L != DBRS_SubMode::AddThree)? 0xC
+                 : (mode_R == DBRS_SubMode::AddOne)? 0x8 : 0;
+        }
+    }; // End of class AdderPorts
+
+    /*
+      The layers of a compiled Layer_Info.vmh and RN_Config.vmh pair, as the
+      tile info and RN config memories hold them. Every layer's RN config is
+      decoded into one AdderSwitchConfig per in-order switch ID.
+    */
+    class CompiledConfig {
+      protected:
+        static bool ReadText(const std::string& filename, std::string_view& text, std::unique_ptr<maestro::MappedFile>& file) {
+          file = std::make_unique<maestro::MappedFile>(filename);
+          if(!file->IsOpen()) {
+            std::cerr << "ERROR: Failed to open " << filename << ": " << file->GetError() << std::endl;
+            return false;
+          }
+          text = file->GetContents();
+          return true;
+        }
+
+        bool LoadTileInfo(const std::string& tileInfoFile) {
+          std::unique_ptr<maestro::MappedFile> file;
+          std::string_view text;
+          std::vector<uint32_t> words;
+          if(!ReadText(tileInfoFile, text, file) || !MachineCodeGenerator::VmhCodec::ParseTileInfo(text, tileInfoFile, words)) {
+            return false;
+          }
+
+          layers_.clear();
+          for(size_t base = 0; ; base += TileInfoLayer::NUM_WORDS) {
+            if(base + TileInfoLayer::NUM_WORDS > words.size()) {
+              std::cerr << "ERROR: " << tileInfoFile << ": layer " << layers_.size() << " has fewer than " << TileInfoLayer::NUM_WORDS << " words" << std::endl;
+              return false;
+            }
+            layers_.push_back(TileInfoLayer::Decode(&words[base]));
+            if(!layers_.back().more_layers_) {
+              break;
+            }
+          }
+
+          num_mult_switches_ = layers_[0].num_mult_switches_;
+          for(int idx = 0; idx < static_cast<int>(layers_.size()); idx++) {
+            auto& layer = layers_[idx];
+            if(layer.num_mult_switches_ != num_mult_switches_) {
+              std::cerr << "ERROR: " << tileInfoFile << ": layer " << idx << " was compiled for " << layer.num_mult_switches_
+                        << " multiplier switches, layer 0 for " << num_mult_switches_ << std::endl;
+              return false;
+            }
+            auto& dims = layer.dims_;
+            if(dims.k_ < 1 || dims.c_ < 1 || dims.r_ < 1 || dims.s_ < 1 || dims.GetOutputWidth() < 1 || dims.GetOutputHeight() < 1
+               || layer.vn_size_ < 1 || layer.num_mapped_vns_ < 1 || layer.vn_size_ * layer.num_mapped_vns_ > num_mult_switches_) {
+              std::cerr << "ERROR: " << tileInfoFile << ": layer " << idx << " has an empty dimension or does not fit in the multiplier switches" << std::endl;
+              return false;
+            }
+          }
+          return true;
+        }
+
+        /*
+          Decodes the RN_Config.vmh words of one layer. The switch types and
+          the switches that emit no digits follow from the layer's VN layout,
+          so each switch's digits are matched against the codes of its type.
+        */
+        bool DecodeRNConfig(int layer, const std::vector<uint32_t>& memory, const std::vector<bool>& written, const std::string& rnConfigFile) {
+          auto& info = layers_[layer];
+          auto leaves = ReductionNetwork::VNPlacement::Place(num_mult_switches_, info.vn_size_, info.num_mapped_vns_, false);
+          if(!leaves.valid_) {
+            return false;
+          }
+          ReductionNetwork::ClosedFormRNConfigGenerator generator(num_mult_switches_);
+          auto layout = generator.Generate(leaves);
+          int num_switches = static_cast<int>(layout.switches_.size());
+
+          std::vector<int> inorder_ids(num_switches, -1);
+          for(int id = 0; id < GetNumLeaves() - 1; id++) {
+            int pos = generator.GetTraversalPosition(id);
+            if(pos >= 0) {
+              inorder_ids[pos] = id;
+            }
+          }
+
+          using Encoder = MachineCodeGenerator::RNConfigEncoder;
+          auto& codes = Encoder::GetSwitchCodes();
+          auto& configs = rn_configs_[layer];
+          configs.assign(GetNumLeaves() - 1, ReductionNetwork::AdderSwitchConfig());
+
+          for(int word = 0; word * Encoder::SWITCHES_PER_WORD < num_switches; word++) {
+            int address = layer * GetRNConfigStride() + word;
+            uint32_t bits = 0;
+            int num_digits = 0;
+            if(address < static_cast<int>(memory.size()) && written[address]) {
+              bits = memory[address] & 0xFFFFFF;
+              num_digits = static_cast<int>(memory[address] >> 24);
+            }
+
+            int end = std::min(num_switches, (word + 1) * Encoder::SWITCHES_PER_WORD);
+            int expected_digits = 0;
+            for(int pos = word * Encoder::SWITCHES_PER_WORD; pos < end; pos++) {
+              expected_digits += codes[Encoder::GetSwitchCodeIndex(layout.switches_[pos])].num_digits_;
+            }
+            if(num_digits != expected_digits) {
+              std::cerr << "ERROR: " << rnConfigFile << ": word " << address << " has " << num_digits << " digits; the VN layout of layer "
+                        << layer << " (VN size " << info.vn_size_ << ", " << info.num_mapped_vns_ << " VNs) needs " << expected_digits << std::endl;
+              return false;
+            }
+
+            for(int pos = word * Encoder::SWITCHES_PER_WORD; pos < end; pos++) {
+              auto config = layout.switches_[pos];
+              int switch_digits = codes[Encoder::GetSwitchCodeIndex(config)].num_digits_;
+              if(switch_digits == 0) {
+                continue;
+              }
+              num_digits -= switch_digits;
+              uint32_t code = (bits >> num_digits) & ((1u << switch_digits) - 1);
+
+              bool found = false;
+              for(int gen_output = 0; gen_output < 2 && !found; gen_output++) {
+                for(int mode = 0; mode < 4 && !found; mode++) {
+                  config.genOutput_ = (gen_output == 1);
+                  if(config.type_ == ReductionNetwork::SwitchType::SGRS) {
+                    config.sgrs_mode_ = static_cast<ReductionNetwork::SGRS_Mode>(mode);
+                  }
+                  else {
+                    config.dbrs_mode_ = static_cast<ReductionNetwork::DBRS_SubMode>(mode);
+                  }
+                  auto& candidate = codes[Encoder::GetSwitchCodeIndex(config)];
+                  found = (candidate.num_digits_ == switch_digits && candidate.bits_ == code);
+                }
+              }
+              if(!found) {
+                std::cerr << "ERROR: " << rnConfigFile << ": word " << address << " holds an unknown switch code" << std::endl;
+                return false;
+              }
+              configs[inorder_ids[pos]] = config;
+            }
+          }
+          return true;
+        }
+
+        bool LoadRNConfig(const std::string& rnConfigFile) {
+          std::unique_ptr<maestro::MappedFile> file;
+          std::string_view text;
+          std::vector<uint32_t> words;
+          if(!ReadText(rnConfigFile, text, file) || !MachineCodeGenerator::VmhCodec::ParseRNConfig(text, rnConfigFile, words)) {
+            return false;
+          }
+
+          // The words as CR_RN_ConfigMemory holds them
+          std::vector<uint32_t> memory;
+          std::vector<bool> written;
+          int address = 0;
+          for(auto word : words) {
+            if(word & 0x80000000u) {
+              address = static_cast<int>(word & 0xFFFFFF);
+              continue;
+            }
+            if(address >= static_cast<int>(memory.size())) {
+              memory.resize(address + 1, 0);
+              written.resize(address + 1, false);
+            }
+            memory[address] = word;
+            written[address] = true;
+            address++;
+          }
+
+          rn_configs_.assign(layers_.size(), std::vector<ReductionNetwork::AdderSwitchConfig>());
+          for(int layer = 0; layer < static_cast<int>(layers_.size()); layer++) {
+            if(!DecodeRNConfig(layer, memory, written, rnConfigFile)) {
+              return false;
+            }
+          }
+          return true;
+        }
+
+      public:
+        int num_mult_switches_ = 0;
+        std::vector<TileInfoLayer> layers_;
+        std::vector<std::vector<ReductionNetwork::AdderSwitchConfig>> rn_configs_;   // Per layer, by in-order ID
+
+        bool Load(const std::string& rnConfigFile, const std::string& tileInfoFile) {
+          return LoadTileInfo(tileInfoFile) && LoadRNConfig(rnConfigFile);
+        }
+
+        // Words of RN_Config.vmh reserved for each layer
+        int GetRNConfigStride() const {
+          return MachineCodeGenerator::RNConfigEncoder::GetRNConfigLayerStride(num_mult_switches_);
+        }
+
+        int GetNumLeaves() const {
+          return ReductionNetwork::TreeShape::NextPowerOfTwo(num_mult_switches_);
+        }
+
+    }; // End of class CompiledConfig
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
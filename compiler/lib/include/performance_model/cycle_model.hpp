@@ -0,0 +1,517 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_CYCLE_MODEL_H_
+#define PM_CYCLE_MODEL_H_
+
+#include <iostream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "analysis-structure.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    // Parameters of AcceleratorConfig.bsv
+    class HardwareParams {
+      public:
+        int num_mult_switches_;
+        int distribution_bandwidth_;
+        int collection_bandwidth_;
+
+        HardwareParams(int numMultSwitches, int distributionBandwidth, int collectionBandwidth) :
+          num_mult_switches_(numMultSwitches),
+          distribution_bandwidth_(distributionBandwidth),
+          collection_bandwidth_(collectionBandwidth) {
+        }
+
+        bool IsValid() const {
+          return num_mult_switches_ > 0
+                 && distribution_bandwidth_ > 0 && distribution_bandwidth_ <= num_mult_switches_
+                 && num_mult_switches_ % distribution_bandwidth_ == 0
+                 && collection_bandwidth_ > 0 && collection_bandwidth_ <= num_mult_switches_;
+        }
+    }; // End of class HardwareParams
+
+    /*
+      Calibration constants, in cycles, checked against CycleSimulator
+      (--simulate). That check is circular: CycleSimulator models the same
+      pipeline, and neither has been compared with a Bluesim run of
+      Testbench_MAERI, so the model is unvalidated against the hardware.
+      scripts/check_rtl prints the estimate next to the Bluesim runtime of
+      its single-layer runs. The stage latencies count the register and pipeline FIFO
+      stages of the RTL: tile info loading (two words per dimension plus the
+      mapping words), the DN top and subtree ingress FIFOs, the MS forwarding
+      FIFO per filter column, the ingress and egress FIFOs of every reduction
+      switch level, and the collection bus ingress FIFO. A DN subtree
+      delivers one packet every dn_subtree_interval_ cycles, and its queues
+      absorb dn_queue_credit_ cycles of packets before it throttles the
+      traffic generator.
+    */
+    class PipelineLatency {
+      public:
+        int tile_info_load_ = 14;
+        int dn_ = 2;
+        int mn_ = 1;
+        int rn_per_level_ = 2;
+        int collection_bus_ = 1;
+        int dn_subtree_interval_ = 2;
+        int dn_queue_credit_ = 9;
+    }; // End of class PipelineLatency
+
+    class LayerDims {
+      public:
+        int k_ = 0, c_ = 0, r_ = 0, s_ = 0, y_ = 0, x_ = 0;
+        int stride_y_ = 1, stride_x_ = 1, pad_y_ = 0, pad_x_ = 0;
+        bool depthwise_ = false;   // K = C after lowering; every output channel reads its own input channel
+
+        LayerDims() {}
+
+        LayerDims(int k, int c, int r, int s, int y, int x, int stride_y = 1, int stride_x = 1, int pad_y = 0, int pad_x = 0) :
+          k_(k), c_(c), r_(r), s_(s), y_(y), x_(x),
+          stride_y_(stride_y), stride_x_(stride_x), pad_y_(pad_y), pad_x_(pad_x) {
+        }
+
+        static LayerDims FromLoopInfoTable(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable) {
+          auto loopY = loopInfoTable->FindLoops("Y")->front();
+          auto loopX = loopInfoTable->FindLoops("X")->front();
+          LayerDims ret(loopInfoTable->FindLoops("K")->front()->GetBound(),
+                        loopInfoTable->FindLoops("C")->front()->GetBound(),
+                        loopInfoTable->FindLoops("R")->front()->GetBound(),
+                        loopInfoTable->FindLoops("S")->front()->GetBound(),
+                        loopY->GetBound(),
+                        loopX->GetBound(),
+                        loopY->GetStride(), loopX->GetStride(),
+                        loopY->GetPadding(), loopX->GetPadding());
+          ret.depthwise_ = (loopInfoTable->GetLayerType() == maestro::LayerType::DWCONV);
+          return ret;
+        }
+
+        // Tile sizes of the layer file; Y and X tiles count output rows and columns as in Layer_Info.vmh
+        static LayerDims TilesFromLoopInfoTable(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable) {
+          return LayerDims(loopInfoTable->FindLoops("K")->front()->GetTileSz(),
+                           loopInfoTable->FindLoops("C")->front()->GetTileSz(),
+                           loopInfoTable->FindLoops("R")->front()->GetTileSz(),
+                           loopInfoTable->FindLoops("S")->front()->GetTileSz(),
+                           loopInfoTable->FindLoops("Y")->front()->GetTileSz(),
+                           loopInfoTable->FindLoops("X")->front()->GetTileSz());
+        }
+
+        int GetOutputWidth() const {
+          return (x_ + 2 * pad_x_ - s_) / stride_x_ + 1;
+        }
+
+        int GetOutputHeight() const {
+          return (y_ + 2 * pad_y_ - r_) / stride_y_ + 1;
+        }
+    }; // End of class LayerDims
+
+    // Cycles spent in each TrafficGenStatus of Testbench_MAERI, summed over the layer
+    class PhaseCycles {
+      public:
+        long tile_info_load_ = 0;
+        long weight_init_config_ = 0;
+        long weight_init_data_ = 0;
+        long init_weight_transfer_ = 0;
+        long input_init_config_ = 0;
+        long input_init_data_ = 0;
+        long init_input_transfer_ = 0;
+        long steady_state_ = 0;
+        long row_transition_ = 0;
+        long output_channel_transition_ = 0;
+        long input_channel_transition_ = 0;
+        long finish_ = 0;
+
+        long GetTotal() const {
+          return tile_info_load_ + weight_init_config_ + weight_init_data_ + init_weight_transfer_
+                 + input_init_config_ + input_init_data_ + init_input_transfer_ + steady_state_
+                 + row_transition_ + output_channel_transition_ + input_channel_transition_ + finish_;
+        }
+    }; // End of class PhaseCycles
+
+    // Counterparts of the statistics Testbench_MAERI prints on termination
+    class CycleEstimate {
+      public:
+        bool valid_ = false;
+        long total_cycles_ = 0;
+        PhaseCycles phases_;
+
+        long num_injected_weights_ = 0;
+        long num_injected_inputs_ = 0;
+        long num_injected_unique_inputs_ = 0;
+        long num_input_multicasts_ = 0;
+        long num_received_psums_ = 0;
+        long num_generated_psums_ = 0;
+        long num_ops_ = 0;
+
+        // The testbench reports its runtime assuming a 1GHz clock
+        double GetRuntimeMicroseconds(double clock_ghz = 1.0) const {
+          return total_cycles_ / clock_ghz / 1000.0;
+        }
+
+        void Print(std::ostream& out = std::cout) const {
+          out << "Estimated total runtime: " << total_cycles_ << " cycles (" << GetRuntimeMicroseconds() << " us at 1GHz)" << std::endl;
+          out << "  TileInfoLoad: " << phases_.tile_info_load_ << std::endl;
+          out << "  WeightInitConfig: " << phases_.weight_init_config_ << std::endl;
+          out << "  WeightInitData: " << phases_.weight_init_data_ << std::endl;
+          out << "  InitWeightTransfer: " << phases_.init_weight_transfer_ << std::endl;
+          out << "  InputInitConfig: " << phases_.input_init_config_ << std::endl;
+          out << "  InputInitData: " << phases_.input_init_data_ << std::endl;
+          out << "  InitInputTransfer: " << phases_.init_input_transfer_ << std::endl;
+          out << "  SteadyState: " << phases_.steady_state_ << std::endl;
+          out << "  RowTransition: " << phases_.row_transition_ << std::endl;
+          out << "  OutputChannelTransition: " << phases_.output_channel_transition_ << std::endl;
+          out << "  InputChannelTransition: " << phases_.input_channel_transition_ << std::endl;
+          out << "  Finish: " << phases_.finish_ << std::endl;
+          out << "Number of injected weights: " << num_injected_weights_ << std::endl;
+          out << "Number of injected inputs: " << num_injected_inputs_ << std::endl;
+          out << "Number of injected unique inputs: " << num_injected_unique_inputs_ << std::endl;
+          out << "Number of input multicasting: " << num_input_multicasts_ << std::endl;
+          out << "Number of received partial outputs: " << num_received_psums_ << std::endl;
+          out << "Number of generated partial sums: " << num_generated_psums_ << std::endl;
+          out << "Number of performed Ops (Multiplication and Addition): " << num_ops_ << std::endl;
+        }
+    }; // End of class CycleEstimate
+
+    /*
+      Analytical model of Testbench_MAERI's dataflow (tMap C, sMap K over the
+      mapped VNs, tMap Y, X, R, S). For every input channel and every tile of
+      mapped VNs along K, the weights are loaded, and every output row loads
+      its first window (VNSize cycles) and then slides over X, injecting one
+      input column per filter row (R cycles per output). With a horizontal
+      stride the window cannot slide, so every output reloads its window
+      instead; a vertical stride only skips rows, and padding widens the
+      input. Every injection waits for the DN to empty, which takes longer
+      the more of it queues in one subtree. The VNs of a depthwise layer
+      read different input channels, so a beat carries one packet per VN and
+      is split when several of its VNs share a DN subtree. Outputs leave through
+      CollectionBandwidth buses; outputs the buses could not drain while the
+      row was injected queue up, and transition states wait for them and
+      for the last output of the row or tile to come out of the DN-MN-RN
+      pipeline. The injected traffic counts follow the testbench counters
+      exactly.
+    */
+    class AnalyticalCycleModel {
+      protected:
+        HardwareParams hw_;
+        PipelineLatency latency_;
+
+        static long CeilDiv(long a, long b) {
+          return (a + b - 1) / b;
+        }
+
+        // Levels of adders a VN climbs before it is fully reduced
+        static int GetReductionLevels(int vn_size) {
+          int vn_levels = 0;
+          while((1 << vn_levels) < vn_size) {
+            vn_levels++;
+          }
+          return std::max(1, vn_levels);
+        }
+
+        // Cycles from the last injected input, forwarded across the filter columns, to the last collected output of num_vns VNs
+        long GetDrainCycles(const LayerDims& dims, int vn_size, int num_vns) {
+          return latency_.mn_ * std::max(1, dims.s_) + latency_.rn_per_level_ * GetReductionLevels(vn_size)
+                 + latency_.collection_bus_ + CeilDiv(num_vns, hw_.collection_bandwidth_);
+        }
+
+        // Windows loaded through InputInitData per output row
+        static long GetNumInits(const LayerDims& dims) {
+          return (dims.stride_x_ > 1)? dims.GetOutputWidth() : 1;
+        }
+
+        // Sliding steps after the first window of an output row
+        static long GetNumSteps(const LayerDims& dims) {
+          return (dims.stride_x_ > 1)? 0 : dims.GetOutputWidth() - 1;
+        }
+
+        /*
+          Packets each DN subtree takes for one beat to the MSes is_target
+          selects: one, or one per VN for depthwise layers, whose VNs read
+          different input channels and so cannot share a multicast packet.
+        */
+        std::vector<int> GetSubtreePackets(const LayerDims& dims, int vn_size, int num_vns, const std::function<bool(int)>& is_target) {
+          int subtree_size = hw_.num_mult_switches_ / hw_.distribution_bandwidth_;
+          std::vector<int> packets(hw_.distribution_bandwidth_, 0);
+          std::vector<int> last_vn(hw_.distribution_bandwidth_, -1);
+          for(int ms = 0; ms < vn_size * num_vns; ms++) {
+            int subtree = ms / subtree_size;
+            if(is_target(ms) && (packets[subtree] == 0 || (dims.depthwise_ && ms / vn_size != last_vn[subtree]))) {
+              packets[subtree]++;
+              last_vn[subtree] = ms / vn_size;
+            }
+          }
+          return packets;
+        }
+
+        // Beats that carry the packets of GetSubtreePackets; the testbench injects at least one per cycle
+        static long GetNumBeats(const std::vector<int>& packets) {
+          return std::max(1, *std::max_element(packets.begin(), packets.end()));
+        }
+
+        // Beats of one sliding step, and the most packets a DN subtree takes in it
+        void GetStepTraffic(const LayerDims& dims, int vn_size, int num_vns, long& num_beats, long& max_packets) {
+          int dim_s = std::max(1, dims.s_);
+          std::vector<long> step_packets(hw_.distribution_bandwidth_, 0);
+          num_beats = 0;
+          for(int row = 0; row < dims.r_; row++) {
+            auto packets = GetSubtreePackets(dims, vn_size, num_vns, [&](int ms) { return (ms / dim_s) % dims.r_ == row && ms % dim_s == 0; });
+            num_beats += GetNumBeats(packets);
+            for(int subtree = 0; subtree < hw_.distribution_bandwidth_; subtree++) {
+              step_packets[subtree] += packets[subtree];
+            }
+          }
+          max_packets = *std::max_element(step_packets.begin(), step_packets.end());
+        }
+
+        // Cycles of the sliding steps of one output row: one per beat, or the busiest subtree's packets once the DN queues fill
+        long GetSteadyStateCycles(const LayerDims& dims, int vn_size, int num_vns) {
+          long num_steps = GetNumSteps(dims);
+          long num_beats, max_packets;
+          GetStepTraffic(dims, vn_size, num_vns, num_beats, max_packets);
+          long subtree_cycles = latency_.dn_subtree_interval_ * max_packets;
+          if(subtree_cycles <= num_beats) {
+            return num_steps * num_beats;
+          }
+          return std::max(num_steps * num_beats, num_steps * subtree_cycles - latency_.dn_queue_credit_);
+        }
+
+        // Cycles the DN queues still hold at the end of the sliding steps
+        long GetSteadyStateBacklog(const LayerDims& dims, int vn_size, int num_vns) {
+          long num_steps = GetNumSteps(dims);
+          long num_beats, max_packets;
+          GetStepTraffic(dims, vn_size, num_vns, num_beats, max_packets);
+          return num_steps * std::max<long>(num_beats, latency_.dn_subtree_interval_ * max_packets) - GetSteadyStateCycles(dims, vn_size, num_vns);
+        }
+
+        // Cycles the DN queues hold after the weights are injected: the first subtree takes one weight per MS
+        long GetWeightBacklog(int vn_size, int num_vns) {
+          int subtree_size = hw_.num_mult_switches_ / hw_.distribution_bandwidth_;
+          long num_weights = std::min(subtree_size, vn_size * num_vns);
+          return std::max<long>(0, latency_.dn_subtree_interval_ * num_weights - subtree_size);
+        }
+
+        // Beats of one window load, one MS offset of every VN at a time
+        long GetWindowBeats(const LayerDims& dims, int vn_size, int num_vns) {
+          long num_beats = 0;
+          for(int offset = 0; offset < vn_size; offset++) {
+            num_beats += GetNumBeats(GetSubtreePackets(dims, vn_size, num_vns, [&](int ms) { return ms % vn_size == offset; }));
+          }
+          return num_beats;
+        }
+
+        // Cycles the DN queues hold after a window is injected
+        long GetWindowBacklog(const LayerDims& dims, int vn_size, int num_vns) {
+          std::vector<long> subtree_free(hw_.distribution_bandwidth_, 0);
+          long last_free = 0;
+          long cycle = 0;
+          for(int offset = 0; offset < vn_size; offset++) {
+            auto packets = GetSubtreePackets(dims, vn_size, num_vns, [&](int ms) { return ms % vn_size == offset; });
+            for(long beat = 0; beat < GetNumBeats(packets); beat++, cycle++) {
+              for(int subtree = 0; subtree < hw_.distribution_bandwidth_; subtree++) {
+                if(packets[subtree] > beat) {
+                  subtree_free[subtree] = std::max(subtree_free[subtree], cycle) + latency_.dn_subtree_interval_;
+                  last_free = std::max(last_free, subtree_free[subtree]);
+                }
+              }
+            }
+          }
+          return std::max<long>(0, last_free - cycle);
+        }
+
+        // Cycles that the outputs of an output row outlast its injection on the collection buses
+        long GetRowBacklog(const LayerDims& dims, int vn_size, int num_vns) {
+          long num_outputs = static_cast<long>(num_vns) * dims.GetOutputWidth();
+          long inject_cycles = GetNumInits(dims) * GetWindowBeats(dims, vn_size, num_vns) + GetSteadyStateCycles(dims, vn_size, num_vns);
+          return std::max<long>(0, CeilDiv(num_outputs, hw_.collection_bandwidth_) - inject_cycles - CeilDiv(num_vns, hw_.collection_bandwidth_));
+        }
+
+        // Wait of a transition state after the last row of num_vns VNs
+        long GetTransitionCycles(const LayerDims& dims, int vn_size, int num_vns) {
+          return GetDrainCycles(dims, vn_size, num_vns) + std::max(GetSteadyStateBacklog(dims, vn_size, num_vns), GetRowBacklog(dims, vn_size, num_vns));
+        }
+
+        // Adds one input channel's pass over a tile of num_vns VNs along K, except for its final transition
+        void AddTile(CycleEstimate& est, const LayerDims& dims, int vn_size, int num_vns, bool count_unique) {
+          long num_active = static_cast<long>(num_vns) * vn_size;
+          long dim_s = (dims.s_ > 0)? dims.s_ : 1;
+          long num_rows = dims.GetOutputHeight();
+          long num_inits = GetNumInits(dims);
+          long num_steps = GetNumSteps(dims);
+          long inputs_per_step = CeilDiv(num_active, dim_s);
+          long window_beats = GetWindowBeats(dims, vn_size, num_vns);
+          long step_beats, max_step_packets;
+          GetStepTraffic(dims, vn_size, num_vns, step_beats, max_step_packets);
+          // Every VN of a depthwise layer reads its own channel
+          long channels_per_input = dims.depthwise_? num_vns : 1;
+          // The DN empties after the packets queued in its busiest subtree
+          long weight_wait = latency_.dn_ + GetWeightBacklog(vn_size, num_vns);
+          long input_wait = latency_.dn_ + GetWindowBacklog(dims, vn_size, num_vns);
+
+          est.phases_.weight_init_config_ += 1;
+          est.phases_.weight_init_data_ += hw_.num_mult_switches_ / hw_.distribution_bandwidth_;
+          est.phases_.init_weight_transfer_ += weight_wait;
+          est.num_injected_weights_ += std::min<long>(num_active, hw_.num_mult_switches_);
+
+          est.phases_.input_init_config_ += num_rows * num_inits;
+          est.phases_.input_init_data_ += num_rows * num_inits * window_beats;
+          est.phases_.init_input_transfer_ += num_rows * num_inits * input_wait;
+          est.phases_.steady_state_ += num_rows * GetSteadyStateCycles(dims, vn_size, num_vns);
+          est.phases_.row_transition_ += (num_rows - 1) * GetTransitionCycles(dims, vn_size, num_vns);
+
+          est.num_injected_inputs_ += num_rows * (num_inits * num_active + num_steps * inputs_per_step);
+          est.num_input_multicasts_ += num_rows * num_steps * step_beats;
+          if(count_unique) {
+            // The first row streams every input; later rows only their new filter row
+            est.num_injected_unique_inputs_ += channels_per_input * (num_inits * vn_size + num_steps * std::min<long>(dims.r_, inputs_per_step));
+            est.num_injected_unique_inputs_ += channels_per_input * (num_rows - 1) * (num_inits * dims.s_ + ((inputs_per_step >= dims.r_)? num_steps : 0));
+          }
+        }
+
+      public:
+        AnalyticalCycleModel(HardwareParams hw, PipelineLatency latency = PipelineLatency()) :
+          hw_(hw),
+          latency_(latency) {
+        }
+
+        CycleEstimate Estimate(const LayerDims& dims, int vn_size, int num_mapped_vns) {
+          CycleEstimate est;
+          if(!hw_.IsValid()) {
+            std::cerr << "ERROR: Invalid accelerator parameters for the cycle model" << std::endl;
+            return est;
+          }
+          if(vn_size < 1 || num_mapped_vns < 1 || static_cast<long>(vn_size) * num_mapped_vns > hw_.num_mult_switches_) {
+            std::cerr << "ERROR: The VN mapping does not fit in " << hw_.num_mult_switches_ << " multiplier switches" << std::endl;
+            return est;
+          }
+          if(dims.k_ < 1 || dims.c_ < 1 || dims.r_ < 1 || dims.GetOutputWidth() < 1 || dims.GetOutputHeight() < 1) {
+            std::cerr << "ERROR: The layer has no outputs to estimate" << std::endl;
+            return est;
+          }
+
+          // Every input channel repeats the same K tiles; the last one has the remaining VNs
+          int num_full_tiles = dims.k_ / num_mapped_vns;
+          int edge_vns = dims.k_ % num_mapped_vns;
+          int num_tiles = num_full_tiles + ((edge_vns > 0)? 1 : 0);
+          int last_vns = (edge_vns > 0)? edge_vns : num_mapped_vns;
+
+          CycleEstimate first, rest;
+          AddTile(first, dims, vn_size, (num_full_tiles > 0)? num_mapped_vns : edge_vns, true);
+          if(num_full_tiles > 1) {
+            AddTile(rest, dims, vn_size, num_mapped_vns, false);
+          }
+
+          auto accumulate = [&](const CycleEstimate& tile, long times) {
+            est.phases_.weight_init_config_ += times * tile.phases_.weight_init_config_;
+            est.phases_.weight_init_data_ += times * tile.phases_.weight_init_data_;
+            est.phases_.init_weight_transfer_ += times * tile.phases_.init_weight_transfer_;
+            est.phases_.input_init_config_ += times * tile.phases_.input_init_config_;
+            est.phases_.input_init_data_ += times * tile.phases_.input_init_data_;
+            est.phases_.init_input_transfer_ += times * tile.phases_.init_input_transfer_;
+            est.phases_.steady_state_ += times * tile.phases_.steady_state_;
+            est.phases_.row_transition_ += times * tile.phases_.row_transition_;
+            est.num_injected_weights_ += times * tile.num_injected_weights_;
+            est.num_injected_inputs_ += times * tile.num_injected_inputs_;
+            est.num_injected_unique_inputs_ += times * tile.num_injected_unique_inputs_;
+            est.num_input_multicasts_ += times * tile.num_input_multicasts_;
+          };
+
+          long num_channels = dims.c_;
+          accumulate(first, num_channels);
+          if(num_full_tiles > 1) {
+            accumulate(rest, num_channels * (num_full_tiles - 1));
+          }
+          if(num_full_tiles > 0 && edge_vns > 0) {
+            CycleEstimate edge;
+            AddTile(edge, dims, vn_size, edge_vns, false);
+            accumulate(edge, num_channels);
+          }
+
+          // The last row of a tile waits for the whole tile; the last tile of a channel for the whole channel
+          est.phases_.output_channel_transition_ = num_channels * (num_tiles - 1) * GetTransitionCycles(dims, vn_size, num_mapped_vns);
+          est.phases_.input_channel_transition_ = (num_channels - 1) * GetTransitionCycles(dims, vn_size, last_vns);
+          est.phases_.finish_ = GetTransitionCycles(dims, vn_size, last_vns);
+          est.phases_.tile_info_load_ = latency_.tile_info_load_;
+
+          est.num_received_psums_ = static_cast<long>(dims.k_) * dims.c_ * dims.GetOutputHeight() * dims.GetOutputWidth();
+          est.num_generated_psums_ = est.num_received_psums_ * vn_size;
+          est.num_ops_ = est.num_received_psums_ * (2 * vn_size - 1);
+
+          est.total_cycles_ = est.phases_.GetTotal();
+          est.valid_ = true;
+          return est;
+        }
+
+        CycleEstimate Estimate(std::shared_ptr<maestro::LoopInfoTable> loopInfoTable, int vn_size, int num_mapped_vns) {
+          return Estimate(LayerDims::FromLoopInfoTable(loopInfoTable), vn_size, num_mapped_vns);
+        }
+
+        // A VN reduces a C x R x S tile
+        static int GetTiledVNSize(const LayerDims& tiles) {
+          return tiles.c_ * tiles.r_ * tiles.s_;
+        }
+
+        // VNs are mapped spatially over a K x Y x X tile
+        static int GetTiledVNNum(const LayerDims& tiles) {
+          return tiles.k_ * tiles.y_ * tiles.x_;
+        }
+
+        /*
+          Estimate of a tiled mapping, expressed as the testbench dataflow on an
+          equivalent layer: every C/R/S fold is a pass like one input channel
+          of the testbench, the filter window is the R x S tile, and the Y and
+          X tiles multiply the VNs of a K tile while dividing the output rows
+          and columns. Untiled R/S, unit C/Y/X tiles and a K tile of VNNum give
+          Estimate(dims, R * S, VNNum).
+        */
+        CycleEstimate EstimateTiled(const LayerDims& dims, const LayerDims& tiles) {
+          if(tiles.k_ < 1 || tiles.c_ < 1 || tiles.r_ < 1 || tiles.s_ < 1 || tiles.y_ < 1 || tiles.x_ < 1
+             || tiles.k_ > dims.k_ || tiles.c_ > dims.c_ || tiles.r_ > dims.r_ || tiles.s_ > dims.s_
+             || tiles.y_ > dims.GetOutputHeight() || tiles.x_ > dims.GetOutputWidth()) {
+            std::cerr << "ERROR: Tile sizes must be between 1 and the dimension size" << std::endl;
+            return CycleEstimate();
+          }
+
+          int num_folds = CeilDiv(dims.c_, tiles.c_) * CeilDiv(dims.r_, tiles.r_) * CeilDiv(dims.s_, tiles.s_);
+          int output_height = CeilDiv(dims.GetOutputHeight(), tiles.y_);
+          int output_width = CeilDiv(dims.GetOutputWidth(), tiles.x_);
+          LayerDims pass(dims.k_ * tiles.y_ * tiles.x_, num_folds, tiles.r_, tiles.s_,
+                         (output_height - 1) * dims.stride_y_ + tiles.r_, (output_width - 1) * dims.stride_x_ + tiles.s_,
+                         dims.stride_y_, dims.stride_x_);
+          pass.depthwise_ = dims.depthwise_;
+          return Estimate(pass, GetTiledVNSize(tiles), GetTiledVNNum(tiles));
+        }
+
+    }; // End of class AnalyticalCycleModel
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
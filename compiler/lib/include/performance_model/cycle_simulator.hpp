@@ -0,0 +1,1037 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_CYCLE_SIMULATOR_H_
+#define PM_CYCLE_SIMULATOR_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+
+#include "cycle_model.hpp"
+#include "compiled_config.hpp"
+#include "rn_add_schedule.hpp"
+#include "switch_config.hpp"
+#include "tree_shape.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    // Occupancy of one RTL FIFO; an entry enqueued in a cycle can be dequeued from the next cycle on
+    class SimFifo {
+      public:
+        int capacity_ = 1;
+        int visible_ = 0;
+        int pending_ = 0;
+
+        bool CanEnq() const {
+          return visible_ + pending_ < capacity_;
+        }
+
+        bool CanDeq() const {
+          return visible_ > 0;
+        }
+
+        bool IsEmpty() const {
+          return visible_ + pending_ == 0;
+        }
+
+        void Enq() {
+          pending_++;
+        }
+
+        void Deq() {
+          visible_--;
+        }
+
+        void Commit() {
+          visible_ += pending_;
+          pending_ = 0;
+        }
+    }; // End of class SimFifo
+
+    // States of MN_MultiplierSwitch (MN_Types.bsv)
+    enum class SimMSState {Idle, InitSteadyVal, RunLEdgeFirst, RunLEdge, RunMiddleFirst, RunMiddle, RunREdgeFirst, RunREdge};
+
+    class SimMultSwitch {
+      public:
+        SimMSState state_ = SimMSState::Idle;
+        int psum_counter_ = 0;
+        bool has_config_ = false;     // The bypass config FIFO of the controller
+        SimMSState next_state_ = SimMSState::Idle;
+        int next_psum_count_ = 0;
+        bool has_weight_ = false;
+        int num_psums_ = 0;           // The bypass psum FIFO (depth 2)
+        bool sent_psum_ = false;
+        int stream_ = -1;             // SimFifo pool indices
+        int forward_ = -1;
+        int rn_ingress_ = -1;
+
+        bool IsRunning() const {
+          return state_ >= SimMSState::RunLEdgeFirst;
+        }
+
+        // Whether the multiplier takes its operand, and the DN its data, from the stream FIFO
+        bool TakesStream() const {
+          return state_ == SimMSState::RunLEdgeFirst || state_ == SimMSState::RunLEdge
+                 || state_ == SimMSState::RunMiddleFirst || state_ == SimMSState::RunREdgeFirst;
+        }
+
+        bool ForwardsOperand() const {
+          return state_ == SimMSState::RunLEdgeFirst || state_ == SimMSState::RunLEdge
+                 || state_ == SimMSState::RunMiddleFirst || state_ == SimMSState::RunMiddle;
+        }
+    }; // End of class SimMultSwitch
+
+    /*
+      An SGRS, or a DBRS with both of its halves. Ports follow the RTL:
+      in0/in1 of an SGRS, LL/LR/RL/RR (0..3) of a DBRS; half 0 is the SGRS
+      itself or the left half of the DBRS.
+    */
+    class SimReductionSwitch {
+      public:
+        bool is_dbrs_ = false;
+        int level_ = 0;
+        int column_[2] = {0, 0};
+        int ingress_[4] = {-1, -1, -1, -1};   // Ingress NIC FIFOs (pool indices)
+        int datapath_in_[4] = {0, 0, 0, 0};    // Bypass FIFOs in front of the adders
+        int datapath_out_[2] = {0, 0};
+        int output_[2] = {-1, -1};             // Egress NIC FIFOs towards the parent
+        int result_[2] = {-1, -1};             // Egress NIC FIFOs towards the collection bus
+        int parent_[2] = {-1, -1};             // Ingress FIFO of the parent port; -1 at the root
+        int bus_[2] = {-1, -1};                // Collection bus ingress FIFO
+        int op_ports_[2] = {0, 0};             // Ports each half adds, as a mask; 0 if idle
+        bool gen_output_[2] = {false, false};
+
+        int GetNumPorts() const {
+          return is_dbrs_? 4 : 2;
+        }
+
+        int GetNumHalves() const {
+          return is_dbrs_? 2 : 1;
+        }
+    }; // End of class SimReductionSwitch
+
+    // One collection bus: its ingress FIFOs and the matrix (least recently granted) arbiter
+    class SimCollectionBus {
+      public:
+        std::vector<int> ingress_;
+        std::vector<std::vector<bool>> priority_;   // priority_[i][j]: port i wins over port j
+
+        void InitArbiter() {
+          int num_ports = static_cast<int>(ingress_.size());
+          priority_.assign(num_ports, std::vector<bool>(num_ports, false));
+          for(int i = 0; i < num_ports; i++) {
+            for(int j = i + 1; j < num_ports; j++) {
+              priority_[i][j] = true;
+            }
+          }
+        }
+
+        // Returns the granted port, or -1
+        int Arbitrate(const std::vector<SimFifo>& fifos) {
+          int num_ports = static_cast<int>(ingress_.size());
+          int grant = -1;
+          for(int i = 0; i < num_ports && grant < 0; i++) {
+            if(!fifos[ingress_[i]].CanDeq()) {
+              continue;
+            }
+            bool wins = true;
+            for(int j = 0; j < num_ports && wins; j++) {
+              wins = (j == i) || !fifos[ingress_[j]].CanDeq() || priority_[i][j];
+            }
+            if(wins) {
+              grant = i;
+            }
+          }
+          if(grant >= 0) {
+            for(int j = 0; j < num_ports; j++) {
+              if(j != grant) {
+                priority_[grant][j] = false;
+                priority_[j][grant] = true;
+              }
+            }
+          }
+          return grant;
+        }
+    }; // End of class SimCollectionBus
+
+    /*
+      One DN subtree: the top and subtree ingress FIFOs, and the controller
+      that turns destination sets into tree configurations (destination
+      FIFO, config FIFO, configured tree). A configured tree delivers one
+      packet and then needs another cycle to take the next configuration.
+    */
+    class SimDistributionSubtree {
+      public:
+        int top_ = -1;
+        int subtree_ = -1;
+        std::deque<std::vector<int>> destinations_;   // Bypass FIFO of depth 4
+        std::vector<int> config_;                     // Pipeline FIFO of depth 1
+        bool has_config_ = false;
+        long config_cycle_ = 0;
+        std::vector<int> tree_;                       // Configured destinations
+        bool configured_ = false;
+        bool ready_ = true;
+        bool ready_next_ = false;
+    }; // End of class SimDistributionSubtree
+
+    enum class SimTrafficGenStatus {Idle, WeightInitConfig, WeightInitData, InitWeightTransfer, InputInitConfig, InitInputTransfer,
+                                    InputInitData, SteadyState, RowTransition, OutputChannelTransition, InputChannelTransition, FinishState};
+
+    /*
+      Cycle-level simulator of the MAERI RTL running Testbench_MAERI on a
+      compiled RN_Config.vmh and Layer_Info.vmh. The accelerator size comes
+      from the NumMultSwitches field of Layer_Info.vmh and the distribution
+      and collection bandwidths are set at runtime, so no Bluespec rebuild is
+      needed to try another configuration.
+
+      Each cycle evaluates the modules from the testbench's output side back
+      to its input side, so that a FIFO dequeued in a cycle can take an
+      enqueue in the same cycle (pipeline FIFOs) while data enqueued in a
+      cycle is only seen in the next (SimFifo); bypass FIFOs are modeled as
+      counters that are filled and drained within the cycle. The testbench
+      state machine, the tile info and RN config memories, the DN subtrees,
+      the multiplier switch controllers and the RN adders follow their BSV
+      rules. Two simplifications: a multiplier switch forwards its operand
+      to its right neighbour when it consumes it (not every cycle the
+      operand waits), and packets a full FIFO cannot take are dropped where
+      the RTL loses a wire. One extension: Testbench_MAERI multicasts every
+      input beat to all VNs, which only suits layers whose VNs share their
+      input channel, so the simulator splits the beats of a depthwise layer
+      into one per VN of a DN subtree.
+    */
+    class CycleSimulator {
+      protected:
+        static constexpr long STALL_CYCLES = 1L << 20;
+        static constexpr int DN_DEST_FIFO_DEPTH = 4;
+        static constexpr int DN_INGRESS_DEPTH = 16;
+        static constexpr int BUS_INGRESS_DEPTH = 4;
+        static constexpr int TILE_INFO_LOAD_CYCLES = 13;
+
+        int distribution_bandwidth_;
+        int collection_bandwidth_;
+        int num_mult_switches_ = 0;
+        int num_leaves_ = 0;
+        int num_levels_ = 0;
+        int subtree_size_ = 0;
+        int rn_config_stride_ = 0;
+
+        CompiledConfig compiled_;
+
+        std::vector<SimFifo> fifos_;
+        std::vector<SimMultSwitch> mult_switches_;
+        std::vector<SimReductionSwitch> reduction_switches_;   // Root first, level by level
+        std::vector<std::vector<int>> column_switch_;          // Per level: column -> reduction switch
+        std::vector<SimCollectionBus> buses_;
+        std::vector<SimDistributionSubtree> subtrees_;
+
+        // CR_TileInfoMemory and CR_RN_ConfigMemory
+        long tile_ready_cycle_ = TILE_INFO_LOAD_CYCLES;
+        long rn_config_ready_cycle_ = 0;
+        bool rn_config_taken_ = false;
+
+        // Testbench_MAERI registers
+        long cycle_ = 0;
+        SimTrafficGenStatus state_ = SimTrafficGenStatus::Idle;
+        bool inited_ = false;
+        bool configed_rn_ = false;
+        bool count_unique_input_ = true;
+        int layer_idx_ = 0;
+        long target_gather_count_ = 0;
+        int traffic_gen_count_ = 0;
+        int depthwise_beat_ = 0;
+        int k_ = 0, c_ = 0, y_ = 0, x_ = 0;
+        bool finish_req_ = false;
+        long psum_reg_y_ = 0, psum_reg_c_ = 0, psum_reg_k_ = 0;
+        long layer_start_psums_ = 0;
+        long last_progress_ = 0;
+        std::vector<std::vector<int>> port_destinations_;
+
+        CycleEstimate stats_;
+
+        int NewFifo(int capacity) {
+          SimFifo fifo;
+          fifo.capacity_ = capacity;
+          fifos_.push_back(fifo);
+          return static_cast<int>(fifos_.size()) - 1;
+        }
+
+        // Switch IDs of RN_ReductionNetwork: SGRSes and DBRSes are numbered separately
+        int GetRTLSwitchID(int level, int column) {
+          int num_columns = 1 << level;
+          if(level == 0) {
+            return 0;
+          }
+          if(column == 0 || column == num_columns - 1) {
+            return 2 * level - ((column == 0)? 1 : 0);
+          }
+          return (1 << (level - 1)) - level + (column - 1) / 2;
+        }
+
+        // Ingress FIFO that column (or leaf) column of level level feeds
+        int GetParentIngress(int level, int column) {
+          int parent_column = column / 2;
+          auto& parent = reduction_switches_[column_switch_[level - 1][parent_column]];
+          if(!parent.is_dbrs_) {
+            return parent.ingress_[column % 2];
+          }
+          int d = (parent_column - 1) / 2;
+          return parent.ingress_[column - (2 + 4 * d)];
+        }
+
+        void BuildNetwork() {
+          fifos_.clear();
+          num_leaves_ = ReductionNetwork::TreeShape::NextPowerOfTwo(num_mult_switches_);
+          num_levels_ = 0;
+          while((1 << num_levels_) < num_leaves_) {
+            num_levels_++;
+          }
+          subtree_size_ = num_mult_switches_ / distribution_bandwidth_;
+          rn_config_stride_ = compiled_.GetRNConfigStride();
+
+          int num_dbrs = 0;
+          reduction_switches_.clear();
+          column_switch_.assign(num_levels_, std::vector<int>());
+          for(int lv = 0; lv < num_levels_; lv++) {
+            int num_columns = 1 << lv;
+            column_switch_[lv].assign(num_columns, -1);
+            for(int column = 0; column < num_columns; column++) {
+              bool edge = (column == 0 || column == num_columns - 1);
+              if(!edge && column % 2 == 0) {
+                continue;   // Right half of the DBRS added with its left half
+              }
+              SimReductionSwitch sw;
+              sw.is_dbrs_ = !edge;
+              sw.level_ = lv;
+              sw.column_[0] = column;
+              sw.column_[1] = column + 1;
+              for(int port = 0; port < sw.GetNumPorts(); port++) {
+                sw.ingress_[port] = NewFifo(1);
+              }
+              for(int half = 0; half < sw.GetNumHalves(); half++) {
+                sw.output_[half] = NewFifo(1);
+                sw.result_[half] = NewFifo(1);
+              }
+              column_switch_[lv][column] = static_cast<int>(reduction_switches_.size());
+              if(sw.is_dbrs_) {
+                column_switch_[lv][column + 1] = column_switch_[lv][column];
+                num_dbrs++;
+              }
+              reduction_switches_.push_back(sw);
+            }
+          }
+
+          // Collection buses, indexed like RN_ReductionNetwork
+          std::vector<std::vector<std::pair<int, int>>> bus_ports(collection_bandwidth_);   // (port, result FIFO)
+          for(auto& sw : reduction_switches_) {
+            int id = GetRTLSwitchID(sw.level_, sw.column_[0]);
+            for(int half = 0; half < sw.GetNumHalves(); half++) {
+              int port = sw.is_dbrs_? 2 * (id / collection_bandwidth_) + half
+                                    : 2 * num_dbrs / collection_bandwidth_ + 1 + id / collection_bandwidth_;
+              bus_ports[id % collection_bandwidth_].push_back(std::make_pair(port, half));
+              sw.bus_[half] = port;   // Resolved to a FIFO below
+            }
+          }
+          buses_.assign(collection_bandwidth_, SimCollectionBus());
+          for(int bus = 0; bus < collection_bandwidth_; bus++) {
+            int num_ports = 0;
+            for(auto& entry : bus_ports[bus]) {
+              num_ports = std::max(num_ports, entry.first + 1);
+            }
+            for(int port = 0; port < num_ports; port++) {
+              buses_[bus].ingress_.push_back(NewFifo(BUS_INGRESS_DEPTH));
+            }
+            buses_[bus].InitArbiter();
+          }
+          for(auto& sw : reduction_switches_) {
+            int id = GetRTLSwitchID(sw.level_, sw.column_[0]);
+            for(int half = 0; half < sw.GetNumHalves(); half++) {
+              sw.bus_[half] = buses_[id % collection_bandwidth_].ingress_[sw.bus_[half]];
+              sw.parent_[half] = (sw.level_ == 0)? -1 : GetParentIngress(sw.level_, sw.column_[half]);
+            }
+          }
+
+          mult_switches_.assign(num_mult_switches_, SimMultSwitch());
+          for(int ms = 0; ms < num_mult_switches_; ms++) {
+            mult_switches_[ms].stream_ = NewFifo(2);
+            mult_switches_[ms].forward_ = NewFifo(2);
+            mult_switches_[ms].rn_ingress_ = GetParentIngress(num_levels_, ms);
+          }
+
+          subtrees_.assign(distribution_bandwidth_, SimDistributionSubtree());
+          for(auto& subtree : subtrees_) {
+            subtree.top_ = NewFifo(DN_INGRESS_DEPTH);
+            subtree.subtree_ = NewFifo(DN_INGRESS_DEPTH);
+          }
+          port_destinations_.assign(distribution_bandwidth_, std::vector<int>());
+        }
+
+        // RN_ReductionNetwork.putConfig
+        void ApplyRNConfig(int layer) {
+          ReductionNetwork::TreeShape shape(num_mult_switches_);
+          auto& configs = compiled_.rn_configs_[layer];
+          for(auto& sw : reduction_switches_) {
+            auto& config_L = configs[shape.InorderID(sw.level_, sw.column_[0])];
+            auto& config_R = sw.is_dbrs_? configs[shape.InorderID(sw.level_, sw.column_[1])] : config_L;
+            for(int half = 0; half < sw.GetNumHalves(); half++) {
+              sw.op_ports_[half] = AdderPorts::Get(sw.is_dbrs_, config_L, config_R, half);
+              sw.gen_output_[half] = (half == 0)? config_L.genOutput_ : config_R.genOutput_;
+            }
+          }
+        }
+
+        /******** Accelerator ********/
+
+        void StepCollectionBuses() {
+          for(auto& bus : buses_) {
+            int grant = bus.Arbitrate(fifos_);
+            if(grant >= 0) {
+              fifos_[bus.ingress_[grant]].Deq();
+              stats_.num_received_psums_++;
+              psum_reg_y_++;
+              psum_reg_c_++;
+              psum_reg_k_++;
+              last_progress_ = cycle_;
+            }
+          }
+        }
+
+        void StepReductionNetwork() {
+          for(auto& sw : reduction_switches_) {
+            for(int half = 0; half < sw.GetNumHalves(); half++) {
+              auto& output = fifos_[sw.output_[half]];
+              if(output.CanDeq() && sw.parent_[half] >= 0 && fifos_[sw.parent_[half]].CanEnq()) {
+                output.Deq();
+                fifos_[sw.parent_[half]].Enq();
+              }
+              auto& result = fifos_[sw.result_[half]];
+              if(result.CanDeq() && fifos_[sw.bus_[half]].CanEnq()) {
+                result.Deq();
+                fifos_[sw.bus_[half]].Enq();
+              }
+            }
+
+            for(int port = 0; port < sw.GetNumPorts(); port++) {
+              auto& ingress = fifos_[sw.ingress_[port]];
+              if(ingress.CanDeq() && sw.datapath_in_[port] == 0) {
+                ingress.Deq();
+                sw.datapath_in_[port]++;
+              }
+            }
+
+            for(int half = 0; half < sw.GetNumHalves(); half++) {
+              int ports = sw.op_ports_[half];
+              if(ports == 0 || sw.datapath_out_[half] != 0) {
+                continue;
+              }
+              bool ready = true;
+              for(int port = 0; port < 4; port++) {
+                ready = ready && (!(ports & (1 << port)) || sw.datapath_in_[port] != 0);
+              }
+              if(ready) {
+                for(int port = 0; port < 4; port++) {
+                  if(ports & (1 << port)) {
+                    sw.datapath_in_[port]--;
+                  }
+                }
+                sw.datapath_out_[half]++;
+              }
+            }
+
+            for(int half = 0; half < sw.GetNumHalves(); half++) {
+              auto& egress = fifos_[sw.gen_output_[half]? sw.result_[half] : sw.output_[half]];
+              if(sw.datapath_out_[half] != 0 && egress.CanEnq()) {
+                sw.datapath_out_[half]--;
+                egress.Enq();
+              }
+            }
+          }
+        }
+
+        void StepMultSwitches() {
+          // Right to left, so that a forwarding FIFO is drained before its left neighbour fills it
+          for(int idx = num_mult_switches_ - 1; idx >= 0; idx--) {
+            auto& ms = mult_switches_[idx];
+            ms.sent_psum_ = false;
+            if(ms.IsRunning() && ms.has_weight_ && ms.num_psums_ < 2) {
+              auto& operand = fifos_[ms.TakesStream()? ms.stream_ : ms.forward_];
+              if(operand.CanDeq()) {
+                operand.Deq();
+                ms.num_psums_++;
+                if(ms.ForwardsOperand() && idx + 1 < num_mult_switches_ && fifos_[mult_switches_[idx + 1].forward_].CanEnq()) {
+                  fifos_[mult_switches_[idx + 1].forward_].Enq();
+                }
+              }
+            }
+            if(ms.num_psums_ > 0 && ms.psum_counter_ != 0 && fifos_[ms.rn_ingress_].CanEnq()) {
+              ms.num_psums_--;
+              ms.sent_psum_ = true;
+              fifos_[ms.rn_ingress_].Enq();
+            }
+          }
+        }
+
+        void StepMultSwitchControllers() {
+          for(auto& ms : mult_switches_) {
+            if(ms.psum_counter_ == 0) {
+              if(ms.has_config_) {
+                ms.state_ = ms.next_state_;
+                ms.psum_counter_ = ms.next_psum_count_;
+                ms.has_config_ = false;
+              }
+              continue;
+            }
+            if(ms.sent_psum_) {
+              ms.psum_counter_--;
+            }
+            if(ms.state_ == SimMSState::RunLEdgeFirst) {
+              ms.state_ = SimMSState::RunLEdge;
+            }
+            else if(ms.state_ == SimMSState::RunMiddleFirst) {
+              ms.state_ = SimMSState::RunMiddle;
+            }
+            else if(ms.state_ == SimMSState::RunREdgeFirst) {
+              ms.state_ = SimMSState::RunREdge;
+            }
+          }
+        }
+
+        bool IsDistributionNetworkEmpty() {
+          for(auto& subtree : subtrees_) {
+            if(!fifos_[subtree.top_].IsEmpty() || !fifos_[subtree.subtree_].IsEmpty()) {
+              return false;
+            }
+          }
+          return true;
+        }
+
+        void DeliverToMultSwitch(int idx) {
+          auto& ms = mult_switches_[idx];
+          if(ms.state_ == SimMSState::InitSteadyVal) {
+            ms.has_weight_ = true;
+          }
+          else if(ms.TakesStream() && fifos_[ms.stream_].CanEnq()) {
+            fifos_[ms.stream_].Enq();
+          }
+        }
+
+        void StepDistributionNetwork() {
+          for(auto& subtree : subtrees_) {
+            auto& sub_fifo = fifos_[subtree.subtree_];
+            if(subtree.configured_ && sub_fifo.CanDeq()) {
+              sub_fifo.Deq();
+              for(auto idx : subtree.tree_) {
+                DeliverToMultSwitch(idx);
+              }
+              subtree.configured_ = false;
+              subtree.ready_next_ = true;
+            }
+            if(subtree.ready_ && subtree.has_config_ && subtree.config_cycle_ < cycle_) {
+              subtree.tree_.swap(subtree.config_);
+              subtree.has_config_ = false;
+              subtree.configured_ = true;
+              subtree.ready_ = false;
+            }
+            auto& top_fifo = fifos_[subtree.top_];
+            if(top_fifo.CanDeq() && sub_fifo.CanEnq()) {
+              top_fifo.Deq();
+              sub_fifo.Enq();
+            }
+          }
+        }
+
+        void StepDistributionControllers() {
+          for(auto& subtree : subtrees_) {
+            if(!subtree.destinations_.empty() && !subtree.has_config_) {
+              subtree.config_.swap(subtree.destinations_.front());
+              subtree.destinations_.pop_front();
+              subtree.has_config_ = true;
+              subtree.config_cycle_ = cycle_;
+            }
+            if(subtree.ready_next_) {
+              subtree.ready_ = true;
+              subtree.ready_next_ = false;
+            }
+          }
+        }
+
+        /******** Testbench_MAERI ********/
+
+        // Injects one packet on every port with destinations, or none if some port is full
+        bool Inject(long& counter) {
+          for(int port = 0; port < distribution_bandwidth_; port++) {
+            if(!port_destinations_[port].empty()
+               && (static_cast<int>(subtrees_[port].destinations_.size()) >= DN_DEST_FIFO_DEPTH || !fifos_[subtrees_[port].top_].CanEnq())) {
+              return false;
+            }
+          }
+          for(int port = 0; port < distribution_bandwidth_; port++) {
+            auto& destinations = port_destinations_[port];
+            if(!destinations.empty()) {
+              counter += static_cast<long>(destinations.size());
+              fifos_[subtrees_[port].top_].Enq();
+              subtrees_[port].destinations_.push_back(destinations);
+              destinations.clear();
+            }
+          }
+          return true;
+        }
+
+        void AddDestination(int ms) {
+          port_destinations_[ms / subtree_size_].push_back(ms);
+        }
+
+        void ClearDestinations() {
+          for(auto& destinations : port_destinations_) {
+            destinations.clear();
+          }
+        }
+
+        /*
+          The VNs of a depthwise layer read different input channels, so a
+          port carries the destinations of one VN per beat. Keeps those of the
+          depthwise_beat_-th VN of every port and returns the number of beats
+          the destinations need.
+        */
+        int SplitDepthwiseBeat(int vn_size) {
+          int num_beats = 1;
+          for(auto& destinations : port_destinations_) {
+            int num_vns = 0;
+            int last_vn = -1;
+            size_t num_kept = 0;
+            for(auto ms : destinations) {
+              if(ms / vn_size != last_vn) {
+                last_vn = ms / vn_size;
+                num_vns++;
+              }
+              if(num_vns - 1 == depthwise_beat_) {
+                destinations[num_kept++] = ms;
+              }
+            }
+            destinations.resize(num_kept);
+            num_beats = std::max(num_beats, num_vns);
+          }
+          return num_beats;
+        }
+
+        // Moves to the next beat of a split depthwise beat; false after the last one
+        bool NextDepthwiseBeat(int num_beats) {
+          if(++depthwise_beat_ < num_beats) {
+            return true;
+          }
+          depthwise_beat_ = 0;
+          return false;
+        }
+
+        // MN_MultiplierNetwork.putConfig to the active switches; waits for their config FIFOs to drain
+        bool PutMultSwitchConfig(int num_active, SimMSState state, int psum_count) {
+          for(int idx = 0; idx < num_active; idx++) {
+            if(mult_switches_[idx].has_config_) {
+              return false;
+            }
+          }
+          for(int idx = 0; idx < num_active; idx++) {
+            auto& ms = mult_switches_[idx];
+            ms.has_config_ = true;
+            ms.next_state_ = state;
+            ms.next_psum_count_ = psum_count;
+          }
+          return true;
+        }
+
+        void AccountPhase(SimTrafficGenStatus state) {
+          auto& phases = stats_.phases_;
+          switch(state) {
+            case SimTrafficGenStatus::Idle: phases.tile_info_load_++; break;
+            case SimTrafficGenStatus::WeightInitConfig: phases.weight_init_config_++; break;
+            case SimTrafficGenStatus::WeightInitData: phases.weight_init_data_++; break;
+            case SimTrafficGenStatus::InitWeightTransfer: phases.init_weight_transfer_++; break;
+            case SimTrafficGenStatus::InputInitConfig: phases.input_init_config_++; break;
+            case SimTrafficGenStatus::InitInputTransfer: phases.init_input_transfer_++; break;
+            case SimTrafficGenStatus::InputInitData: phases.input_init_data_++; break;
+            case SimTrafficGenStatus::SteadyState: phases.steady_state_++; break;
+            case SimTrafficGenStatus::RowTransition: phases.row_transition_++; break;
+            case SimTrafficGenStatus::OutputChannelTransition: phases.output_channel_transition_++; break;
+            case SimTrafficGenStatus::InputChannelTransition: phases.input_channel_transition_++; break;
+            case SimTrafficGenStatus::FinishState: phases.finish_++; break;
+          }
+        }
+
+        void SetState(SimTrafficGenStatus state) {
+          state_ = state;
+        }
+
+        void FinishRow(const TileInfoLayer& layer, int num_mapped_vns) {
+          auto& dims = layer.dims_;
+          bool y_edge = (y_ == (dims.GetOutputHeight() - 1) * dims.stride_y_);
+          if(!y_edge) {
+            SetState(SimTrafficGenStatus::RowTransition);
+            y_ += dims.stride_y_;
+          }
+          else if(k_ + num_mapped_vns != dims.k_) {
+            SetState(SimTrafficGenStatus::OutputChannelTransition);
+            y_ = 0;
+          }
+          else if(c_ != dims.c_ - 1) {
+            SetState(SimTrafficGenStatus::InputChannelTransition);
+            y_ = 0;
+            k_ = 0;
+            c_++;
+          }
+          else {
+            SetState(SimTrafficGenStatus::FinishState);
+            finish_req_ = true;
+          }
+          traffic_gen_count_ = 0;
+          x_ = 0;
+        }
+
+        void StepTestbench(bool dn_empty, std::ostream& out) {
+          // The state rule of this cycle is picked by the state register, not by what runTestBench writes
+          auto state = state_;
+
+          // runTestBench and configureRN
+          if(!inited_ && cycle_ >= tile_ready_cycle_ && (layer_idx_ == 0 || configed_rn_)) {
+            auto& dims = compiled_.layers_[layer_idx_].dims_;
+            target_gather_count_ += static_cast<long>(dims.k_) * dims.c_ * dims.GetOutputHeight() * dims.GetOutputWidth();
+            out << "@cycle " << cycle_ << ": Testbench is initialized for layer " << layer_idx_ << ". TargetPSumCount: " << target_gather_count_ << std::endl;
+            inited_ = true;
+            last_progress_ = cycle_;
+            SetState(SimTrafficGenStatus::WeightInitConfig);
+          }
+          if(!configed_rn_ && !rn_config_taken_ && cycle_ >= rn_config_ready_cycle_) {
+            ApplyRNConfig(layer_idx_);
+            configed_rn_ = true;
+            rn_config_taken_ = true;
+          }
+          if(state == SimTrafficGenStatus::Idle) {
+            return;
+          }
+
+          auto& layer = compiled_.layers_[layer_idx_];
+          auto& dims = layer.dims_;
+          int num_mapped_vns = std::min(layer.num_mapped_vns_, dims.k_ - k_);
+          int num_active = num_mapped_vns * layer.vn_size_;
+          int output_width = dims.GetOutputWidth();
+          int output_height = dims.GetOutputHeight();
+          bool x_edge = (x_ == (output_width - 1) * dims.stride_x_);
+          bool strided_x = dims.stride_x_ > 1;
+          int channels_per_input = dims.depthwise_? num_mapped_vns : 1;
+          int num_beats = 1;
+
+          switch(state) {
+            case SimTrafficGenStatus::WeightInitConfig:
+              if(PutMultSwitchConfig(num_active, SimMSState::InitSteadyVal, 0)) {
+                SetState(SimTrafficGenStatus::WeightInitData);
+              }
+              break;
+
+            case SimTrafficGenStatus::WeightInitData:
+              ClearDestinations();
+              for(int port = 0; port < distribution_bandwidth_; port++) {
+                int ms = port * subtree_size_ + traffic_gen_count_;
+                if(ms < num_active) {
+                  AddDestination(ms);
+                }
+              }
+              if(Inject(stats_.num_injected_weights_)) {
+                if(traffic_gen_count_ == subtree_size_ - 1) {
+                  traffic_gen_count_ = 0;
+                  SetState(SimTrafficGenStatus::InitWeightTransfer);
+                }
+                else {
+                  traffic_gen_count_++;
+                }
+              }
+              break;
+
+            case SimTrafficGenStatus::InitWeightTransfer:
+              if(dn_empty) {
+                SetState(SimTrafficGenStatus::InputInitConfig);
+              }
+              break;
+
+            case SimTrafficGenStatus::InputInitConfig: {
+              int psum_count = strided_x? 1 : output_width;
+              bool done = true;
+              for(int idx = 0; idx < num_active && done; idx++) {
+                done = !mult_switches_[idx].has_config_;
+              }
+              if(done) {
+                for(int idx = 0; idx < num_active; idx++) {
+                  auto& ms = mult_switches_[idx];
+                  int column = idx % dims.s_;
+                  ms.has_config_ = true;
+                  ms.next_state_ = (column == 0)? SimMSState::RunLEdgeFirst
+                                   : (column == dims.s_ - 1)? SimMSState::RunREdgeFirst : SimMSState::RunMiddleFirst;
+                  ms.next_psum_count_ = psum_count;
+                }
+                traffic_gen_count_ = 0;
+                SetState(SimTrafficGenStatus::InputInitData);
+              }
+              break;
+            }
+
+            case SimTrafficGenStatus::InputInitData:
+              ClearDestinations();
+              for(int ms = 0; ms < num_active; ms++) {
+                if(ms % layer.vn_size_ == traffic_gen_count_) {
+                  AddDestination(ms);
+                }
+              }
+              num_beats = dims.depthwise_? SplitDepthwiseBeat(layer.vn_size_) : 1;
+              if(Inject(stats_.num_injected_inputs_) && !NextDepthwiseBeat(num_beats)) {
+                if(traffic_gen_count_ == layer.vn_size_ - 1) {
+                  if(count_unique_input_) {
+                    stats_.num_injected_unique_inputs_ += channels_per_input * ((y_ == 0)? layer.vn_size_ : dims.s_);
+                  }
+                  SetState(SimTrafficGenStatus::InitInputTransfer);
+                }
+                else {
+                  traffic_gen_count_++;
+                }
+              }
+              break;
+
+            case SimTrafficGenStatus::InitInputTransfer:
+              if(dn_empty) {
+                if(!strided_x) {
+                  SetState(SimTrafficGenStatus::SteadyState);
+                  traffic_gen_count_ = 0;
+                  x_ = 1;
+                }
+                else if(!x_edge) {
+                  SetState(SimTrafficGenStatus::InputInitConfig);
+                  x_ += dims.stride_x_;
+                }
+                else {
+                  FinishRow(layer, num_mapped_vns);
+                }
+              }
+              break;
+
+            case SimTrafficGenStatus::SteadyState: {
+              ClearDestinations();
+              for(int ms = 0; ms < num_active; ms++) {
+                if(traffic_gen_count_ < dims.r_ && (ms / dims.s_) % dims.r_ == traffic_gen_count_ && ms % dims.s_ == 0) {
+                  AddDestination(ms);
+                }
+              }
+              bool has_data = false;
+              for(auto& destinations : port_destinations_) {
+                has_data = has_data || !destinations.empty();
+              }
+              num_beats = dims.depthwise_? SplitDepthwiseBeat(layer.vn_size_) : 1;
+              if(Inject(stats_.num_injected_inputs_)) {
+                stats_.num_input_multicasts_++;
+                if(NextDepthwiseBeat(num_beats)) {
+                  break;
+                }
+                if(count_unique_input_ && has_data && (y_ == 0 || traffic_gen_count_ == dims.r_ - 1)) {
+                  stats_.num_injected_unique_inputs_ += channels_per_input;
+                }
+                if(traffic_gen_count_ < dims.r_ - 1) {
+                  traffic_gen_count_++;
+                }
+                else {
+                  traffic_gen_count_ = 0;
+                  if(!x_edge) {
+                    x_++;
+                  }
+                  else {
+                    FinishRow(layer, num_mapped_vns);
+                  }
+                }
+              }
+              break;
+            }
+
+            case SimTrafficGenStatus::RowTransition:
+              if(psum_reg_y_ == static_cast<long>(num_mapped_vns) * output_width) {
+                SetState(SimTrafficGenStatus::InputInitConfig);
+                psum_reg_y_ = 0;
+              }
+              break;
+
+            case SimTrafficGenStatus::OutputChannelTransition:
+              if(psum_reg_k_ == static_cast<long>(num_mapped_vns) * output_width * output_height) {
+                SetState(SimTrafficGenStatus::WeightInitConfig);
+                k_ += num_mapped_vns;
+                psum_reg_y_ = 0;
+                psum_reg_k_ = 0;
+                count_unique_input_ = false;
+              }
+              break;
+
+            case SimTrafficGenStatus::InputChannelTransition:
+              if(psum_reg_c_ == static_cast<long>(dims.k_) * output_width * output_height) {
+                SetState(SimTrafficGenStatus::WeightInitConfig);
+                psum_reg_y_ = 0;
+                psum_reg_c_ = 0;
+                psum_reg_k_ = 0;
+                count_unique_input_ = true;
+              }
+              break;
+
+            default:
+              break;
+          }
+
+          // countPhase
+          if(stats_.num_received_psums_ >= target_gather_count_ && finish_req_) {
+            out << "@ Cycle " << cycle_ << ": Received all the outputs of layer " << layer_idx_ << std::endl;
+            out << " Layer type: " << layer.GetLayerTypeName() << std::endl;
+            out << " Layer dimension K = " << dims.k_ << ", C = " << dims.c_ << ", R = " << dims.r_ << ", S = " << dims.s_
+                << ", Y= " << dims.y_ << ", X = " << dims.x_ << std::endl;
+            out << " Stride (Y, X) = (" << dims.stride_y_ << ", " << dims.stride_x_ << "), Padding (Y, X) = (" << dims.pad_y_ << ", " << dims.pad_x_ << ")" << std::endl;
+            out << " Output dimension: " << dims.k_ << " x " << output_height << " x " << output_width << "\n" << std::endl;
+
+            long layer_psums = stats_.num_received_psums_ - layer_start_psums_;
+            stats_.num_generated_psums_ += layer_psums * layer.vn_size_;
+            stats_.num_ops_ += layer_psums * (2 * layer.vn_size_ - 1);
+            layer_start_psums_ = stats_.num_received_psums_;
+            finish_req_ = false;
+
+            if(layer.more_layers_) {
+              // loadNextLayer of the tile info and RN config memories
+              layer_idx_++;
+              tile_ready_cycle_ = cycle_ + 1 + TILE_INFO_LOAD_CYCLES;
+              rn_config_ready_cycle_ = cycle_ + 1 + rn_config_stride_ + 1;
+              rn_config_taken_ = false;
+              inited_ = false;
+              configed_rn_ = false;
+              count_unique_input_ = true;
+              traffic_gen_count_ = 0;
+              k_ = c_ = y_ = x_ = 0;
+              psum_reg_y_ = psum_reg_c_ = psum_reg_k_ = 0;
+              SetState(SimTrafficGenStatus::Idle);
+            }
+            else {
+              stats_.total_cycles_ = cycle_;
+              stats_.valid_ = true;
+            }
+          }
+        }
+
+        void Step(std::ostream& out) {
+          AccountPhase(state_);
+          bool dn_empty = IsDistributionNetworkEmpty();
+
+          StepCollectionBuses();
+          StepReductionNetwork();
+          StepMultSwitches();
+          StepDistributionNetwork();
+          StepTestbench(dn_empty, out);
+          StepDistributionControllers();
+          StepMultSwitchControllers();
+
+          for(auto& fifo : fifos_) {
+            fifo.Commit();
+          }
+          cycle_++;
+        }
+
+        static std::string GetStateName(SimTrafficGenStatus state) {
+          static const char* names[] = {"Idle", "WeightInitConfig", "WeightInitData", "InitWeightTransfer", "InputInitConfig", "InitInputTransfer",
+                                        "InputInitData", "SteadyState", "RowTransition", "OutputChannelTransition", "InputChannelTransition", "FinishState"};
+          return names[static_cast<int>(state)];
+        }
+
+      public:
+        CycleSimulator(int distributionBandwidth, int collectionBandwidth) :
+          distribution_bandwidth_(distributionBandwidth),
+          collection_bandwidth_(collectionBandwidth) {
+        }
+
+        bool Load(const std::string& rnConfigFile, const std::string& tileInfoFile) {
+          if(!compiled_.Load(rnConfigFile, tileInfoFile)) {
+            return false;
+          }
+
+          // An RN config that cannot reduce every mapped VN would only show up as a stall
+          for(int layer_idx = 0; layer_idx < static_cast<int>(compiled_.layers_.size()); layer_idx++) {
+            auto& layer = compiled_.layers_[layer_idx];
+            int k = layer.dims_.k_;
+            for(int num_vns : {std::min(layer.num_mapped_vns_, k), (k - 1) % layer.num_mapped_vns_ + 1}) {
+              RNAddSchedule schedule(compiled_.num_mult_switches_);
+              if(!schedule.Compile(compiled_.rn_configs_[layer_idx], RNAddSchedule::MapUniform(compiled_.GetNumLeaves(), layer.vn_size_, num_vns))) {
+                std::cerr << "ERROR: Layer " << layer_idx << ": with " << num_vns << " mapped VNs, the RN config's " << schedule.GetError() << std::endl;
+                return false;
+              }
+            }
+          }
+          num_mult_switches_ = compiled_.num_mult_switches_;
+          HardwareParams hw(num_mult_switches_, distribution_bandwidth_, collection_bandwidth_);
+          if(!hw.IsValid() || num_mult_switches_ < 4) {
+            std::cerr << "ERROR: Cannot simulate " << num_mult_switches_ << " multiplier switches with distribution bandwidth "
+                      << distribution_bandwidth_ << " and collection bandwidth " << collection_bandwidth_ << std::endl;
+            return false;
+          }
+          BuildNetwork();
+          return true;
+        }
+
+        int GetNumMultSwitches() const {
+          return num_mult_switches_;
+        }
+
+        int GetNumLayers() const {
+          return static_cast<int>(compiled_.layers_.size());
+        }
+
+        // Runs every layer; prints the testbench messages and returns the statistics (invalid on a stall)
+        CycleEstimate Run(std::ostream& out = std::cout) {
+          rn_config_ready_cycle_ = rn_config_stride_ + 1;
+          while(!stats_.valid_) {
+            Step(out);
+            if(cycle_ - last_progress_ > STALL_CYCLES) {
+              std::cerr << "ERROR: No output for " << STALL_CYCLES << " cycles; the simulation stalled in " << GetStateName(state_) << " of layer " << layer_idx_
+                        << " at cycle " << cycle_ << " (" << stats_.num_received_psums_ << " of " << target_gather_count_ << " outputs received)" << std::endl;
+              return stats_;
+            }
+          }
+
+          out << "Testbench terminates after " << compiled_.layers_.size() << " layers\n" << std::endl;
+          out << "Number of injected weights: " << stats_.num_injected_weights_ << std::endl;
+          out << "Number of injected inputs: " << stats_.num_injected_inputs_ << std::endl;
+          out << "Number of injected unique inputs: " << stats_.num_injected_unique_inputs_ << std::endl;
+          out << "Number of input multicasting: " << stats_.num_input_multicasts_ << std::endl;
+          out << "Number of generated partial sums: " << stats_.num_generated_psums_ << std::endl;
+          out << "Number of performed Ops (Multiplication and Addition): " << stats_.num_ops_ << "\n" << std::endl;
+          out << "Total runtime (assuming 1GHz clock): " << stats_.total_cycles_ << " ns" << std::endl;
+          return stats_;
+        }
+
+    }; // End of class CycleSimulator
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,263 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_FUNCTIONAL_MODEL_H_
+#define PM_FUNCTIONAL_MODEL_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+
+#include "compiled_config.hpp"
+#include "switch_config.hpp"
+#include "rn_add_schedule.hpp"
+#include "tensor_file.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    // INT16 arithmetic of src/ALUs: the adder wraps around; the multiplier keeps bits {31, 26:24, 23:12} of the 32-bit product
+    class Int16Arithmetic {
+      public:
+        static int16_t Add(int16_t a, int16_t b) {
+          return static_cast<int16_t>(static_cast<uint16_t>(a) + static_cast<uint16_t>(b));
+        }
+
+        static int16_t Multiply(int16_t a, int16_t b) {
+          uint32_t product = static_cast<uint32_t>(static_cast<int32_t>(a) * static_cast<int32_t>(b));
+          uint32_t bits = ((product >> 31) << 15) | (((product >> 24) & 0x7) << 12) | ((product >> 12) & 0xFFF);
+          return static_cast<int16_t>(static_cast<uint16_t>(bits));
+        }
+    }; // End of class Int16Arithmetic
+
+    /*
+      Weights [K][C][R][S] and inputs [channel][Y][X] of one layer in the
+      K, C, R, S, Y, X form of Layer_Info.vmh. Depthwise layers (C = 1)
+      read input channel k; padding reads as zero.
+    */
+    class LayerTensors {
+      public:
+        LayerDims dims_;
+        bool depthwise_ = false;
+        std::vector<int16_t> weights_;
+        std::vector<int16_t> inputs_;
+
+        LayerTensors(const TileInfoLayer& layer) :
+          dims_(layer.dims_),
+          depthwise_(layer.layer_type_ == static_cast<int>(maestro::LayerType::DWCONV)) {
+          weights_.assign(static_cast<size_t>(dims_.k_) * dims_.c_ * dims_.r_ * dims_.s_, 0);
+          inputs_.assign(static_cast<size_t>(GetNumInputChannels()) * dims_.y_ * dims_.x_, 0);
+        }
+
+        int GetNumInputChannels() const {
+          return depthwise_? dims_.k_ : dims_.c_;
+        }
+
+        void Randomize(unsigned seed) {
+          std::mt19937 rng(seed);
+          std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+          for(auto& weight : weights_) {
+            weight = static_cast<int16_t>(dist(rng));
+          }
+          for(auto& input : inputs_) {
+            input = static_cast<int16_t>(dist(rng));
+          }
+        }
+
+        bool Load(Util::TensorFile& weights, Util::TensorFile& inputs) {
+          if(!weights.CheckNumElements(weights_.size(), "K x C x R x S")
+             || !inputs.CheckNumElements(inputs_.size(), depthwise_? "K x Y x X" : "C x Y x X")) {
+            return false;
+          }
+          for(size_t idx = 0; idx < weights_.size(); idx++) {
+            weights_[idx] = weights.Get(idx);
+          }
+          for(size_t idx = 0; idx < inputs_.size(); idx++) {
+            inputs_[idx] = inputs.Get(idx);
+          }
+          return true;
+        }
+
+        int16_t GetWeight(int k, int c, int r, int s) const {
+          return weights_[((static_cast<size_t>(k) * dims_.c_ + c) * dims_.r_ + r) * dims_.s_ + s];
+        }
+
+        // Input under filter tap (r, s) of output (k, c, oy, ox)
+        int16_t GetInput(int k, int c, int oy, int ox, int r, int s) const {
+          int iy = oy * dims_.stride_y_ + r - dims_.pad_y_;
+          int ix = ox * dims_.stride_x_ + s - dims_.pad_x_;
+          if(iy < 0 || iy >= dims_.y_ || ix < 0 || ix >= dims_.x_) {
+            return 0;
+          }
+          int channel = depthwise_? k : c;
+          return inputs_[(static_cast<size_t>(channel) * dims_.y_ + iy) * dims_.x_ + ix];
+        }
+    }; // End of class LayerTensors
+
+    /*
+      Functional golden model of a compiled layer. Every output pixel of
+      Testbench_MAERI's dataflow is computed with real INT16 data: the
+      mapped VNs multiply one filter window each (multiplier switch m of
+      VN v holds tap m % VNSize of output channel k + v, row-major over
+      R x S), the products run through the decoded RN config's add
+      schedule, a batch of pixels at a time, and each genOutput result is
+      compared with the psum of a direct convolution. The psums of every
+      input channel are then accumulated and compared with the full
+      convolution. Structural errors of the config fail the layer.
+    */
+    class FunctionalModel {
+      protected:
+        static constexpr int MAX_REPORTED_MISMATCHES = 10;
+        static constexpr int NUM_LANES = 256;   // Output pixels per schedule evaluation
+
+        const CompiledConfig& compiled_;
+
+        static int16_t GetReferencePSum(const LayerTensors& tensors, int k, int c, int oy, int ox) {
+          int16_t psum = 0;
+          for(int r = 0; r < tensors.dims_.r_; r++) {
+            for(int s = 0; s < tensors.dims_.s_; s++) {
+              psum = Int16Arithmetic::Add(psum, Int16Arithmetic::Multiply(tensors.GetWeight(k, c, r, s), tensors.GetInput(k, c, oy, ox, r, s)));
+            }
+          }
+          return psum;
+        }
+
+      public:
+        FunctionalModel(const CompiledConfig& compiled) :
+          compiled_(compiled) {
+        }
+
+        // Returns true if the RN outputs of the layer match the direct convolution
+        bool VerifyLayer(int layer_idx, const LayerTensors& tensors, std::ostream& out = std::cout) {
+          auto& layer = compiled_.layers_[layer_idx];
+          auto& configs = compiled_.rn_configs_[layer_idx];
+          auto& dims = layer.dims_;
+          int vn_size = layer.vn_size_;
+          if(vn_size != dims.r_ * dims.s_) {
+            std::cerr << "ERROR: Layer " << layer_idx << ": VN size " << vn_size << " differs from R x S = " << dims.r_ * dims.s_
+                      << "; Testbench_MAERI maps one filter window per VN" << std::endl;
+            return false;
+          }
+
+          // Only the last K tile may map fewer VNs
+          int num_leaves = compiled_.GetNumLeaves();
+          int last_num_vns = (dims.k_ - 1) % layer.num_mapped_vns_ + 1;
+          RNAddSchedule full_schedule(compiled_.num_mult_switches_), last_schedule(compiled_.num_mult_switches_);
+          for(auto schedule : {std::make_pair(&full_schedule, std::min(layer.num_mapped_vns_, dims.k_)), std::make_pair(&last_schedule, last_num_vns)}) {
+            if(!schedule.first->Compile(configs, RNAddSchedule::MapUniform(num_leaves, vn_size, schedule.second))) {
+              std::cerr << "ERROR: Layer " << layer_idx << ": with " << schedule.second << " mapped VNs, the RN config's "
+                        << schedule.first->GetError() << std::endl;
+              return false;
+            }
+          }
+
+          int output_height = dims.GetOutputHeight();
+          int output_width = dims.GetOutputWidth();
+          int num_pixels = output_height * output_width;
+          std::vector<int16_t> outputs(static_cast<size_t>(dims.k_) * num_pixels, 0);
+          std::vector<int16_t> products(static_cast<size_t>(num_leaves) * NUM_LANES, 0);
+          std::vector<int16_t> vn_outputs(static_cast<size_t>(layer.num_mapped_vns_) * NUM_LANES);
+          std::vector<int16_t> scratch;
+          long num_psums = 0;
+          long num_mismatches = 0;
+
+          for(int c = 0; c < dims.c_; c++) {
+            for(int k_base = 0; k_base < dims.k_; k_base += layer.num_mapped_vns_) {
+              int num_vns = std::min(layer.num_mapped_vns_, dims.k_ - k_base);
+              auto& schedule = (k_base + layer.num_mapped_vns_ < dims.k_)? full_schedule : last_schedule;
+              for(int pixel_base = 0; pixel_base < num_pixels; pixel_base += NUM_LANES) {
+                int num_lanes = std::min(NUM_LANES, num_pixels - pixel_base);
+                for(int ms = 0; ms < num_vns * vn_size; ms++) {
+                  int k = k_base + ms / vn_size;
+                  int r = (ms % vn_size) / dims.s_;
+                  int s = (ms % vn_size) % dims.s_;
+                  int16_t weight = tensors.GetWeight(k, c, r, s);
+                  for(int lane = 0; lane < num_lanes; lane++) {
+                    int pixel = pixel_base + lane;
+                    products[static_cast<size_t>(ms) * num_lanes + lane]
+                      = Int16Arithmetic::Multiply(weight, tensors.GetInput(k, c, pixel / output_width, pixel % output_width, r, s));
+                  }
+                }
+
+                schedule.Evaluate(products.data(), vn_outputs.data(), num_lanes, scratch);
+
+                for(int vn = 0; vn < num_vns; vn++) {
+                  int k = k_base + vn;
+                  for(int lane = 0; lane < num_lanes; lane++) {
+                    int pixel = pixel_base + lane;
+                    int16_t expected = GetReferencePSum(tensors, k, c, pixel / output_width, pixel % output_width);
+                    int16_t actual = vn_outputs[static_cast<size_t>(vn) * num_lanes + lane];
+                    num_psums++;
+                    if(actual != expected && num_mismatches++ < MAX_REPORTED_MISMATCHES) {
+                      std::cerr << "ERROR: Layer " << layer_idx << ": psum (k = " << k << ", c = " << c << ", y = " << pixel / output_width
+                                << ", x = " << pixel % output_width << ") is " << actual << ", expected " << expected << std::endl;
+                    }
+                    auto& output = outputs[static_cast<size_t>(k) * num_pixels + pixel];
+                    output = Int16Arithmetic::Add(output, actual);
+                  }
+                }
+              }
+            }
+          }
+
+          // Direct convolution
+          for(int k = 0; k < dims.k_; k++) {
+            for(int oy = 0; oy < output_height; oy++) {
+              for(int ox = 0; ox < output_width; ox++) {
+                int16_t expected = 0;
+                for(int c = 0; c < dims.c_; c++) {
+                  for(int r = 0; r < dims.r_; r++) {
+                    for(int s = 0; s < dims.s_; s++) {
+                      expected = Int16Arithmetic::Add(expected, Int16Arithmetic::Multiply(tensors.GetWeight(k, c, r, s), tensors.GetInput(k, c, oy, ox, r, s)));
+                    }
+                  }
+                }
+                int16_t actual = outputs[(static_cast<size_t>(k) * output_height + oy) * output_width + ox];
+                if(actual != expected && num_mismatches++ < MAX_REPORTED_MISMATCHES) {
+                  std::cerr << "ERROR: Layer " << layer_idx << ": output (k = " << k << ", y = " << oy << ", x = " << ox
+                            << ") is " << actual << ", expected " << expected << std::endl;
+                }
+              }
+            }
+          }
+
+          if(num_mismatches != 0) {
+            std::cerr << "ERROR: Layer " << layer_idx << ": " << num_mismatches << " mismatches" << std::endl;
+            return false;
+          }
+          out << "Layer " << layer_idx << ": " << num_psums << " partial sums and " << outputs.size() << " outputs match the direct convolution" << std::endl;
+          return true;
+        }
+
+    }; // End of class FunctionalModel
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
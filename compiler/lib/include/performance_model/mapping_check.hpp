@@ -0,0 +1,109 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_MAPPING_CHECK_H_
+#define PM_MAPPING_CHECK_H_
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "vn_placement.hpp"
+#include "closed_form_rn_config.hpp"
+#include "rn_add_schedule.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    /*
+      Whether a uniform VN mapping runs correctly on the reduction network:
+      the placement must be valid and reducible (VNPlacement), and the RN
+      config compiled for it must pass the RNAddSchedule structural check
+      with every number of VNs that carries data. Folds at the edge of a
+      layer map fewer VNs with the same config, as in FunctionalModel.
+      Results are cached, since the DSE and the autotuner ask for the same
+      mappings many times.
+    */
+    class MappingCheck {
+      protected:
+        int num_mult_switches_;
+        int num_leaves_;
+        ReductionNetwork::ClosedFormRNConfigGenerator generator_;
+        std::map<std::tuple<int, int, int>, bool> checked_;   // (VN size, VN count, VNs with data)
+
+        bool CheckSchedule(int vn_size, int vn_num, int num_active) {
+          int max_vn_num = (vn_size == 1)? num_mult_switches_ / 2 : num_mult_switches_ / vn_size;
+          if(vn_size < 1 || vn_num < 1 || vn_num > max_vn_num || num_active < 1 || num_active > vn_num) {
+            return false;
+          }
+
+          using ReductionNetwork::VNPlacement;
+          auto leaves = (vn_size == 1)? VNPlacement::PlaceSingleVN(num_mult_switches_, vn_num)
+                                      : VNPlacement::PlaceUniform(num_mult_switches_, vn_size, vn_num);
+          if(!leaves.valid_ || !VNPlacement::CheckReducible(leaves, false)) {
+            return false;
+          }
+
+          auto layout = generator_.Generate(leaves);
+          std::vector<ReductionNetwork::AdderSwitchConfig> configs(num_leaves_ - 1);
+          for(int id = 0; id < num_leaves_ - 1; id++) {
+            int pos = generator_.GetTraversalPosition(id);
+            if(pos >= 0) {
+              configs[id] = layout.switches_[pos];
+            }
+          }
+
+          RNAddSchedule schedule(num_mult_switches_);
+          return schedule.Compile(configs, RNAddSchedule::MapUniform(num_leaves_, vn_size, num_active));
+        }
+
+      public:
+        MappingCheck(int numMultSwitches) :
+          num_mult_switches_(numMultSwitches),
+          num_leaves_(ReductionNetwork::TreeShape::NextPowerOfTwo(numMultSwitches)),
+          generator_(numMultSwitches) {
+        }
+
+        // vn_num VNs of vn_size, with all of them or only num_active carrying data
+        bool IsValid(int vn_size, int vn_num, int num_active) {
+          auto key = std::make_tuple(vn_size, vn_num, num_active);
+          auto it = checked_.find(key);
+          if(it == checked_.end()) {
+            it = checked_.emplace(key, CheckSchedule(vn_size, vn_num, num_active)).first;
+          }
+          return it->second;
+        }
+
+        bool IsValid(int vn_size, int vn_num) {
+          return IsValid(vn_size, vn_num, vn_num);
+        }
+
+    }; // End of class MappingCheck
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
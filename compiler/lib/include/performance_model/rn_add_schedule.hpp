@@ -0,0 +1,430 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_RN_ADD_SCHEDULE_H_
+#define PM_RN_ADD_SCHEDULE_H_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PM_RN_SIMD_X86
+#endif
+
+#include "compiled_config.hpp"
+#include "switch_config.hpp"
+#include "tree_shape.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    /*
+      Lane-wise wraparound adds of INT16_Adder (int16_t) or of a 32-bit
+      accumulator (int32_t). The AVX-512 and AVX2 kernels are compiled with
+      target attributes and picked at run time, so the binary needs no
+      -march flag; the scalar loop handles the tail and other CPUs.
+    */
+    class LaneAdder {
+      public:
+        enum class Isa { Scalar, AVX2, AVX512 };
+
+      protected:
+        static Isa& SelectedIsa() {
+          static Isa isa = GetBestIsa();
+          return isa;
+        }
+
+        template<typename T>
+        static void AddScalar(T* dst, const T* a, const T* b, const T* c, int begin, int n) {
+          using U = typename std::make_unsigned<T>::type;
+          for(int i = begin; i < n; i++) {
+            U sum = static_cast<U>(static_cast<U>(a[i]) + static_cast<U>(b[i]));
+            if(c != nullptr) {
+              sum = static_cast<U>(sum + static_cast<U>(c[i]));
+            }
+            dst[i] = static_cast<T>(sum);
+          }
+        }
+
+#ifdef PM_RN_SIMD_X86
+        __attribute__((target("avx2")))
+        static int AddAVX2(int16_t* dst, const int16_t* a, const int16_t* b, const int16_t* c, int n) {
+          int i = 0;
+          for(; i + 16 <= n; i += 16) {
+            __m256i sum = _mm256_add_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            if(c != nullptr) {
+              sum = _mm256_add_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + i)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), sum);
+          }
+          return i;
+        }
+
+        __attribute__((target("avx2")))
+        static int AddAVX2(int32_t* dst, const int32_t* a, const int32_t* b, const int32_t* c, int n) {
+          int i = 0;
+          for(; i + 8 <= n; i += 8) {
+            __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            if(c != nullptr) {
+              sum = _mm256_add_epi32(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + i)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), sum);
+          }
+          return i;
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        static int AddAVX512(int16_t* dst, const int16_t* a, const int16_t* b, const int16_t* c, int n) {
+          int i = 0;
+          for(; i + 32 <= n; i += 32) {
+            __m512i sum = _mm512_add_epi16(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            if(c != nullptr) {
+              sum = _mm512_add_epi16(sum, _mm512_loadu_si512(c + i));
+            }
+            _mm512_storeu_si512(dst + i, sum);
+          }
+          return i;
+        }
+
+        __attribute__((target("avx512f")))
+        static int AddAVX512(int32_t* dst, const int32_t* a, const int32_t* b, const int32_t* c, int n) {
+          int i = 0;
+          for(; i + 16 <= n; i += 16) {
+            __m512i sum = _mm512_add_epi32(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            if(c != nullptr) {
+              sum = _mm512_add_epi32(sum, _mm512_loadu_si512(c + i));
+            }
+            _mm512_storeu_si512(dst + i, sum);
+          }
+          return i;
+        }
+#endif
+
+      public:
+        static Isa GetBestIsa() {
+#ifdef PM_RN_SIMD_X86
+          __builtin_cpu_init();
+          if(__builtin_cpu_supports("avx512bw")) {
+            return Isa::AVX512;
+          }
+          if(__builtin_cpu_supports("avx2")) {
+            return Isa::AVX2;
+          }
+#endif
+          return Isa::Scalar;
+        }
+
+        // Accepts auto, avx512, avx2 or scalar; an ISA the CPU lacks is refused
+        static bool SelectIsa(const std::string& name) {
+          Isa best = GetBestIsa();
+          Isa isa;
+          if(name == "auto") {
+            isa = best;
+          }
+          else if(name == "avx512") {
+            isa = Isa::AVX512;
+          }
+          else if(name == "avx2") {
+            isa = Isa::AVX2;
+          }
+          else if(name == "scalar") {
+            isa = Isa::Scalar;
+          }
+          else {
+            return false;
+          }
+          if(static_cast<int>(isa) > static_cast<int>(best)) {
+            return false;
+          }
+          SelectedIsa() = isa;
+          return true;
+        }
+
+        static std::string GetIsaName() {
+          switch(SelectedIsa()) {
+            case Isa::AVX512:
+              return "avx512";
+            case Isa::AVX2:
+              return "avx2";
+            default:
+              return "scalar";
+          }
+        }
+
+        // dst[i] = a[i] + b[i] (+ c[i] if c is given) for i < n
+        template<typename T>
+        static void Add(T* dst, const T* a, const T* b, const T* c, int n) {
+          int done = 0;
+#ifdef PM_RN_SIMD_X86
+          if(SelectedIsa() == Isa::AVX512) {
+            done = AddAVX512(dst, a, b, c, n);
+          }
+          else if(SelectedIsa() == Isa::AVX2) {
+            done = AddAVX2(dst, a, b, c, n);
+          }
+#endif
+          AddScalar(dst, a, b, c, done, n);
+        }
+    }; // End of class LaneAdder
+
+    // dst = sum of srcs; slots below the number of leaves are multiplier outputs
+    class RNAddOp {
+      public:
+        int dst_;
+        int num_srcs_;
+        int srcs_[3];
+    }; // End of class RNAddOp
+
+    /*
+      A decoded RN config precompiled into a flat list of adds. Compile
+      walks the tree bottom-up once with symbolic partial sums, following
+      the SGRS and DBRS adder rules; flows and single-port adds only forward
+      a slot, so every op is a real two- or three-input add. A partial sum
+      that reaches an idle port, an adder that would wait for a port no
+      packet reaches, an adder mixing VNs, or a VN without exactly one
+      complete output fails the compile with a message in GetError.
+
+      Evaluate then runs the schedule on a batch of multiplier-output
+      vectors laid out [leaf][lane], one lane per output pixel, and writes
+      the VN outputs as [vn][lane].
+    */
+    class RNAddSchedule {
+      protected:
+        class Packet {
+          public:
+            int vn_ = -1;   // -1: no packet
+            int num_products_ = 0;
+            int slot_ = -1;
+        }; // End of class Packet
+
+        ReductionNetwork::TreeShape shape_;
+        int num_levels_;
+        int num_leaves_;
+        int num_slots_ = 0;
+        std::vector<RNAddOp> ops_;
+        std::vector<int> output_slots_;   // Per VN
+        std::vector<std::vector<Packet>> columns_;   // Per level; level num_levels_ holds the multiplier switches
+        std::string error_;
+
+        bool Fail(int level, int column, const std::string& message) {
+          error_ = "switch at level " + std::to_string(level) + ", column " + std::to_string(column)
+                   + " (in-order ID " + std::to_string(shape_.InorderID(level, column)) + ") " + message;
+          return false;
+        }
+
+        // One SGRS (columns[0]) or DBRS (columns[0..1]); input port p holds column 2 * first_column + p of the level below
+        bool CompileSwitch(const std::vector<ReductionNetwork::AdderSwitchConfig>& configs, const std::vector<int>& vn_sizes,
+                           int level, int first_column, bool is_dbrs) {
+          auto& inputs = columns_[level + 1];
+          auto& results = columns_[level];
+          int first_input = 2 * first_column;
+          int num_ports = is_dbrs? 4 : 2;
+          int num_halves = is_dbrs? 2 : 1;
+          auto& config_L = configs[shape_.InorderID(level, first_column)];
+          auto& config_R = is_dbrs? configs[shape_.InorderID(level, first_column + 1)] : config_L;
+          int used_ports = 0;
+
+          for(int half = 0; half < num_halves; half++) {
+            int column = first_column + half;
+            int ports = AdderPorts::Get(is_dbrs, config_L, config_R, half);
+            Packet result;
+            results[column] = result;
+
+            int num_present = 0, num_needed = 0;
+            for(int port = 0; port < num_ports; port++) {
+              if(ports & (1 << port)) {
+                num_needed++;
+                num_present += (inputs[first_input + port].vn_ != -1)? 1 : 0;
+              }
+            }
+            if(num_present == 0) {
+              continue;
+            }
+            if(num_present != num_needed) {
+              return Fail(level, column, "waits for a partial sum that never arrives");
+            }
+
+            RNAddOp op;
+            op.num_srcs_ = 0;
+            for(int port = 0; port < num_ports; port++) {
+              if(!(ports & (1 << port))) {
+                continue;
+              }
+              auto& packet = inputs[first_input + port];
+              if(result.vn_ != -1 && packet.vn_ != result.vn_) {
+                return Fail(level, column, "adds partial sums of VNs " + std::to_string(result.vn_) + " and " + std::to_string(packet.vn_));
+              }
+              result.vn_ = packet.vn_;
+              result.num_products_ += packet.num_products_;
+              op.srcs_[op.num_srcs_++] = packet.slot_;
+            }
+            used_ports |= ports;
+
+            if(op.num_srcs_ == 1) {
+              result.slot_ = op.srcs_[0];
+            }
+            else {
+              op.dst_ = num_slots_++;
+              ops_.push_back(op);
+              result.slot_ = op.dst_;
+            }
+
+            if((half == 0)? config_L.genOutput_ : config_R.genOutput_) {
+              if(result.num_products_ != vn_sizes[result.vn_] || output_slots_[result.vn_] != -1) {
+                return Fail(level, column, "outputs " + std::to_string(result.num_products_) + " of the " + std::to_string(vn_sizes[result.vn_])
+                                           + " products of VN " + std::to_string(result.vn_));
+              }
+              output_slots_[result.vn_] = result.slot_;
+            }
+            else {
+              results[column] = result;
+            }
+          }
+
+          for(int port = 0; port < num_ports; port++) {
+            auto& packet = inputs[first_input + port];
+            if(packet.vn_ != -1 && !(used_ports & (1 << port))) {
+              return Fail(level, first_column, "drops a partial sum of VN " + std::to_string(packet.vn_) + " on its idle port " + std::to_string(port));
+            }
+          }
+          return true;
+        }
+
+      public:
+        RNAddSchedule(int numMultSwitches) :
+          shape_(numMultSwitches),
+          num_levels_(shape_.GetNumLevels()),
+          num_leaves_(shape_.GetNumLeaves()) {
+        }
+
+        // Testbench_MAERI's mapping: VN v occupies multiplier switches [v * vnSize, (v + 1) * vnSize)
+        static std::vector<int> MapUniform(int num_leaves, int vn_size, int num_vns) {
+          std::vector<int> leaf_vns(num_leaves, -1);
+          for(int ms = 0; ms < vn_size * num_vns && ms < num_leaves; ms++) {
+            leaf_vns[ms] = ms / vn_size;
+          }
+          return leaf_vns;
+        }
+
+        // leaf_vns gives the VN of every multiplier switch, -1 if idle; VNs are numbered from 0
+        bool Compile(const std::vector<ReductionNetwork::AdderSwitchConfig>& configs, const std::vector<int>& leaf_vns) {
+          int num_vns = 0;
+          for(auto vn : leaf_vns) {
+            num_vns = std::max(num_vns, vn + 1);
+          }
+          std::vector<int> vn_sizes(num_vns, 0);
+          for(auto vn : leaf_vns) {
+            if(vn >= 0) {
+              vn_sizes[vn]++;
+            }
+          }
+
+          ops_.clear();
+          error_.clear();
+          num_slots_ = num_leaves_;
+          output_slots_.assign(num_vns, -1);
+          columns_.assign(num_levels_ + 1, std::vector<Packet>());
+          for(int level = 0; level <= num_levels_; level++) {
+            columns_[level].assign(1 << level, Packet());
+          }
+          for(int ms = 0; ms < num_leaves_ && ms < static_cast<int>(leaf_vns.size()); ms++) {
+            if(leaf_vns[ms] >= 0) {
+              columns_[num_levels_][ms].vn_ = leaf_vns[ms];
+              columns_[num_levels_][ms].num_products_ = 1;
+              columns_[num_levels_][ms].slot_ = ms;
+            }
+          }
+
+          for(int level = num_levels_ - 1; level >= 0; level--) {
+            int num_columns = 1 << level;
+            if(!CompileSwitch(configs, vn_sizes, level, 0, false)) {
+              return false;
+            }
+            if(num_columns > 1 && !CompileSwitch(configs, vn_sizes, level, num_columns - 1, false)) {
+              return false;
+            }
+            for(int d = 0; d < num_columns / 2 - 1; d++) {
+              if(!CompileSwitch(configs, vn_sizes, level, 1 + 2 * d, true)) {
+                return false;
+              }
+            }
+          }
+          for(int vn = 0; vn < num_vns; vn++) {
+            if(output_slots_[vn] == -1) {
+              error_ = "VN " + std::to_string(vn) + " never reaches a genOutput switch";
+              return false;
+            }
+          }
+          return true;
+        }
+
+        const std::string& GetError() const {
+          return error_;
+        }
+
+        int GetNumLeaves() const {
+          return num_leaves_;
+        }
+
+        int GetNumVNs() const {
+          return static_cast<int>(output_slots_.size());
+        }
+
+        int GetNumOps() const {
+          return static_cast<int>(ops_.size());
+        }
+
+        // products: [leaf][num_lanes], outputs: [vn][num_lanes]; scratch is resized to hold the intermediate sums
+        template<typename T>
+        void Evaluate(const T* products, T* outputs, int num_lanes, std::vector<T>& scratch) const {
+          scratch.resize(static_cast<size_t>(num_slots_ - num_leaves_) * num_lanes);
+          auto slot = [&](int idx) -> const T* {
+            return (idx < num_leaves_)? products + static_cast<size_t>(idx) * num_lanes
+                                      : scratch.data() + static_cast<size_t>(idx - num_leaves_) * num_lanes;
+          };
+
+          for(auto& op : ops_) {
+            T* dst = scratch.data() + static_cast<size_t>(op.dst_ - num_leaves_) * num_lanes;
+            LaneAdder::Add(dst, slot(op.srcs_[0]), slot(op.srcs_[1]), (op.num_srcs_ == 3)? slot(op.srcs_[2]) : nullptr, num_lanes);
+          }
+          for(int vn = 0; vn < GetNumVNs(); vn++) {
+            const T* src = slot(output_slots_[vn]);
+            std::copy(src, src + num_lanes, outputs + static_cast<size_t>(vn) * num_lanes);
+          }
+        }
+
+    }; // End of class RNAddSchedule
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
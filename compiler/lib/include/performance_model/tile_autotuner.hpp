@@ -0,0 +1,173 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef PM_TILE_AUTOTUNER_H_
+#define PM_TILE_AUTOTUNER_H_
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cycle_model.hpp"
+#include "mapping_check.hpp"
+
+namespace MAERI {
+  namespace PerformanceModel {
+
+    class TuningResult {
+      public:
+        bool valid_ = false;
+        LayerDims tiles_;
+        int vn_size_ = 0;
+        int vn_num_ = 0;
+        CycleEstimate estimate_;
+        long num_evaluated_ = 0;
+    }; // End of class TuningResult
+
+    /*
+      Searches the K/C/R/S/Y/X tile sizes of a layer with the fewest
+      predicted cycles (AnalyticalCycleModel::EstimateTiled) whose VNs fit in
+      the multiplier switches and whose mapping passes MappingCheck, with all
+      VNs and with the fewer VNs of the last K fold. Only the smallest tile of every fold count is
+      tried: a larger tile with the same number of folds only idles more
+      multipliers.
+    */
+    class TileAutotuner {
+      protected:
+        HardwareParams hw_;
+        AnalyticalCycleModel model_;
+        MappingCheck mapping_check_;
+
+        static std::vector<int> GetCandidateTiles(int dim_size) {
+          std::vector<int> tiles;
+          for(int num_folds = dim_size; num_folds >= 1; num_folds--) {
+            int tile = (dim_size + num_folds - 1) / num_folds;
+            if(tiles.empty() || tiles.back() != tile) {
+              tiles.push_back(tile);
+            }
+          }
+          return tiles;
+        }
+
+      public:
+        TileAutotuner(HardwareParams hw, PipelineLatency latency = PipelineLatency()) :
+          hw_(hw),
+          model_(hw, latency),
+          mapping_check_(hw.num_mult_switches_) {
+        }
+
+        TuningResult Tune(const LayerDims& dims) {
+          TuningResult best;
+          if(!hw_.IsValid() || dims.k_ < 1 || dims.c_ < 1 || dims.r_ < 1 || dims.s_ < 1
+             || dims.GetOutputHeight() < 1 || dims.GetOutputWidth() < 1) {
+            std::cerr << "ERROR: The layer or the accelerator parameters cannot be tuned" << std::endl;
+            return best;
+          }
+
+          auto k_tiles = GetCandidateTiles(dims.k_);
+          auto c_tiles = GetCandidateTiles(dims.c_);
+          auto r_tiles = GetCandidateTiles(dims.r_);
+          auto s_tiles = GetCandidateTiles(dims.s_);
+          auto y_tiles = GetCandidateTiles(dims.GetOutputHeight());
+          auto x_tiles = GetCandidateTiles(dims.GetOutputWidth());
+
+          for(auto c : c_tiles) {
+            for(auto r : r_tiles) {
+              for(auto s : s_tiles) {
+                int vn_size = c * r * s;
+                if(vn_size > hw_.num_mult_switches_) {
+                  continue;
+                }
+                // Single-multiplier VNs each take a whole lowest-level switch
+                int max_vn_num = (vn_size == 1)? hw_.num_mult_switches_ / 2 : hw_.num_mult_switches_ / vn_size;
+
+                for(auto k : k_tiles) {
+                  for(auto y : y_tiles) {
+                    if(k * y > max_vn_num) {
+                      break;
+                    }
+                    for(auto x : x_tiles) {
+                      if(k * y * x > max_vn_num) {
+                        break;
+                      }
+                      // The equivalent layer of EstimateTiled has K x Y x X VNs
+                      int vn_num = k * y * x;
+                      int last_num_vns = (dims.k_ * y * x - 1) % vn_num + 1;
+                      if(!mapping_check_.IsValid(vn_size, vn_num) || !mapping_check_.IsValid(vn_size, vn_num, last_num_vns)) {
+                        continue;
+                      }
+                      LayerDims tiles(k, c, r, s, y, x);
+                      auto estimate = model_.EstimateTiled(dims, tiles);
+                      best.num_evaluated_++;
+                      if(estimate.valid_ && (!best.valid_ || estimate.total_cycles_ < best.estimate_.total_cycles_)) {
+                        best.valid_ = true;
+                        best.tiles_ = tiles;
+                        best.estimate_ = estimate;
+                      }
+                    }
+                  }
+                }
+              }
+            }
+          }
+
+          if(best.valid_) {
+            best.vn_size_ = AnalyticalCycleModel::GetTiledVNSize(best.tiles_);
+            best.vn_num_ = AnalyticalCycleModel::GetTiledVNNum(best.tiles_);
+          }
+          return best;
+        }
+
+        // Same format as the layer files in data/
+        static bool WriteLayerFile(std::string filename, const LayerDims& dims, const LayerDims& tiles) {
+          std::ofstream layerFile(filename);
+          if(!layerFile) {
+            std::cerr << "ERROR: Failed to open " << filename << std::endl;
+            return false;
+          }
+          layerFile << "K " << dims.k_ << " " << tiles.k_ << "\n";
+          layerFile << "C " << dims.c_ << " " << tiles.c_ << "\n";
+          layerFile << "R " << dims.r_ << " " << tiles.r_ << "\n";
+          layerFile << "S " << dims.s_ << " " << tiles.s_ << "\n";
+          layerFile << "Y " << dims.y_ << " " << tiles.y_;
+          if(dims.stride_y_ != 1 || dims.pad_y_ != 0) {
+            layerFile << " " << dims.stride_y_ << " " << dims.pad_y_;
+          }
+          layerFile << "\nX " << dims.x_ << " " << tiles.x_;
+          if(dims.stride_x_ != 1 || dims.pad_x_ != 0) {
+            layerFile << " " << dims.stride_x_ << " " << dims.pad_x_;
+          }
+          layerFile << "\n";
+          return true;
+        }
+
+    }; // End of class TileAutotuner
+
+  }; // End of namespace PerformanceModel
+}; // End of namespace MAERI
+
+#endif
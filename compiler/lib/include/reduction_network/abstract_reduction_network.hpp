@@ -30,13 +30,17 @@ Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <string>
 #include <memory>
 #include <cmath>
 #include <cassert>
-#include <map>
 
 #include "switch_modes.hpp"
 #include "switch_config.hpp"
+#include "reduction_tree.hpp"
+#include "tree_shape.hpp"
+#include "inorder_switch_index.hpp"
+#include "vn_placement.hpp"
 #include "single_reduction_switch.hpp"
 #include "double_reduction_switch.hpp"
 
@@ -54,338 +58,144 @@ namespace MAERI {
         int vn_num_;
 
         bool non_uniform;
+        std::string vn_sizes_file_;
 
-        std::map <int, std::pair<int, int>> inorder_single_reduction_swtiches;
-        std::map <int, std::pair<int, int>> inorder_double_reduction_swtiches;
+        TreeShape shape_;
+        ReductionTree tree_;
+        InorderSwitchIndex inorder_switches_;
 
-        std::vector<std::vector<std::shared_ptr<SingleReductionSwitch>>> single_reduction_switches_;
-        std::vector<std::vector<std::shared_ptr<DoubleReductionSwitch>>> double_reduction_switches_;
+        SingleReductionSwitch SGRS(int level, int pos) {
+          return SingleReductionSwitch(&tree_, level, pos);
+        }
+
+        DoubleReductionSwitch DBRS(int level, int pos) {
+          return DoubleReductionSwitch(&tree_, level, pos);
+        }
 
       private:
         void IdleSwitchesProcess(int start_index) {
           for (int inPrt = start_index; inPrt < num_mult_switches_; inPrt++) {
               if(inPrt <2) {
-                single_reduction_switches_[num_levels_-1][0]->SetIDConnect(-1, inPrt % 2);
-                inorder_single_reduction_swtiches.insert(std::make_pair(0, std::make_pair(num_levels_ - 1, 0)));
+                SGRS(num_levels_-1, 0).SetIDConnect(-1, inPrt % 2);
+                inorder_switches_.InsertSGRS(0, num_levels_ - 1, 0);
               }
-              else if(inPrt > num_mult_switches_-3) {
-                single_reduction_switches_[num_levels_-1][1]->SetIDConnect(-1, inPrt % 2);
-                inorder_single_reduction_swtiches.insert(std::make_pair(num_adder_switches_ - 1, std::make_pair(num_levels_ - 1, 1)));
+              else if(inPrt > shape_.GetNumLeaves() - 3) {
+                SGRS(num_levels_-1, 1).SetIDConnect(-1, inPrt % 2);
+                inorder_switches_.InsertSGRS(num_adder_switches_ - 1, num_levels_ - 1, 1);
               }
               else {
                 int dbrs_id = (inPrt - 2)/4;
                 int port_id = (inPrt -2) % 4;
                 int inorder_id =  2 * (inPrt / 2);
-                double_reduction_switches_[num_levels_-1][dbrs_id]->SetIDConnect(-1, port_id);
-                inorder_double_reduction_swtiches.insert(std::make_pair(inorder_id, std::make_pair(num_levels_ - 1, dbrs_id)));
+                DBRS(num_levels_-1, dbrs_id).SetIDConnect(-1, port_id);
+                inorder_switches_.InsertDBRS(inorder_id, num_levels_ - 1, dbrs_id);
               }
             }
         }
 
-        void LowestLevelNonUniformCase() {
-          std::vector<int> vn_sizes;
-          std::ifstream readVNSizes("non_uniform_VN_sizes.txt");
-          int size;
-          int count = 0;
-
-          while (readVNSizes >> size) {
-            vn_sizes.push_back(size);
-            count += size;
-          }
-          readVNSizes.close();
-          if (count >= num_mult_switches_) {
-            std::cerr << "ERROR: Non-Uniform VN Sizes total exceeds the number of multiplier switches." << std::endl;
-            return;
-          }
-
-          int vn_id = 0;
-          int index = 0;
-          while (!vn_sizes.empty()) {
-            int vn_size = vn_sizes.front();
-            vn_sizes.erase(vn_sizes.begin());
+        void PlaceLeafPackets(const LeafAssignment& leaves) {
+          for(int inPrt = 0; inPrt < num_mult_switches_; inPrt++) {
+            if(!leaves.IsAssigned(inPrt)) {
+              continue;
+            }
 
-            int index_inc = vn_size;
-            for (int i = index; i < index + vn_size; i++) {
-              auto compile_packet = std::make_shared<CompilePacket>(vn_id, vn_size, 1);
+            CompilePacket compile_packet(leaves.vn_id_[inPrt], leaves.vn_size_[inPrt], 1);
+            if(inPrt <2) {
 #ifdef DEBUG
-              std::cout<< "VN Size: " << vn_size << ", VN ID: " << vn_id << std::endl;
+              std::cout << "SGRS[" << num_levels_-1 << "][0] receives an initial packet to port " << inPrt %2 << std::endl;
 #endif
-              if (i < 2) {
-                int vn_num_exist = single_reduction_switches_[num_levels_-1][0]->GetVN_Nums();
-                if (vn_num_exist == 0) {
-                  single_reduction_switches_[num_levels_-1][0]->PutPacket(compile_packet, i % 2);
-                  if (vn_size < 2) {
-                    index_inc++;
-                  }
-                } else if (vn_num_exist == 1) {
-                  if (single_reduction_switches_[num_levels_-1][0]->CheckIfSameID(vn_id)) {
-                    single_reduction_switches_[num_levels_-1][0]->PutPacket(compile_packet, i % 2);
-                  } else {
-                    std::cerr << "ERROR: One Single Switch inputs 2 kind of VNs" << std::endl;
-                    return;
-                  }
-                }
-                inorder_single_reduction_swtiches.insert(std::make_pair(0, std::make_pair(num_levels_ - 1, 0)));
-              } else if (i > num_mult_switches_-3) {
-                int vn_num_exist = single_reduction_switches_[num_levels_-1][1]->GetVN_Nums();
-                if (vn_num_exist == 0) {
-                  single_reduction_switches_[num_levels_-1][1]->PutPacket(compile_packet, i % 2);
-                  if (vn_size < 2) {
-                    index_inc++;
-                  }
-                } else if (vn_num_exist == 1) {
-                  if (single_reduction_switches_[num_levels_-1][1]->CheckIfSameID(vn_id)) {
-                    single_reduction_switches_[num_levels_-1][1]->PutPacket(compile_packet, i % 2);
-                  } else {
-                    std::cerr << "ERROR: One Single Switch inputs 2 kind of VNs" << std::endl;
-                    return;
-                  }
-                }
-                inorder_single_reduction_swtiches.insert(std::make_pair(num_adder_switches_ - 1, std::make_pair(num_levels_ - 1, 1)));
-              } else {
-                int dbrs_id = (i - 2)/4;
-                int port_id = (i - 2) % 4;
-                int inorder_id =  2 * (i / 2);
-#ifdef DEBUG                
-                std::cout << "dbrs_id: " << dbrs_id << ", port_id: " << port_id << ", inorder_id: " << inorder_id << std::endl; 
-#endif
-                int vn_num_exist = double_reduction_switches_[num_levels_-1][dbrs_id]->GetVN_Nums();
-                if (vn_num_exist == 0) {
-                  double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id);
-                } else if (vn_num_exist == 1) {
-                  int free_ports = double_reduction_switches_[num_levels_-1][dbrs_id]->GetFreePorts();
-                  if (double_reduction_switches_[num_levels_-1][dbrs_id]->CheckIfSameID(vn_id)) {
-                    double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id);
-                  } else if (vn_size >= free_ports) { // this kind of vn first time entry, so the whole vn size have not being filled
-                    double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id);
-                  } else {
-                    // Fill double switch with the second VN kind from right to left. This is to utilize the property of double switch.
-                    for (int j = 0; j < vn_size; j++) {
+              SGRS(num_levels_-1, 0).PutPacket(compile_packet, inPrt %2 );
+              inorder_switches_.InsertSGRS(0, num_levels_ - 1, 0);
+            }
+            else if(inPrt > shape_.GetNumLeaves() - 3) {
 #ifdef DEBUG
-                      std::cout << "position take: " << port_id + free_ports - 1 - j << std::endl;
+              std::cout << "SGRS[" << num_levels_-1 << "][1] receives an initial packet to port " << inPrt %2 << std::endl;
 #endif
-                      double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id + free_ports - 1 - j);
-                      int i_new =  i + free_ports - 1 - j;
-                      inorder_id = 2 * (i_new / 2);
-                      inorder_double_reduction_swtiches.insert(std::make_pair(inorder_id, std::make_pair(num_levels_ - 1, dbrs_id)));
-                    }
-                    index_inc += (free_ports - vn_size);
-                    break;
-                  } 
-                } else if (vn_num_exist == 2) {
-                  if (double_reduction_switches_[num_levels_-1][dbrs_id]->CheckIfSameID(vn_id)) {
-                    double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id);
-                  } else {
-                    std::cerr << "ERROR: One Single Switch inputs 2 kind of VNs" << std::endl;
-                    return;
-                  }
-                }    
-                inorder_double_reduction_swtiches.insert(std::make_pair(inorder_id, std::make_pair(num_levels_ - 1, dbrs_id)));
-              }
+              SGRS(num_levels_-1, 1).PutPacket(compile_packet, inPrt %2 );
+              inorder_switches_.InsertSGRS(num_adder_switches_ - 1, num_levels_ - 1, 1);
             }
-            index += index_inc;
-            vn_id++;
+            else {
+              int dbrs_id = (inPrt - 2)/4;
+              int port_id = (inPrt -2) % 4;
 #ifdef DEBUG
-            std::cout << "Index add up: " << index_inc  << ", Index now: " << index << std::endl;
+              std::cout << "DBRS[" << num_levels_-1 << "]["<< dbrs_id << "] receives an initial packet to port " << port_id << std::endl;
 #endif
-          }
-
-          if (index > num_mult_switches_) {
-            std::cerr << "ERROR: Non-Uniform VN Sizes total exceeds the number of multiplier switches.";
-            return;
-          }
-
-          IdleSwitchesProcess(index);
-        }
-
-        void LowestLevelSingleVNCase() {
-          int max_vn_num = num_mult_switches_ / 2;
-          if (vn_num_ > max_vn_num) {
-            std::cerr << "ERROR: Number of VNs exceeds the maximum number(num_multiplier / 2) allowed for VN SIZE 1" << std::endl;
-            return;
-          } else {
-            for (int vn_id = 0; vn_id < max_vn_num; vn_id++) {
-              if (vn_id < vn_num_) {
-                auto compile_packet = std::make_shared<CompilePacket>(vn_id, vn_size_, 1);
-                if (vn_id == 0) {
-                  single_reduction_switches_[num_levels_-1][0]->PutPacket(compile_packet, 0);
-                  inorder_single_reduction_swtiches.insert(std::make_pair(0, std::make_pair(num_levels_ - 1, 0)));
-                } else if (vn_id == max_vn_num - 1) {
-                  single_reduction_switches_[num_levels_-1][1]->PutPacket(compile_packet, 0);
-                  inorder_single_reduction_swtiches.insert(std::make_pair(num_adder_switches_ - 1, std::make_pair(num_levels_ - 1, 1)));
-                } else {
-                  int dbrs_id = (vn_id - 1) / 2;
-                  int pos_id = (vn_id - 1) % 2;
-                  int port_id = pos_id == 0 ? 0 : 3;
-                  int inorder_id = vn_id * 2;
-                  double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id);
-                  inorder_double_reduction_swtiches.insert(std::make_pair(inorder_id, std::make_pair(num_levels_ - 1, dbrs_id)));
-                }
-              } else {
-                IdleSwitchesProcess(vn_num_ * 2);
-              }
+              int inorder_id =  2 * (inPrt / 2);
+              DBRS(num_levels_-1, dbrs_id).PutPacket(compile_packet, port_id);
+              inorder_switches_.InsertDBRS(inorder_id, num_levels_ - 1, dbrs_id);
             }
           }
-        }
 
-        void LowestLevelNormalCase() {
-          for(int inPrt = 0; inPrt < num_mult_switches_; inPrt++) {
-            int vn_id = inPrt / vn_size_;
-            auto compile_packet = std::make_shared<CompilePacket>(vn_id, vn_size_, 1);
-            if(vn_id < vn_num_) {
-              if(inPrt <2) {
-#ifdef DEBUG
-                std::cout << "SGRS[" << num_levels_-1 << "][0] receives an initial packet to port " << inPrt %2 << std::endl;
-#endif
-                single_reduction_switches_[num_levels_-1][0]->PutPacket(compile_packet, inPrt %2 );
-                single_reduction_switches_[num_levels_-1][0]->SetIDConnect(-1, inPrt % 2);
-                inorder_single_reduction_swtiches.insert(std::make_pair(0, std::make_pair(num_levels_ - 1, 0)));
-              }
-              else if(inPrt > num_mult_switches_-3) {
-#ifdef DEBUG
-                std::cout << "SGRS[" << num_levels_-1 << "][1] receives an initial packet to port " << inPrt %2 << std::endl;
-#endif
-                single_reduction_switches_[num_levels_-1][1]->PutPacket(compile_packet, inPrt %2 );
-                single_reduction_switches_[num_levels_-1][1]->SetIDConnect(-1, inPrt % 2);
-                inorder_single_reduction_swtiches.insert(std::make_pair(num_adder_switches_ - 1, std::make_pair(num_levels_ - 1, 1)));
-              }
-              else {
-                int dbrs_id = (inPrt - 2)/4;
-                int port_id = (inPrt -2) % 4;
-#ifdef DEBUG
-                std::cout << "DBRS[" << num_levels_-1 << "]["<< dbrs_id << "] receives an initial packet to port " << port_id << std::endl;
-#endif
-                int inorder_id =  2 * (inPrt / 2);
-                double_reduction_switches_[num_levels_-1][dbrs_id]->PutPacket(compile_packet, port_id);
-                double_reduction_switches_[num_levels_-1][dbrs_id]->SetIDConnect(-1, port_id);
-                inorder_double_reduction_swtiches.insert(std::make_pair(inorder_id, std::make_pair(num_levels_ - 1, dbrs_id)));
-              }
-            } else {
-              IdleSwitchesProcess(inPrt);
-              break;
-            }
+          if(leaves.idle_start_ != -1) {
+            IdleSwitchesProcess(leaves.idle_start_);
           }
-#ifdef DEBUG
-          std::cout << std::endl;
-#endif
         }
 
       public:
-        AbstractReductionNetwork(int numMultSwitches, int vn_size, int vn_num, bool non_uniform) :
+        AbstractReductionNetwork(int numMultSwitches, int vn_size, int vn_num, bool non_uniform, std::string vn_sizes_file = "non_uniform_VN_sizes.txt") :
           num_mult_switches_(numMultSwitches),
+          num_adder_switches_(TreeShape::NextPowerOfTwo(numMultSwitches) - 1),
+          num_levels_(static_cast<int>(log2(TreeShape::NextPowerOfTwo(numMultSwitches)))),
           vn_size_(vn_size),
           vn_num_(vn_num),
-          non_uniform(non_uniform)  {
-
-          int numLvs = static_cast<int>(log2(numMultSwitches));
-
-          num_levels_ = numLvs;
-
-          num_adder_switches_ = num_mult_switches_ - 1;
-
-          for(int lv = 0; lv < numLvs ; lv++) {
-            std::vector<std::shared_ptr<SingleReductionSwitch>> lvSgrs;
-            single_reduction_switches_.push_back(lvSgrs);
-
-            std::vector<std::shared_ptr<DoubleReductionSwitch>> lvdbrs;
-            double_reduction_switches_.push_back(lvdbrs);
-          }
-
-          int sgrs_swid = 0;
-          int dbrs_swid = 0;
-          for(int lv = 0; lv < numLvs ; lv++) {
-            int num_sgrs_in_lv = (lv == 0)? 1 : 2;
-            for(int sw = 0; sw < num_sgrs_in_lv; sw++) {
-              auto new_sgrs = std::make_shared<SingleReductionSwitch>();
-              new_sgrs->switch_id = sgrs_swid;
-              single_reduction_switches_[lv].push_back(new_sgrs);
-#ifdef DEBUG
-              std::cout << "SGRS[" << lv << "][" << sw << "] is being initialized" << std::endl;
-#endif
-              sgrs_swid++;
-            }
-
-            int num_dbrs_in_lv = GetNumDBRS(lv);
-            if(num_dbrs_in_lv > 0) {
-              for(int sw = 0; sw < num_dbrs_in_lv; sw++) {
-                auto new_dbrs = std::make_shared<DoubleReductionSwitch>();
-                new_dbrs->switch_id = dbrs_swid;
-                double_reduction_switches_[lv].push_back(new_dbrs);
-#ifdef DEBUG
-                std::cout << "DBRS[" << lv << "][" << sw << "] is being initialized" << std::endl;
-#endif
-                dbrs_swid++;
-              }
-            }
-          }
+          non_uniform(non_uniform),
+          vn_sizes_file_(vn_sizes_file),
+          shape_(numMultSwitches),
+          tree_(num_levels_),
+          inorder_switches_(num_levels_, num_adder_switches_) {
         }
 
 
         void ProcessAbstractReductionNetwork () {
+          ProcessAbstractReductionNetwork(GetLeafAssignment());
+        }
+
+        void ProcessAbstractReductionNetwork (const LeafAssignment& leaves) {
 
           assert(num_levels_ >= 1);
 
-          if (non_uniform) {
-            LowestLevelNonUniformCase();
-          } else {
-            // special case handle: vn_size = 1 (ps: vn_num cannot exceed num_multiplier / 2)
-            if (vn_size_ == 1) {
-              LowestLevelSingleVNCase();
-            } else {
-              LowestLevelNormalCase();
-            }
-          }
+          PlaceLeafPackets(leaves);
 
           //Process rest of the levels from the lowest level
           for(int lv = num_levels_-1; lv >= 0 ; lv--) {
             //Process packets within switches
-            for(auto sgrs : single_reduction_switches_[lv]) {
-              sgrs->ProcessPackets();
+            for(int sw = 0; sw < tree_.GetNumSGRS(lv); sw++) {
+              SGRS(lv, sw).ProcessPackets();
             }
 
-            for(auto dbrs : double_reduction_switches_[lv]) {
-              dbrs->ProcessPackets();
+            for(int sw = 0; sw < tree_.GetNumDBRS(lv); sw++) {
+              DBRS(lv, sw).ProcessPackets();
             }
 
             //Forward output packets to the upper level
             if(lv > 0) {
               /* Interconnect SGRSes */
-              auto sgrs0_output = single_reduction_switches_[lv][0]->GetPacket(0);
-              int reverse_level_prev = num_levels_ - 1 - (lv - 1);
-              int reverse_level = num_levels_ - 1 - lv;
               int pos;
-              int id_to_connect = pow(2, reverse_level) - 1;
-              if(sgrs0_output != nullptr) {
+              int id_to_connect = InorderID(lv, 0);
 #ifdef DEBUG
-                std::cout << "SGRS[" << lv << "][0] Sends a packet to SGRS[" << lv-1 << "][0]" << std::endl;
+              std::cout << "SGRS[" << lv << "][0] Sends a packet to SGRS[" << lv-1 << "][0]" << std::endl;
 #endif
-                single_reduction_switches_[lv-1][0]->PutPacket(sgrs0_output, 0);
-                pos = pow(2, reverse_level_prev) - 1;
-                inorder_single_reduction_swtiches.insert(std::make_pair(pos, std::make_pair(lv - 1, 0)));
-                single_reduction_switches_[lv-1][0]->SetIDConnect(id_to_connect, 0);
-              }
+              SGRS(lv-1, 0).PutPacket(SGRS(lv, 0).GetPacket(0), 0);
+              pos = InorderID(lv-1, 0);
+              inorder_switches_.InsertSGRS(pos, lv - 1, 0);
+              SGRS(lv-1, 0).SetIDConnect(id_to_connect, 0);
 
-              auto sgrs1_output = single_reduction_switches_[lv][1]->GetPacket(0);
-              id_to_connect = pow(2, reverse_level) - 1 + 2 * (pow(2, lv) - 1) * pow(2, reverse_level);
-              if(sgrs1_output != nullptr) {
-                if(lv != 1) {
+              id_to_connect = InorderID(lv, (1 << lv) - 1);
+              if(lv != 1) {
 #ifdef DEBUG
-                  std::cout << "SGRS[" << lv << "][1] Sends a packet to SGRS[" << lv-1 << "][1]" << std::endl;
+                std::cout << "SGRS[" << lv << "][1] Sends a packet to SGRS[" << lv-1 << "][1]" << std::endl;
 #endif
-                  single_reduction_switches_[lv-1][1]->PutPacket(sgrs1_output, 1);
-                  pos = pow(2, reverse_level_prev) - 1 + 2 * (pow(2, lv - 1) - 1) * pow(2, reverse_level_prev);
-                  inorder_single_reduction_swtiches.insert(std::make_pair(pos, std::make_pair(lv - 1, 1)));
-                  single_reduction_switches_[lv-1][1]->SetIDConnect(id_to_connect, 1);
-                }
-                else {
+                SGRS(lv-1, 1).PutPacket(SGRS(lv, 1).GetPacket(0), 1);
+                pos = InorderID(lv-1, (1 << (lv-1)) - 1);
+                inorder_switches_.InsertSGRS(pos, lv - 1, 1);
+                SGRS(lv-1, 1).SetIDConnect(id_to_connect, 1);
+              }
+              else {
 #ifdef DEBUG
-                  std::cout << "SGRS[" << lv << "][1] Sends a packet to SGRS[" << lv-1 << "][0]" << std::endl;
-#endif                  
-                  single_reduction_switches_[lv-1][0]->PutPacket(sgrs1_output, 1);
-                  pos = pow(2, reverse_level_prev) - 1 + 2 * pow(lv, 2) * pow(2, reverse_level_prev);
-                  inorder_single_reduction_swtiches.insert(std::make_pair(pos, std::make_pair(lv - 1, 0)));
-                  single_reduction_switches_[lv-1][0]->SetIDConnect(id_to_connect, 1);
-                }
+                std::cout << "SGRS[" << lv << "][1] Sends a packet to SGRS[" << lv-1 << "][0]" << std::endl;
+#endif
+                SGRS(lv-1, 0).PutPacket(SGRS(lv, 1).GetPacket(0), 1);
+                SGRS(lv-1, 0).SetIDConnect(id_to_connect, 1);
               }
 
 
@@ -393,48 +203,40 @@ namespace MAERI {
               int num_dbrs_in_prev_lv = GetNumDBRS(lv-1);
 
               if(lv > 1) {
-                auto dbrs_lEdgeOutput = double_reduction_switches_[lv][0]->GetPacket(0);
-                id_to_connect = pow(2, reverse_level) - 1 + 2*1*pow(2, reverse_level);
-                if(dbrs_lEdgeOutput != nullptr) {
+                id_to_connect = InorderID(lv, 1);
 #ifdef DEBUG
-                  std::cout << "DBRS[" << lv << "][0]" << "Sends a packet to " << "SGRS[ " << lv -1 << "][0]" << std::endl;
+                std::cout << "DBRS[" << lv << "][0]" << "Sends a packet to " << "SGRS[ " << lv -1 << "][0]" << std::endl;
 #endif
-                  single_reduction_switches_[lv-1][0]->PutPacket(dbrs_lEdgeOutput, 1);
-                  single_reduction_switches_[lv-1][0]->SetIDConnect(id_to_connect, 1);
-                }
-
-                auto dbrs_rEdgeOutput = double_reduction_switches_[lv][num_dbrs_in_lv-1]->GetPacket(1);
+                SGRS(lv-1, 0).PutPacket(DBRS(lv, 0).GetPacket(0), 1);
+                SGRS(lv-1, 0).SetIDConnect(id_to_connect, 1);
 
-                id_to_connect = pow(2, reverse_level) - 1 + 2*(2 * num_dbrs_in_lv)*pow(2, reverse_level);
-                if(dbrs_rEdgeOutput != nullptr) {
+                auto dbrs_rEdgeOutput = DBRS(lv, num_dbrs_in_lv-1).GetPacket(1);
+                id_to_connect = InorderID(lv, 2 * num_dbrs_in_lv);
 #ifdef DEBUG
-                  std::cout << "DBRS[" << lv << "][" << num_dbrs_in_lv-1 << "]" << "Sends a packet to " << "SGRS[ " << lv -1 << "][1]" << std::endl;
-                  std::cout <<"Packet: vnID: " << dbrs_rEdgeOutput->GetVNID() << ", vnSz: " << dbrs_rEdgeOutput->GetVNSize() << ", pSum: " << dbrs_rEdgeOutput->GetNumPSums() << std::endl;
+                std::cout << "DBRS[" << lv << "][" << num_dbrs_in_lv-1 << "]" << "Sends a packet to " << "SGRS[ " << lv -1 << "][1]" << std::endl;
+                std::cout <<"Packet: vnID: " << dbrs_rEdgeOutput.GetVNID() << ", vnSz: " << dbrs_rEdgeOutput.GetVNSize() << ", pSum: " << dbrs_rEdgeOutput.GetNumPSums() << std::endl;
 #endif
-                  single_reduction_switches_[lv-1][1]->PutPacket(dbrs_rEdgeOutput, 0);
-                  single_reduction_switches_[lv-1][1]->SetIDConnect(id_to_connect, 0);
-                }
+                SGRS(lv-1, 1).PutPacket(dbrs_rEdgeOutput, 0);
+                SGRS(lv-1, 1).SetIDConnect(id_to_connect, 0);
 
                 if(lv>2) {
                   int num_dbrs_inPrt_in_prev_lv = num_dbrs_in_prev_lv * 4;
 
+                  // DBRS input port p of the upper level is fed by output port (p+1)%2 of DBRS (p+1)/2 of this level
                   for(int dbrs_inPrt = 0; dbrs_inPrt < num_dbrs_inPrt_in_prev_lv; dbrs_inPrt++) {
                     int targ_input_sw_id = dbrs_inPrt/4;
                     int targ_input_sw_port = dbrs_inPrt % 4;
                     int targ_output_sw_id = (dbrs_inPrt+1)/2;
                     int targ_output_sw_port = (dbrs_inPrt+1) % 2;
 
-                    auto packet = double_reduction_switches_[lv][targ_output_sw_id]->GetPacket(targ_output_sw_port);
-                    id_to_connect = pow(2, reverse_level) - 1 + 2*(2 + dbrs_inPrt)*pow(2, reverse_level);
-                    if(packet != nullptr && !(targ_output_sw_id == 0 && targ_output_sw_port == 0) ) {
+                    id_to_connect = InorderID(lv, 2 + dbrs_inPrt);
 #ifdef DEBUG
-                      std::cout << "DBRS[" << lv << "][" << targ_output_sw_id << "] Sends a packet from port " << targ_output_sw_port << " to DBRS[" << lv-1 << "][" << targ_input_sw_id << "] port" << targ_input_sw_port << std::endl;
+                    std::cout << "DBRS[" << lv << "][" << targ_output_sw_id << "] Sends a packet from port " << targ_output_sw_port << " to DBRS[" << lv-1 << "][" << targ_input_sw_id << "] port" << targ_input_sw_port << std::endl;
 #endif
-                      double_reduction_switches_[lv-1][targ_input_sw_id]->PutPacket(packet, targ_input_sw_port);
-                      pos = pow(2, reverse_level_prev) - 1 + 2*(1 + targ_input_sw_id * 2 + targ_input_sw_port / 2)*pow(2, reverse_level_prev);
-                      inorder_double_reduction_swtiches.insert(std::make_pair(pos, std::make_pair(lv - 1, targ_input_sw_id)));
-                      double_reduction_switches_[lv-1][targ_input_sw_id]->SetIDConnect(id_to_connect, targ_input_sw_port);
-                    }
+                    DBRS(lv-1, targ_input_sw_id).PutPacket(DBRS(lv, targ_output_sw_id).GetPacket(targ_output_sw_port), targ_input_sw_port);
+                    pos = InorderID(lv-1, 1 + targ_input_sw_id * 2 + targ_input_sw_port / 2);
+                    inorder_switches_.InsertDBRS(pos, lv - 1, targ_input_sw_id);
+                    DBRS(lv-1, targ_input_sw_id).SetIDConnect(id_to_connect, targ_input_sw_port);
 
                   } // End of for(int dbrs_inPrt = 0; dbrs_inPrt < num_dbrs_inPrt_in_prev_lv; dbrs_inPrt++)
                 } // End of if (lv>2)
@@ -445,8 +247,18 @@ namespace MAERI {
           std::cout << "Finished processing reduction network information" << std::endl;
         }
 
+        LeafAssignment GetLeafAssignment() {
+          return VNPlacement::Place(num_mult_switches_, vn_size_, vn_num_, non_uniform, vn_sizes_file_);
+        }
+
         int GetNumDBRS(int target_level) {
-          return static_cast<int>(pow(2, (target_level-1))) -1;
+          return tree_.GetNumDBRS(target_level);
+        }
+
+        // In-order (left to right) ID of the switch in the given column of a level
+        int InorderID(int level, int column) {
+          int stride = 1 << (num_levels_ - 1 - level);
+          return stride - 1 + 2 * column * stride;
         }
 
         void PrintConfig() {
@@ -468,57 +280,96 @@ namespace MAERI {
         }
 
         void PrintConfig_Inorder() {
-          std::cout << "Number of Levels: " << num_levels_ << ", Number of Adder Switches: " << num_adder_switches_ << std::endl;
+          std::cout << "Number of Levels: " << num_levels_ << ", Number of Adder Switches: " << shape_.GetNumAdderSwitches() << std::endl;
           for (int inorder_id = 0; inorder_id < num_adder_switches_; inorder_id++) {
-            auto it = inorder_single_reduction_swtiches.find(inorder_id);
-            if (it != inorder_single_reduction_swtiches.end()) {
-              int level = std::get<0>(inorder_single_reduction_swtiches[inorder_id]);
-              int pos = std::get<1>(inorder_single_reduction_swtiches[inorder_id]);
-              auto sgrs = single_reduction_switches_[level][pos];
-              auto config = std::make_shared<SGRS_Config>();
-              config->genOutput_ = sgrs->GetGenOutput();
-              config->mode_ = sgrs->GetMode();
-              std::cout << "Switch[" << inorder_id << "]: " << config->ToString() << std::endl;
-            } else {
-              it = inorder_double_reduction_swtiches.find(inorder_id);
-              if (it != inorder_double_reduction_swtiches.end()) {
-                int level = std::get<0>(inorder_double_reduction_swtiches[inorder_id]);
-                int pos = std::get<1>(inorder_double_reduction_swtiches[inorder_id]);  
-                auto dbrs = double_reduction_switches_[level][pos];
-                int inorder_id_left = inorder_id - 2 * pow(2, num_levels_ - 1 - level);
-                it = inorder_double_reduction_swtiches.find(inorder_id_left);
-                std::map<int, std::pair<int, int>>::iterator it_left = inorder_single_reduction_swtiches.find(inorder_id_left);
-                auto config = std::make_shared<DBRS_Single_Config>();
-                if (it != inorder_double_reduction_swtiches.end()) {
-                  int pos_left = std::get<1>(inorder_double_reduction_swtiches[inorder_id_left]);
-                  if (pos == pos_left) {
-                    config->genOutput_ = dbrs->GetGenOutputR();
-                    config->mode_ = dbrs->GetModeR();
-                  } else {
-                    config->genOutput_ = dbrs->GetGenOutputL();
-                    config->mode_ = dbrs->GetModeL();
-                  }
-                  std::cout << "Switch[" << inorder_id << "]: " << config->ToString() << std::endl;
-                } else if (it_left != inorder_single_reduction_swtiches.end()) {
-                  config->genOutput_ = dbrs->GetGenOutputL();
-                  config->mode_ = dbrs->GetModeL();
-                  std::cout << "Switch[" << inorder_id << "]: " << config->ToString() << std::endl;
-                }
+            if (!shape_.ExistsInorder(inorder_id)) {
+              continue;
+            }
+            auto& entry = inorder_switches_.Get(inorder_id);
+            if (entry.type_ == SwitchType::SGRS) {
+              auto sgrs = SGRS(entry.level_, entry.pos_);
+              SGRS_Config config;
+              config.genOutput_ = sgrs.GetGenOutput();
+              config.mode_ = sgrs.GetMode();
+              std::cout << "Switch[" << shape_.GetCompactID(inorder_id) << "]: " << config.ToString() << std::endl;
+            } else if (entry.type_ == SwitchType::DBRS) {
+              auto dbrs = DBRS(entry.level_, entry.pos_);
+              DBRS_Single_Config config;
+              if (entry.half_ == 1) {
+                config.genOutput_ = dbrs.GetGenOutputR();
+                config.mode_ = dbrs.GetModeR();
+              } else {
+                config.genOutput_ = dbrs.GetGenOutputL();
+                config.mode_ = dbrs.GetModeL();
+              }
+              std::cout << "Switch[" << shape_.GetCompactID(inorder_id) << "]: " << config.ToString() << std::endl;
+            }
+          }
+        }
+
+        /*
+          Collects the adder switch configurations in the order the RN
+          configuration memory expects them: a depth-first walk from the root
+          that visits the right input of every switch before the left one.
+        */
+        RNConfig GetRNConfig() {
+          RNConfig ret;
+          ret.switches_.reserve(num_adder_switches_);
+
+          std::vector<int> stack;
+          stack.reserve(num_levels_ + 2);
+          stack.push_back(num_adder_switches_ / 2);
+          while (!stack.empty()) {
+            int id = stack.back();
+            stack.pop_back();
+            // -1: input from a multiplier switch; switches over missing leaves of a truncated tree are not emitted
+            if (!shape_.ExistsInorder(id)) {
+              continue;
+            }
+
+            AdderSwitchConfig config;
+            auto& entry = inorder_switches_.Get(id);
+            config.type_ = entry.type_;
+            if (entry.type_ == SwitchType::SGRS) {
+              auto sgrs = SGRS(entry.level_, entry.pos_);
+              config.genOutput_ = sgrs.GetGenOutput();
+              config.sgrs_mode_ = sgrs.GetMode();
+              stack.push_back(sgrs.GetInput_ID_L());
+              stack.push_back(sgrs.GetInput_ID_R());
+            } else if (entry.type_ == SwitchType::DBRS) {
+              auto dbrs = DBRS(entry.level_, entry.pos_);
+              if (entry.half_ == 1) {
+                config.genOutput_ = dbrs.GetGenOutputR();
+                config.dbrs_mode_ = dbrs.GetModeR();
+                stack.push_back(dbrs.GetInput_ID_RL());
+                stack.push_back(dbrs.GetInput_ID_RR());
+              } else {
+                config.genOutput_ = dbrs.GetGenOutputL();
+                config.dbrs_mode_ = dbrs.GetModeL();
+                stack.push_back(dbrs.GetInput_ID_LL());
+                stack.push_back(dbrs.GetInput_ID_LR());
               }
             }
+#ifdef DEBUG
+            std::cout << "id:" << id << ", level & position: " << entry.level_ << ", " << entry.pos_ << std::endl;
+#endif
+            if (config.genOutput_) {
+              ret.output_buff_valid_.push_back(shape_.GetCompactID(id));
+            }
+            ret.switches_.push_back(config);
           }
+
+          return ret;
         }
 
         std::shared_ptr<std::vector<std::shared_ptr<SGRS_Config>>> GetSGRS_Config() {
           std::shared_ptr<std::vector<std::shared_ptr<SGRS_Config>>> sgrs_configs = std::make_shared<std::vector<std::shared_ptr<SGRS_Config>>>();
 
-          for(auto sgl_vec_it: single_reduction_switches_) {
-            for(auto sgrs : sgl_vec_it) {
-              auto config = std::make_shared<SGRS_Config>();
-              config->genOutput_ = sgrs->GetGenOutput();
-              config->mode_ = sgrs->GetMode();
-              sgrs_configs->push_back(config);
-            }
+          for(int idx = 0; idx < tree_.GetTotalNumSGRS(); idx++) {
+            auto config = std::make_shared<SGRS_Config>();
+            config->genOutput_ = tree_.sgrs_gen_output_[idx];
+            config->mode_ = tree_.sgrs_mode_[idx];
+            sgrs_configs->push_back(config);
           }
 
           return sgrs_configs;
@@ -527,36 +378,25 @@ namespace MAERI {
         std::shared_ptr<std::vector<std::shared_ptr<DBRS_Config>>> GetDBRS_Config() {
           std::shared_ptr<std::vector<std::shared_ptr<DBRS_Config>>> dbrs_configs = std::make_shared<std::vector<std::shared_ptr<DBRS_Config>>>();
 
-          for(auto dbl_vec_it: double_reduction_switches_) {
-            for(auto dbrs : dbl_vec_it) {
-              auto config = std::make_shared<DBRS_Config>();
-              config->genOutputL_ = dbrs->GetGenOutputL();
-              config->genOutputR_ = dbrs->GetGenOutputR();
-              config->modeL_ = dbrs->GetModeL();
-              config->modeR_ = dbrs->GetModeR();
-              dbrs_configs->push_back(config);
-            }
+          for(int idx = 0; idx < tree_.GetTotalNumDBRS(); idx++) {
+            auto config = std::make_shared<DBRS_Config>();
+            config->genOutputL_ = tree_.dbrs_gen_output_[idx * 2];
+            config->genOutputR_ = tree_.dbrs_gen_output_[idx * 2 + 1];
+            config->modeL_ = tree_.dbrs_mode_[idx * 2];
+            config->modeR_ = tree_.dbrs_mode_[idx * 2 + 1];
+            dbrs_configs->push_back(config);
           }
 
           return dbrs_configs;
         }
 
-        std::map<int, std::pair<int, int>> GetSGRS_Inorder_Map() {
-          return inorder_single_reduction_swtiches;
-        }
-
-        std::map<int, std::pair<int, int>> GetDBRS_Inorder_Map() {
-          return inorder_double_reduction_swtiches;
-        }
-
-        std::vector<std::vector<std::shared_ptr<SingleReductionSwitch>>> GetSGRS_Switches() {
-          return single_reduction_switches_;
+        InorderSwitchIndex& GetInorderSwitchIndex() {
+          return inorder_switches_;
         }
 
-        std::vector<std::vector<std::shared_ptr<DoubleReductionSwitch>>> GetDBRS_Switches() {
-          return double_reduction_switches_;
+        ReductionTree& GetReductionTree() {
+          return tree_;
         }
-        
 
     }; // End of class AbstractReductionNetwork
   }; // End of namespace ReductionNetwork
@@ -0,0 +1,315 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef RN_CLOSED_FORM_RN_CONFIG_H_
+#define RN_CLOSED_FORM_RN_CONFIG_H_
+
+#include <vector>
+#include <utility>
+
+#include "switch_modes.hpp"
+#include "switch_config.hpp"
+#include "tree_shape.hpp"
+#include "vn_placement.hpp"
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    /*
+      Derives the RN configuration directly from a leaf assignment.
+      The adder switches are treated as a binary tree of columns: column c of
+      level lv reduces the outputs of columns 2c and 2c+1 of level lv+1 (or
+      leaves 2c and 2c+1 at the lowest level). Each column is an edge SGRS or
+      one half of a DBRS, which may also take its neighbour half's inner input.
+      One bottom-up pass over per-level (vn, vn size, psum) arrays yields every
+      mode and genOutput bit; no switch, port or connection state is built.
+      The result matches AbstractReductionNetwork::GetRNConfig() bit for bit.
+      A truncated tree (see TreeShape) is processed as the full tree whose
+      missing leaves never carry a packet; its missing switches are skipped
+      when serializing.
+    */
+    class ClosedFormRNConfigGenerator {
+      protected:
+        TreeShape shape_;
+        int num_mult_switches_;
+        int num_adder_switches_;   // Of the full tree
+        int num_levels_;
+
+        // Column outputs of every level; level num_levels_ holds the leaves. vn -1 marks no packet
+        std::vector<std::vector<int>> vn_, size_, psums_;
+
+        std::vector<AdderSwitchConfig> inorder_config_;
+
+        // In-order IDs in RN_Config.vmh order and the inverse mapping
+        std::vector<int> traversal_order_;
+        std::vector<int> traversal_pos_;
+
+        int InorderID(int level, int column) {
+          int stride = 1 << (num_levels_ - 1 - level);
+          return stride - 1 + 2 * column * stride;
+        }
+
+        void Emit(int level, int column, int vn, int vn_size, int num_psums) {
+          vn_[level][column] = vn;
+          size_[level][column] = vn_size;
+          psums_[level][column] = num_psums;
+        }
+
+        void ProcessSGRS(int level, int column) {
+          auto& in_vn_ = vn_[level + 1];
+          auto& in_size_ = size_[level + 1];
+          auto& in_psums_ = psums_[level + 1];
+
+          int l = 2 * column;
+          int r = 2 * column + 1;
+          int vn_L = in_vn_[l];
+          int vn_R = in_vn_[r];
+
+          auto& config = inorder_config_[InorderID(level, column)];
+          config = AdderSwitchConfig();
+          config.type_ = SwitchType::SGRS;
+          Emit(level, column, -1, -1, -1);
+
+          if(vn_L != -1 && vn_L == vn_R) {
+            int num_psums = in_psums_[l] + in_psums_[r];
+            config.sgrs_mode_ = SGRS_Mode::AddTwo;
+            if(in_size_[l] == num_psums) {
+              config.genOutput_ = true;
+            } else {
+              Emit(level, column, vn_L, in_size_[l], num_psums);
+            }
+          }
+          else if(vn_L == -1 && vn_R != -1) {
+            config.sgrs_mode_ = SGRS_Mode::FlowRight;
+            Emit(level, column, vn_R, in_size_[r], in_psums_[r]);
+          }
+          else if(vn_L != -1 && vn_R == -1) {
+            config.sgrs_mode_ = SGRS_Mode::FlowLeft;
+            if(in_size_[l] == 1 && in_psums_[l] == 1) {
+              config.genOutput_ = true;
+            } else {
+              Emit(level, column, vn_L, in_size_[l], in_psums_[l]);
+            }
+          }
+        }
+
+        DBRS_SubMode AddMode(int num_packets) {
+          switch(num_packets) {
+            case 4:
+            case 2:
+              return DBRS_SubMode::AddTwo;
+            case 3:
+              return DBRS_SubMode::AddThree;
+            case 1:
+              return DBRS_SubMode::AddOne;
+            default:
+              return DBRS_SubMode::Idle;
+          }
+        }
+
+        // DBRS d of a level owns columns 1+2d (L half) and 2+2d (R half)
+        void ProcessDBRS(int level, int dbrs_id) {
+          auto& in_vn_ = vn_[level + 1];
+          auto& in_size_ = size_[level + 1];
+          auto& in_psums_ = psums_[level + 1];
+
+          int col_L = 1 + 2 * dbrs_id;
+          int col_R = col_L + 1;
+          int port0 = 2 * col_L;
+
+          int vn_L = in_vn_[port0];
+          int vn_R = in_vn_[port0 + 3];
+
+          // A packet joins the L half if it belongs to port 0's VN, otherwise the R half if it belongs to port 3's VN
+          int num_L = 0, num_R = 0, psums_L = 0, psums_R = 0;
+          for(int port = port0; port < port0 + 4; port++) {
+            int vn = in_vn_[port];
+            if(vn == -1) {
+              continue;
+            }
+            if(vn == vn_L) {
+              num_L++;
+              psums_L += in_psums_[port];
+            } else if(vn == vn_R) {
+              num_R++;
+              psums_R += in_psums_[port];
+            }
+          }
+
+          DBRS_SubMode mode_L = AddMode(num_L);
+          DBRS_SubMode mode_R = (num_R == 0 && num_L == 4)? DBRS_SubMode::AddTwo : AddMode(num_R);
+          bool split_pairs = (mode_L == DBRS_SubMode::AddTwo && mode_R == DBRS_SubMode::AddTwo);
+
+          auto& config_L = inorder_config_[InorderID(level, col_L)];
+          auto& config_R = inorder_config_[InorderID(level, col_R)];
+          config_L = AdderSwitchConfig();
+          config_R = AdderSwitchConfig();
+          config_L.type_ = SwitchType::DBRS;
+          config_L.dbrs_mode_ = mode_L;
+          config_R.type_ = SwitchType::DBRS;
+          config_R.dbrs_mode_ = mode_R;
+
+          Emit(level, col_L, -1, -1, -1);
+          Emit(level, col_R, -1, -1, -1);
+
+          // A VN on all four ports is split between the halves, so neither half holds all of its psums
+          if(split_pairs) {
+            psums_L = in_psums_[port0] + in_psums_[port0 + 1];
+            psums_R = in_psums_[port0 + 2] + in_psums_[port0 + 3];
+          }
+          if(vn_L != -1) {
+            int size_L = in_size_[port0];
+            if(size_L == psums_L) {
+              config_L.genOutput_ = true;
+            } else {
+              Emit(level, col_L, vn_L, size_L, psums_L);
+            }
+          }
+          if(vn_R != -1) {
+            int size_R = in_size_[port0 + 3];
+            if(size_R == psums_R) {
+              config_R.genOutput_ = true;
+            } else {
+              Emit(level, col_R, vn_R, size_R, psums_R);
+            }
+          }
+        }
+
+        // Recomputes the switch(es) of one column from the outputs of the level below
+        void ProcessColumn(int level, int column) {
+          int num_columns = 1 << level;
+          if(column == 0 || column == num_columns - 1) {
+            ProcessSGRS(level, column);
+          } else {
+            ProcessDBRS(level, (column - 1) / 2);
+          }
+        }
+
+        // The lowest level only registers switches that received a packet or were marked idle
+        bool IsRegistered(const LeafAssignment& leaves, int column) {
+          return leaves.IsAssigned(2 * column) || leaves.IsAssigned(2 * column + 1)
+                 || (leaves.idle_start_ != -1 && 2 * column + 1 >= leaves.idle_start_);
+        }
+
+        void SetLeaves(const LeafAssignment& leaves) {
+          vn_[num_levels_] = leaves.vn_id_;
+          size_[num_levels_] = leaves.vn_size_;
+        }
+
+        // Same order as AbstractReductionNetwork::GetRNConfig(): root first, right input before left input
+        void BuildTraversalOrder() {
+          traversal_order_.reserve(num_adder_switches_);
+          traversal_pos_.assign(num_adder_switches_, -1);
+
+          std::vector<std::pair<int, int>> stack;   // (in-order ID, stride)
+          stack.reserve(num_levels_ + 2);
+          stack.push_back(std::make_pair(num_adder_switches_ / 2, 1 << (num_levels_ - 1)));
+          while(!stack.empty()) {
+            int id = stack.back().first;
+            int stride = stack.back().second;
+            stack.pop_back();
+
+            traversal_pos_[id] = static_cast<int>(traversal_order_.size());
+            traversal_order_.push_back(id);
+
+            if(stride > 1) {
+              stack.push_back(std::make_pair(id - stride / 2, stride / 2));
+              if(shape_.ExistsInorder(id + stride / 2)) {
+                stack.push_back(std::make_pair(id + stride / 2, stride / 2));
+              }
+            }
+          }
+        }
+
+        RNConfig Serialize() {
+          RNConfig ret;
+          ret.switches_.reserve(traversal_order_.size());
+
+          for(auto id : traversal_order_) {
+            auto& config = inorder_config_[id];
+            if(config.genOutput_) {
+              ret.output_buff_valid_.push_back(shape_.GetCompactID(id));
+            }
+            ret.switches_.push_back(config);
+          }
+
+          return ret;
+        }
+
+      public:
+        ClosedFormRNConfigGenerator(int numMultSwitches) :
+          shape_(numMultSwitches),
+          num_mult_switches_(numMultSwitches),
+          num_adder_switches_(shape_.GetNumLeaves() - 1),
+          num_levels_(shape_.GetNumLevels()) {
+
+          vn_.resize(num_levels_ + 1);
+          size_.resize(num_levels_ + 1);
+          psums_.resize(num_levels_ + 1);
+          for(int lv = 0; lv <= num_levels_; lv++) {
+            vn_[lv].assign(1 << lv, -1);
+            size_[lv].assign(1 << lv, -1);
+            psums_[lv].assign(1 << lv, -1);
+          }
+          psums_[num_levels_].assign(shape_.GetNumLeaves(), 1);
+
+          inorder_config_.assign(num_adder_switches_, AdderSwitchConfig());
+          BuildTraversalOrder();
+        }
+
+        RNConfig Generate(const LeafAssignment& leaves) {
+          SetLeaves(leaves);
+
+          for(int lv = num_levels_ - 1; lv >= 0; lv--) {
+            int num_columns = 1 << lv;
+            ProcessSGRS(lv, 0);
+            if(lv > 0) {
+              ProcessSGRS(lv, num_columns - 1);
+            }
+            for(int d = 0; d < num_columns / 2 - 1; d++) {
+              ProcessDBRS(lv, d);
+            }
+          }
+
+          for(int column = 0; column < shape_.GetNumLeaves() / 2; column++) {
+            if(!IsRegistered(leaves, column)) {
+              inorder_config_[InorderID(num_levels_ - 1, column)] = AdderSwitchConfig();
+            }
+          }
+
+          return Serialize();
+        }
+
+        int GetTraversalPosition(int inorder_id) {
+          return traversal_pos_[inorder_id];
+        }
+
+    }; // End of class ClosedFormRNConfigGenerator
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
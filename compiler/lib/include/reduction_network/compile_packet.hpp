@@ -26,14 +26,20 @@ Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
 #ifndef RN_COMPILER_PACKET_H_
 #define RN_COMPILER_PACKET_H_
 
+#include <type_traits>
+
 namespace MAERI {
   namespace ReductionNetwork {
+    /*
+      Plain value type; packets are copied into the port slots of a
+      ReductionTree and never live on the heap.
+    */
     class CompilePacket {
       protected:
-        bool is_valid_ = false;
         int vn_id_;
         int vn_size_;
         int num_accumulated_psums_;
+        bool is_valid_;
 
       public:
         CompilePacket () :
@@ -50,7 +56,14 @@ namespace MAERI {
           is_valid_(true) {
         }
 
-        bool IsValid() {
+        CompilePacket (int vn_id, int vn_size, int num_accumulated_psums, bool is_valid) :
+          vn_id_(vn_id),
+          vn_size_(vn_size),
+          num_accumulated_psums_(num_accumulated_psums),
+          is_valid_(is_valid) {
+        }
+
+        bool IsValid() const {
           return is_valid_;
         }
 
@@ -58,19 +71,22 @@ namespace MAERI {
           is_valid_ = false;
         }
 
-        int GetVNID() {
+        int GetVNID() const {
           return vn_id_;
         }
 
-        int GetVNSize() {
+        int GetVNSize() const {
           return vn_size_;
         }
 
-        int GetNumPSums() {
+        int GetNumPSums() const {
           return num_accumulated_psums_;
         }
 
     }; //End of class CompilePacket
+
+    static_assert(std::is_trivially_copyable<CompilePacket>::value, "CompilePacket must stay a trivially copyable value type");
+
   };  // End of namespace ReductionNetwork
 };  // End of namespace MAERI
 
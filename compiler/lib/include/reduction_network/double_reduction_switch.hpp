@@ -27,92 +27,64 @@ Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
 #ifndef RN_DBLRS_H_
 #define RN_DBLRS_H_
 
-#include <memory>
+#include <iostream>
 #include <vector>
-#include <list>
 #include <string>
 #include "compile_packet.hpp"
 #include "switch_modes.hpp"
+#include "reduction_tree.hpp"
 
 //#define DEBUG
 
 namespace MAERI {
   namespace ReductionNetwork {
+    /*
+      Lightweight handle to one DBRS stored in a ReductionTree.
+      Handles do not own any state and can be created on the fly.
+    */
     class DoubleReductionSwitch {
       protected:
+        ReductionTree* tree_;
+        int idx_;
 
-        bool genOutputL_;
-        bool genOutputR_;
-
-        int input_ID_LL_;
-        int input_ID_LR_;
-        int input_ID_RL_;
-        int input_ID_RR_;
-
-        int vn_nums;
-        int free_ports;
-        int vns[2];
-
-        DBRS_SubMode modeL_ = DBRS_SubMode::Idle;
-        DBRS_SubMode modeR_ = DBRS_SubMode::Idle;
+        int InSlot(int port) {
+          return idx_ * ReductionTree::DBRS_NUM_INPUTS + port;
+        }
 
-        std::vector<std::shared_ptr<CompilePacket>> input_packets_;
-        std::vector<std::shared_ptr<CompilePacket>> output_packets_;
+        int OutSlot(int port) {
+          return idx_ * ReductionTree::DBRS_NUM_OUTPUTS + port;
+        }
 
       public:
         int switch_id = 0;
 
-        DoubleReductionSwitch() :
-          genOutputL_(false),
-          genOutputR_(false),
-          modeL_(DBRS_SubMode::Idle),
-          modeR_(DBRS_SubMode::Idle),
-          input_ID_LL_(-1),
-          input_ID_LR_(-1),
-          input_ID_RL_(-1),
-          input_ID_RR_(-1),
-          vn_nums(0),
-          free_ports(4)
+        DoubleReductionSwitch(ReductionTree* tree, int level, int pos) :
+          tree_(tree),
+          idx_(tree->DBRS_Index(level, pos))
         {
-          for(int injCount = 0; injCount < 4; injCount++) {
-            auto invalid_packet = std::make_shared<CompilePacket>();
-            input_packets_.push_back(invalid_packet);
-          }
-
-          for(int injCount = 0; injCount < 2; injCount++) {
-            auto invalid_packet = std::make_shared<CompilePacket>();
-            output_packets_.push_back(invalid_packet);
-          }
-
-          for (int i = 0; i < 2; i++) {
-            vns[i] = -1;
-          }
+          switch_id = idx_;
         }
 
         void SetIDConnect(int ID, int pos) {
-          switch(pos) {
-            case 3:
-              input_ID_RR_ = ID;
-              break;
-            case 2:
-              input_ID_RL_ = ID;
-              break;
-            case 1:
-              input_ID_LR_ = ID;
-              break;
-            case 0:
-              input_ID_LL_ = ID;
-              break;
-            default:
-              return;
+          if(pos < 0 || pos > 3) {
+            return;
           }
+          tree_->dbrs_input_id_[InSlot(pos)] = ID;
         }
 
-        void PutPacket(std::shared_ptr<CompilePacket> inPacket, int port) {
+        void PutPacket(const CompilePacket& inPacket, int port) {
           if(port < 4) {
-            input_packets_[port] = inPacket;
-            free_ports -= 1;
-            int vn_id = inPacket->GetVNID();
+            auto& in = tree_->dbrs_in_;
+            int slot = InSlot(port);
+            in.vn_id_[slot] = inPacket.GetVNID();
+            in.vn_size_[slot] = inPacket.GetVNSize();
+            in.num_psums_[slot] = inPacket.GetNumPSums();
+            in.valid_[slot] = inPacket.IsValid();
+
+            tree_->dbrs_free_ports_[idx_] -= 1;
+            int vn_id = inPacket.GetVNID();
+            int& vn_nums = tree_->dbrs_vn_nums_[idx_];
+            int* vns = &tree_->dbrs_vns_[idx_ * 2];
             if (vn_nums == 0) {
               vns[0] = vn_id;
               vn_nums++;
@@ -123,17 +95,21 @@ namespace MAERI {
           }
         }
 
-        std::shared_ptr<CompilePacket> GetPacket(int port) {
+        CompilePacket GetPacket(int port) {
           if(port < 2) {
-            auto ret = output_packets_[port];
-            return ret;
+            auto& out = tree_->dbrs_out_;
+            int slot = OutSlot(port);
+            return CompilePacket(out.vn_id_[slot], out.vn_size_[slot], out.num_psums_[slot], out.valid_[slot]);
           }
           else {
-            return nullptr;
+            return CompilePacket();
           }
         }
 
         void ProcessPackets() {
+          auto& in = tree_->dbrs_in_;
+          int in_base = InSlot(0);
+
           int vn_L = -1;
           int vn_R = -1;
 
@@ -146,23 +122,23 @@ namespace MAERI {
           int vn_L_num_accumulated_psums = 0;
           int vn_R_num_accumulated_psums = 0;
 
-          if(input_packets_[0]->IsValid()) {
-            vn_L = input_packets_[0]->GetVNID();
-            vn_L_size = input_packets_[0]->GetVNSize();
+          if(in.valid_[in_base]) {
+            vn_L = in.vn_id_[in_base];
+            vn_L_size = in.vn_size_[in_base];
           }
 
-          if(input_packets_[3]->IsValid()) {
-            vn_R = input_packets_[3]->GetVNID();
-            vn_R_size = input_packets_[3]->GetVNSize();
+          if(in.valid_[in_base + 3]) {
+            vn_R = in.vn_id_[in_base + 3];
+            vn_R_size = in.vn_size_[in_base + 3];
           }
 
-          for(auto inPkt : input_packets_) {
-            if(inPkt->IsValid() && inPkt->GetVNID() == vn_L) {
-              vn_L_num_accumulated_psums += inPkt->GetNumPSums();
+          for(int slot = in_base; slot < in_base + ReductionTree::DBRS_NUM_INPUTS; slot++) {
+            if(in.valid_[slot] && in.vn_id_[slot] == vn_L) {
+              vn_L_num_accumulated_psums += in.num_psums_[slot];
               vn_L_num_packets++;
             }
-            else if(inPkt->IsValid() && inPkt->GetVNID() == vn_R) {
-              vn_R_num_accumulated_psums += inPkt->GetNumPSums();
+            else if(in.valid_[slot] && in.vn_id_[slot] == vn_R) {
+              vn_R_num_accumulated_psums += in.num_psums_[slot];
               vn_R_num_packets++;
             }
           }
@@ -170,6 +146,9 @@ namespace MAERI {
           std::cout << "DBRS " << switch_id << ", vn_L =  " << vn_L << ", vn_R = " << vn_R << ", NumLPackets = " << vn_L_num_packets << ", NumRPackets = " << vn_R_num_packets << ", accumulatedL = " << vn_L_num_accumulated_psums << ", accumulatedR = " << vn_R_num_accumulated_psums <<std::endl;
 #endif
 
+          DBRS_SubMode& modeL_ = tree_->dbrs_mode_[idx_ * 2];
+          DBRS_SubMode& modeR_ = tree_->dbrs_mode_[idx_ * 2 + 1];
+
           //Determine the switch modes
           switch(vn_L_num_packets) {
             case 4:
@@ -213,6 +192,7 @@ namespace MAERI {
 
 
 
+#ifdef DEBUG
           std::string ret = ", ModeL: ";
           if (modeL_ == DBRS_SubMode::AddOne) {
             ret += "AddOne";
@@ -241,86 +221,92 @@ namespace MAERI {
             ret += "Idle";
           }
 
-#ifdef DEBUG
           std::cout << "DBRS " << switch_id << " " << ret << std::endl;
 #endif
 
-          // Determine output packets and genOutputL
+          // Determine output packets and genOutputL; a VN on all four ports is split between the halves
           if(vn_L != -1) {
-            if(vn_L_size == vn_L_num_accumulated_psums) {
-              genOutputL_ = true;
+            int pSumL = (modeL_ == DBRS_SubMode::AddTwo && modeR_ == DBRS_SubMode::AddTwo)? in.num_psums_[in_base] + in.num_psums_[in_base + 1] : vn_L_num_accumulated_psums;
+            if(vn_L_size == pSumL) {
+              tree_->dbrs_gen_output_[idx_ * 2] = true;
             }
             else {
-              int pSumL = (modeL_ == DBRS_SubMode::AddTwo && modeR_ == DBRS_SubMode::AddTwo)? input_packets_[0]->GetNumPSums() + input_packets_[1]->GetNumPSums() : vn_L_num_accumulated_psums;
-              auto outL = std::make_shared<CompilePacket>(vn_L, vn_L_size, pSumL);
 #ifdef DEBUG
               std::cout << "DBRS " << switch_id << " Sends out a packet to Port " << 0 << "(L) with vnId:" << vn_L << ", vn_size: " << vn_L_size << ", pSums: " << pSumL << std::endl;
 #endif
-              output_packets_[0] = outL;
+              SetOutput(0, vn_L, vn_L_size, pSumL);
             }
           }
           if(vn_R != -1 || modeR_ == DBRS_SubMode::AddTwo) {
-            if(vn_R_size == vn_R_num_accumulated_psums) {
-              genOutputR_ = true;
+            int pSumR = (modeL_ == DBRS_SubMode::AddTwo && modeR_ == DBRS_SubMode::AddTwo)? in.num_psums_[in_base + 2] + in.num_psums_[in_base + 3] : vn_R_num_accumulated_psums;
+            if(vn_R_size == pSumR) {
+              tree_->dbrs_gen_output_[idx_ * 2 + 1] = true;
             }
             else {
-              int pSumR = (modeL_ == DBRS_SubMode::AddTwo && modeR_ == DBRS_SubMode::AddTwo)? input_packets_[2]->GetNumPSums() + input_packets_[3]->GetNumPSums() : vn_R_num_accumulated_psums;
-              auto outR = std::make_shared<CompilePacket>(vn_R, vn_R_size, pSumR);
 #ifdef DEBUG
               std::cout << "DBRS " << switch_id << " Sends out a packet to Port " << 1 << "(R) with vnId:" << vn_R << ", vn_size: " << vn_R_size << ", pSums: " << pSumR << std::endl;
 #endif
-              output_packets_[1] = outR;
+              SetOutput(1, vn_R, vn_R_size, pSumR);
             }
           }
 
-          for(auto it : input_packets_) {
-            it->Invalidate();
+          for(int slot = in_base; slot < in_base + ReductionTree::DBRS_NUM_INPUTS; slot++) {
+            in.valid_[slot] = false;
           }
 
         } // End of void ProcessPackets()
 
+        void SetOutput(int port, int vn_id, int vn_size, int num_psums) {
+          auto& out = tree_->dbrs_out_;
+          int slot = OutSlot(port);
+          out.vn_id_[slot] = vn_id;
+          out.vn_size_[slot] = vn_size;
+          out.num_psums_[slot] = num_psums;
+          out.valid_[slot] = true;
+        }
+
         bool GetGenOutputL() {
-          return genOutputL_;
+          return tree_->dbrs_gen_output_[idx_ * 2];
         }
 
         bool GetGenOutputR() {
-          return genOutputR_;
+          return tree_->dbrs_gen_output_[idx_ * 2 + 1];
         }
 
         DBRS_SubMode GetModeL() {
-          return modeL_;
+          return tree_->dbrs_mode_[idx_ * 2];
         }
 
         DBRS_SubMode GetModeR() {
-          return modeR_;
+          return tree_->dbrs_mode_[idx_ * 2 + 1];
         }
 
         int GetInput_ID_LL() {
-          return input_ID_LL_;
+          return tree_->dbrs_input_id_[InSlot(0)];
         }
 
         int GetInput_ID_LR() {
-          return input_ID_LR_;
+          return tree_->dbrs_input_id_[InSlot(1)];
         }
 
         int GetInput_ID_RL() {
-          return input_ID_RL_;
+          return tree_->dbrs_input_id_[InSlot(2)];
         }
 
         int GetInput_ID_RR() {
-          return input_ID_RR_;
+          return tree_->dbrs_input_id_[InSlot(3)];
         }
 
         int GetVN_Nums() {
-          return vn_nums;
+          return tree_->dbrs_vn_nums_[idx_];
         }
 
         int GetFreePorts() {
-          return free_ports;
+          return tree_->dbrs_free_ports_[idx_];
         }
 
         bool CheckIfSameID(int vn_id) {
-          return vn_id == vns[0] || vn_id == vns[1];
+          return vn_id == tree_->dbrs_vns_[idx_ * 2] || vn_id == tree_->dbrs_vns_[idx_ * 2 + 1];
         }
 
     };
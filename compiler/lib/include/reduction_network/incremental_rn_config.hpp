@@ -0,0 +1,255 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef RN_INCREMENTAL_RN_CONFIG_H_
+#define RN_INCREMENTAL_RN_CONFIG_H_
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "switch_modes.hpp"
+#include "switch_config.hpp"
+#include "vn_placement.hpp"
+#include "closed_form_rn_config.hpp"
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    /*
+      One edit of a non-uniform VN list, applied in order:
+      vn_id_ < list size and vn_size_ > 0 resizes that VN,
+      vn_id_ < list size and vn_size_ == 0 removes it,
+      vn_id_ == list size appends a VN of vn_size_.
+    */
+    class VNSizeChange {
+      public:
+        int vn_id_;
+        int vn_size_;
+
+        VNSizeChange(int vn_id, int vn_size) :
+          vn_id_(vn_id),
+          vn_size_(vn_size) {
+        }
+    }; // End of class VNSizeChange
+
+    /*
+      Keeps the configuration of a non-uniform layout and updates it in place.
+      After a delta, the VNs are re-placed and only the lowest-level columns
+      whose leaf packets (or idle registration) changed are recomputed; a
+      parent column is recomputed only if one of its input packets changed.
+      GetChangedWords() lists the RN_Config.vmh words the last update touched.
+    */
+    class IncrementalRNConfigCompiler : public ClosedFormRNConfigGenerator {
+      protected:
+        std::vector<int> vn_sizes_;
+        LeafAssignment leaves_;
+        RNConfig rn_config_;
+
+        std::vector<int> changed_words_;
+        bool output_buff_valid_changed_;
+
+        void RebuildOutputBuffValid() {
+          rn_config_.output_buff_valid_.clear();
+          for(auto id : traversal_order_) {
+            if(inorder_config_[id].genOutput_) {
+              rn_config_.output_buff_valid_.push_back(shape_.GetCompactID(id));
+            }
+          }
+        }
+
+        void RecordChange(int inorder_id, const AdderSwitchConfig& old_config) {
+          auto& config = inorder_config_[inorder_id];
+          if(config == old_config) {
+            return;
+          }
+
+          int pos = traversal_pos_[inorder_id];
+          if(pos == -1) {   // Missing switch of a truncated tree
+            return;
+          }
+          rn_config_.switches_[pos] = config;
+          changed_words_.push_back(pos / SWITCHES_PER_WORD);
+          if(config.genOutput_ != old_config.genOutput_) {
+            output_buff_valid_changed_ = true;
+          }
+        }
+
+        bool OutputChanged(int level, int column, int old_vn, int old_size, int old_psums) {
+          return vn_[level][column] != old_vn || size_[level][column] != old_size || psums_[level][column] != old_psums;
+        }
+
+        void Propagate(const LeafAssignment& old_leaves) {
+          std::vector<int> dirty;
+          for(int column = 0; column < shape_.GetNumLeaves() / 2; column++) {
+            bool leaves_changed = false;
+            for(int leaf = 2 * column; leaf < 2 * column + 2; leaf++) {
+              leaves_changed |= leaves_.vn_id_[leaf] != old_leaves.vn_id_[leaf] || leaves_.vn_size_[leaf] != old_leaves.vn_size_[leaf];
+            }
+            if(leaves_changed || IsRegistered(leaves_, column) != IsRegistered(old_leaves, column)) {
+              dirty.push_back(column);
+            }
+          }
+
+          for(int lv = num_levels_ - 1; lv >= 0 && !dirty.empty(); lv--) {
+            int num_columns = 1 << lv;
+            std::vector<int> parents;
+            int last_processed = -1;
+
+            for(auto column : dirty) {
+              // A DBRS owns two neighbouring columns; recompute it once
+              int first = column;
+              int last = column;
+              if(column != 0 && column != num_columns - 1) {
+                first = (column % 2 == 1)? column : column - 1;
+                last = first + 1;
+              }
+              if(first <= last_processed) {
+                continue;
+              }
+              last_processed = last;
+
+              AdderSwitchConfig old_config[2];
+              int old_vn[2], old_size[2], old_psums[2];
+              for(int col = first; col <= last; col++) {
+                old_config[col - first] = inorder_config_[InorderID(lv, col)];
+                old_vn[col - first] = vn_[lv][col];
+                old_size[col - first] = size_[lv][col];
+                old_psums[col - first] = psums_[lv][col];
+              }
+
+              ProcessColumn(lv, column);
+
+              for(int col = first; col <= last; col++) {
+                int id = InorderID(lv, col);
+                if(lv == num_levels_ - 1 && !IsRegistered(leaves_, col)) {
+                  inorder_config_[id] = AdderSwitchConfig();
+                }
+                RecordChange(id, old_config[col - first]);
+
+                if(OutputChanged(lv, col, old_vn[col - first], old_size[col - first], old_psums[col - first])
+                   && (parents.empty() || parents.back() != col / 2)) {
+                  parents.push_back(col / 2);
+                }
+              }
+            }
+
+            dirty.swap(parents);
+          }
+        }
+
+      public:
+        static constexpr int SWITCHES_PER_WORD = 8;
+
+        IncrementalRNConfigCompiler(int numMultSwitches) :
+          ClosedFormRNConfigGenerator(numMultSwitches),
+          leaves_(shape_.GetNumLeaves()),
+          output_buff_valid_changed_(false) {
+        }
+
+        // Full compilation; every word counts as changed
+        bool Compile(const std::vector<int>& vn_sizes) {
+          auto leaves = VNPlacement::PlaceNonUniform(num_mult_switches_, vn_sizes);
+          if(!leaves.valid_) {
+            return false;
+          }
+
+          vn_sizes_ = vn_sizes;
+          leaves_ = leaves;
+          rn_config_ = Generate(leaves_);
+
+          changed_words_.clear();
+          int num_words = (static_cast<int>(traversal_order_.size()) + SWITCHES_PER_WORD - 1) / SWITCHES_PER_WORD;
+          for(int word = 0; word < num_words; word++) {
+            changed_words_.push_back(word);
+          }
+          output_buff_valid_changed_ = true;
+          return true;
+        }
+
+        // Returns false, leaving the current layout untouched, if the delta or the resulting layout is invalid
+        bool ApplyDelta(const std::vector<VNSizeChange>& delta) {
+          std::vector<int> vn_sizes = vn_sizes_;
+          for(auto& change : delta) {
+            int num_vns = static_cast<int>(vn_sizes.size());
+            if(change.vn_id_ < 0 || change.vn_id_ > num_vns || change.vn_size_ < 0
+               || (change.vn_id_ == num_vns && change.vn_size_ == 0)) {
+              std::cerr << "ERROR: Invalid VN size change (VN " << change.vn_id_ << ", size " << change.vn_size_ << ")" << std::endl;
+              return false;
+            }
+
+            if(change.vn_id_ == num_vns) {
+              vn_sizes.push_back(change.vn_size_);
+            } else if(change.vn_size_ == 0) {
+              vn_sizes.erase(vn_sizes.begin() + change.vn_id_);
+            } else {
+              vn_sizes[change.vn_id_] = change.vn_size_;
+            }
+          }
+
+          auto leaves = VNPlacement::PlaceNonUniform(num_mult_switches_, vn_sizes);
+          if(!leaves.valid_) {
+            return false;
+          }
+
+          vn_sizes_.swap(vn_sizes);
+          std::swap(leaves_, leaves);
+          SetLeaves(leaves_);
+
+          changed_words_.clear();
+          output_buff_valid_changed_ = false;
+          Propagate(leaves);
+
+          std::sort(changed_words_.begin(), changed_words_.end());
+          changed_words_.erase(std::unique(changed_words_.begin(), changed_words_.end()), changed_words_.end());
+          if(output_buff_valid_changed_) {
+            RebuildOutputBuffValid();
+          }
+          return true;
+        }
+
+        const RNConfig& GetRNConfig() {
+          return rn_config_;
+        }
+
+        const std::vector<int>& GetVNSizes() {
+          return vn_sizes_;
+        }
+
+        const std::vector<int>& GetChangedWords() {
+          return changed_words_;
+        }
+
+        bool OutputBuffValidChanged() {
+          return output_buff_valid_changed_;
+        }
+
+    }; // End of class IncrementalRNConfigCompiler
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,104 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef RN_INORDER_SWITCH_INDEX_H_
+#define RN_INORDER_SWITCH_INDEX_H_
+
+#include <vector>
+
+#include "switch_modes.hpp"
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    class InorderSwitchEntry {
+      public:
+        SwitchType type_ = SwitchType::None;
+        int level_ = -1;
+        int pos_ = -1;
+        int half_ = 0;   // DBRS only; 0: left (L) sub-switch, 1: right (R) sub-switch
+    };
+
+    /*
+      Dense in-order ID -> switch table.
+      In-order IDs enumerate the adder switches left to right; the switch in
+      column c of level lv has ID stride - 1 + 2 * c * stride with
+      stride = 2^(num_levels - 1 - lv).
+    */
+    class InorderSwitchIndex {
+      protected:
+        int num_levels_;
+        std::vector<InorderSwitchEntry> entries_;
+
+      public:
+        InorderSwitchIndex(int num_levels, int num_adder_switches) :
+          num_levels_(num_levels),
+          entries_(num_adder_switches) {
+        }
+
+        // The first registration of an ID wins, as with std::map::insert
+        void InsertSGRS(int inorder_id, int level, int pos) {
+          Insert(inorder_id, SwitchType::SGRS, level, pos, 0);
+        }
+
+        void InsertDBRS(int inorder_id, int level, int pos) {
+          int stride = 1 << (num_levels_ - 1 - level);
+          int column = (inorder_id + 1 - stride) / (2 * stride);
+          Insert(inorder_id, SwitchType::DBRS, level, pos, (column - 1) % 2);
+        }
+
+        const InorderSwitchEntry& Get(int inorder_id) const {
+          return entries_[inorder_id];
+        }
+
+        bool Contains(int inorder_id) const {
+          return inorder_id >= 0 && inorder_id < Size() && entries_[inorder_id].type_ != SwitchType::None;
+        }
+
+        int Size() const {
+          return static_cast<int>(entries_.size());
+        }
+
+      protected:
+        void Insert(int inorder_id, SwitchType type, int level, int pos, int half) {
+          if(inorder_id < 0 || inorder_id >= Size()) {
+            return;
+          }
+          auto& entry = entries_[inorder_id];
+          if(entry.type_ == SwitchType::None) {
+            entry.type_ = type;
+            entry.level_ = level;
+            entry.pos_ = pos;
+            entry.half_ = half;
+          }
+        }
+
+    }; // End of class InorderSwitchIndex
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,158 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+#ifndef RN_REDUCTION_TREE_H_
+#define RN_REDUCTION_TREE_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "switch_modes.hpp"
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    /*
+      Flat storage of one augmented reduction tree.
+      Every per-switch field lives in a single array in which the switches of
+      a level occupy one contiguous range starting at SGRS_Index(lv, 0) and
+      DBRS_Index(lv, 0). Level 0 holds the root SGRS; every other level holds
+      two edge SGRSes and 2^(lv-1)-1 DBRSes. Parent/child relations are
+      implicit in the indices.
+    */
+    class ReductionTree {
+      public:
+        // One entry per switch port
+        class PacketSlots {
+          public:
+            std::vector<int> vn_id_;
+            std::vector<int> vn_size_;
+            std::vector<int> num_psums_;
+            std::vector<uint8_t> valid_;
+
+            void Resize(int num_slots) {
+              vn_id_.assign(num_slots, -1);
+              vn_size_.assign(num_slots, -1);
+              num_psums_.assign(num_slots, -1);
+              valid_.assign(num_slots, 0);
+            }
+        }; // End of class PacketSlots
+
+        static constexpr int SGRS_NUM_INPUTS = 2;
+        static constexpr int SGRS_NUM_OUTPUTS = 1;
+        static constexpr int DBRS_NUM_INPUTS = 4;
+        static constexpr int DBRS_NUM_OUTPUTS = 2;
+
+        /* SGRS fields, indexed by SGRS_Index() */
+        std::vector<SGRS_Mode> sgrs_mode_;
+        std::vector<uint8_t> sgrs_gen_output_;
+        std::vector<int> sgrs_vn_;
+        std::vector<int> sgrs_vn_nums_;
+        std::vector<int> sgrs_free_ports_;
+        std::vector<int> sgrs_input_id_;    // SGRS_NUM_INPUTS per switch
+        PacketSlots sgrs_in_;               // SGRS_NUM_INPUTS per switch
+        PacketSlots sgrs_out_;              // SGRS_NUM_OUTPUTS per switch
+
+        /* DBRS fields, indexed by DBRS_Index(); L/R halves are interleaved */
+        std::vector<DBRS_SubMode> dbrs_mode_;
+        std::vector<uint8_t> dbrs_gen_output_;
+        std::vector<int> dbrs_vns_;
+        std::vector<int> dbrs_vn_nums_;
+        std::vector<int> dbrs_free_ports_;
+        std::vector<int> dbrs_input_id_;    // DBRS_NUM_INPUTS per switch
+        PacketSlots dbrs_in_;               // DBRS_NUM_INPUTS per switch
+        PacketSlots dbrs_out_;              // DBRS_NUM_OUTPUTS per switch
+
+      protected:
+        int num_levels_;
+        std::vector<int> sgrs_level_offset_;
+        std::vector<int> dbrs_level_offset_;
+
+      public:
+        ReductionTree(int num_levels) :
+          num_levels_(num_levels) {
+
+          sgrs_level_offset_.push_back(0);
+          dbrs_level_offset_.push_back(0);
+          for(int lv = 0; lv < num_levels_; lv++) {
+            sgrs_level_offset_.push_back(sgrs_level_offset_.back() + GetNumSGRS(lv));
+            dbrs_level_offset_.push_back(dbrs_level_offset_.back() + GetNumDBRS(lv));
+          }
+
+          int num_sgrs = sgrs_level_offset_.back();
+          sgrs_mode_.assign(num_sgrs, SGRS_Mode::Idle);
+          sgrs_gen_output_.assign(num_sgrs, 0);
+          sgrs_vn_.assign(num_sgrs, -1);
+          sgrs_vn_nums_.assign(num_sgrs, 0);
+          sgrs_free_ports_.assign(num_sgrs, SGRS_NUM_INPUTS);
+          sgrs_input_id_.assign(num_sgrs * SGRS_NUM_INPUTS, -1);
+          sgrs_in_.Resize(num_sgrs * SGRS_NUM_INPUTS);
+          sgrs_out_.Resize(num_sgrs * SGRS_NUM_OUTPUTS);
+
+          int num_dbrs = dbrs_level_offset_.back();
+          dbrs_mode_.assign(num_dbrs * 2, DBRS_SubMode::Idle);
+          dbrs_gen_output_.assign(num_dbrs * 2, 0);
+          dbrs_vns_.assign(num_dbrs * 2, -1);
+          dbrs_vn_nums_.assign(num_dbrs, 0);
+          dbrs_free_ports_.assign(num_dbrs, DBRS_NUM_INPUTS);
+          dbrs_input_id_.assign(num_dbrs * DBRS_NUM_INPUTS, -1);
+          dbrs_in_.Resize(num_dbrs * DBRS_NUM_INPUTS);
+          dbrs_out_.Resize(num_dbrs * DBRS_NUM_OUTPUTS);
+        }
+
+        int GetNumLevels() {
+          return num_levels_;
+        }
+
+        int GetNumSGRS(int target_level) {
+          return (target_level == 0)? 1 : 2;
+        }
+
+        int GetNumDBRS(int target_level) {
+          return (target_level < 1)? 0 : (1 << (target_level - 1)) - 1;
+        }
+
+        int GetTotalNumSGRS() {
+          return sgrs_level_offset_.back();
+        }
+
+        int GetTotalNumDBRS() {
+          return dbrs_level_offset_.back();
+        }
+
+        int SGRS_Index(int level, int pos) {
+          return sgrs_level_offset_[level] + pos;
+        }
+
+        int DBRS_Index(int level, int pos) {
+          return dbrs_level_offset_[level] + pos;
+        }
+
+    }; // End of class ReductionTree
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
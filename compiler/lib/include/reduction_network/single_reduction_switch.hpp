@@ -28,86 +28,84 @@ Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
 #define RN_SGLRS_H_
 
 #include <iostream>
-#include <memory>
 #include <vector>
-#include <list>
 #include "compile_packet.hpp"
 #include "switch_modes.hpp"
+#include "reduction_tree.hpp"
 
 //#define DEBUG
 
 
 namespace MAERI {
   namespace ReductionNetwork {
+    /*
+      Lightweight handle to one SGRS stored in a ReductionTree.
+      Handles do not own any state and can be created on the fly.
+    */
     class SingleReductionSwitch {
       protected:
-        bool genOutput_;
+        ReductionTree* tree_;
+        int idx_;
 
-        SGRS_Mode mode_ = SGRS_Mode::Idle;
-        int input_ID_L_ = -1;
-        int input_ID_R_ = -1;
-
-        int vn_nums;
-        int free_ports;
-        int vn;
+        int InSlot(int port) {
+          return idx_ * ReductionTree::SGRS_NUM_INPUTS + port;
+        }
 
-        std::vector<std::shared_ptr<CompilePacket>> input_packets_;
-        std::vector<std::shared_ptr<CompilePacket>> output_packets_;
+        int OutSlot(int port) {
+          return idx_ * ReductionTree::SGRS_NUM_OUTPUTS + port;
+        }
 
       public:
         int switch_id = 0;
 
-        SingleReductionSwitch() :
-          genOutput_(false),
-          mode_(SGRS_Mode::Idle),
-          input_ID_L_(-1),
-          input_ID_R_(-1),
-          vn_nums(0),
-          free_ports(2),
-          vn(-1)
+        SingleReductionSwitch(ReductionTree* tree, int level, int pos) :
+          tree_(tree),
+          idx_(tree->SGRS_Index(level, pos))
         {
-          for(int injCount = 0; injCount < 2; injCount++) {
-            auto invalid_packet = std::make_shared<CompilePacket>();
-            input_packets_.push_back(invalid_packet);
-          }
-
-          for(int injCount = 0; injCount < 1; injCount++) {
-            auto invalid_packet = std::make_shared<CompilePacket>();
-            output_packets_.push_back(invalid_packet);
-          }
+          switch_id = idx_;
         }
 
         void SetIDConnect(int ID, int pos) {
           if (pos == 0) {
-            input_ID_L_ = ID;
+            tree_->sgrs_input_id_[InSlot(0)] = ID;
           } else {
-            input_ID_R_ = ID;
+            tree_->sgrs_input_id_[InSlot(1)] = ID;
           }
         }
 
-        void PutPacket(std::shared_ptr<CompilePacket> inPacket, int port) {
+        void PutPacket(const CompilePacket& inPacket, int port) {
           if(port < 2) {
-            input_packets_[port] = inPacket;
-            free_ports -= 1;
-            int vn_id = inPacket->GetVNID();
-            if (vn_nums == 0) {
-              vn = vn_id;
-              vn_nums++;
+            auto& in = tree_->sgrs_in_;
+            int slot = InSlot(port);
+            in.vn_id_[slot] = inPacket.GetVNID();
+            in.vn_size_[slot] = inPacket.GetVNSize();
+            in.num_psums_[slot] = inPacket.GetNumPSums();
+            in.valid_[slot] = inPacket.IsValid();
+
+            tree_->sgrs_free_ports_[idx_] -= 1;
+            int vn_id = inPacket.GetVNID();
+            if (tree_->sgrs_vn_nums_[idx_] == 0) {
+              tree_->sgrs_vn_[idx_] = vn_id;
+              tree_->sgrs_vn_nums_[idx_]++;
             }
           }
         }
 
-        std::shared_ptr<CompilePacket> GetPacket(int port) {
+        CompilePacket GetPacket(int port) {
           if(port == 0) {
-            auto ret = output_packets_[port];
-            return ret;
+            auto& out = tree_->sgrs_out_;
+            int slot = OutSlot(port);
+            return CompilePacket(out.vn_id_[slot], out.vn_size_[slot], out.num_psums_[slot], out.valid_[slot]);
           }
           else {
-            return nullptr;
+            return CompilePacket();
           }
         }
 
         void ProcessPackets() {
+          auto& in = tree_->sgrs_in_;
+          int in_base = InSlot(0);
+
           int vn_L = -1;
           int vn_R = -1;
 
@@ -120,23 +118,23 @@ namespace MAERI {
           int vn_L_num_accumulated_psums = 0;
           int vn_R_num_accumulated_psums = 0;
 
-          if(input_packets_[0]->IsValid()) {
-            vn_L = input_packets_[0]->GetVNID();
-            vn_L_size = input_packets_[0]->GetVNSize();
+          if(in.valid_[in_base]) {
+            vn_L = in.vn_id_[in_base];
+            vn_L_size = in.vn_size_[in_base];
           }
 
-          if(input_packets_[1]->IsValid()) {
-            vn_R = input_packets_[1]->GetVNID();
-            vn_R_size = input_packets_[1]->GetVNSize();
+          if(in.valid_[in_base + 1]) {
+            vn_R = in.vn_id_[in_base + 1];
+            vn_R_size = in.vn_size_[in_base + 1];
           }
 
-          for(auto inPkt : input_packets_) {
-            if(inPkt->IsValid() && inPkt->GetVNID() == vn_L) {
-              vn_L_num_accumulated_psums += inPkt->GetNumPSums();
+          for(int slot = in_base; slot < in_base + ReductionTree::SGRS_NUM_INPUTS; slot++) {
+            if(in.valid_[slot] && in.vn_id_[slot] == vn_L) {
+              vn_L_num_accumulated_psums += in.num_psums_[slot];
               vn_L_num_packets++;
             }
-            else if(inPkt->IsValid() && inPkt->GetVNID() == vn_R) {
-              vn_R_num_accumulated_psums += inPkt->GetNumPSums();
+            else if(in.valid_[slot] && in.vn_id_[slot] == vn_R) {
+              vn_R_num_accumulated_psums += in.num_psums_[slot];
               vn_R_num_packets++;
             }
           }
@@ -144,69 +142,80 @@ namespace MAERI {
           std::cout << "SGRS " << switch_id << ", vn_L =  " << vn_L << ", vn_R = " << vn_R << ", NumLPackets = " << vn_L_num_packets << ", NumRPackets = " << vn_R_num_packets << ", accumulatedL = " << vn_L_num_accumulated_psums << ", accumulatedR = " << vn_R_num_accumulated_psums <<std::endl;
 #endif
 
+          SGRS_Mode& mode = tree_->sgrs_mode_[idx_];
+          uint8_t& genOutput = tree_->sgrs_gen_output_[idx_];
 
           if(vn_L != -1 && vn_R != -1 && vn_L == vn_R) {
-            mode_ = SGRS_Mode::AddTwo;
+            mode = SGRS_Mode::AddTwo;
             if(vn_L_size == vn_L_num_accumulated_psums) {
-              genOutput_ = true;
+              genOutput = true;
             }
             else {
 #ifdef DEBUG
               std::cout << "SGRS " << switch_id << " Sends out a packet with vnID: " << vn_L << ", vn_size: " << vn_L_size << ", pSums: " << vn_L_num_accumulated_psums << std::endl;
 #endif
-              output_packets_[0] = std::make_shared<CompilePacket>(vn_L, vn_L_size, vn_L_num_accumulated_psums);
+              SetOutput(0, vn_L, vn_L_size, vn_L_num_accumulated_psums);
             }
           }
           else if(vn_L == -1 && vn_R != -1) {
-            mode_ = SGRS_Mode::FlowRight;
+            mode = SGRS_Mode::FlowRight;
 #ifdef DEBUG
             std::cout << "SGRS " << switch_id << " Sends out a packet with vnID: " << vn_R << ", vn_size: " << vn_R_size << ", pSums: " << vn_R_num_accumulated_psums << std::endl;
 #endif
-            output_packets_[0] = std::make_shared<CompilePacket>(vn_R, vn_R_size, vn_R_num_accumulated_psums);
+            SetOutput(0, vn_R, vn_R_size, vn_R_num_accumulated_psums);
           }
           else if(vn_L != -1 && vn_R == -1) {
-            mode_ = SGRS_Mode::FlowLeft;
+            mode = SGRS_Mode::FlowLeft;
 #ifdef DEBUG
             std::cout << "SGRS " << switch_id << " Sends out a packet with vnID: " << vn_L << ", vn_size: " << vn_L_size << ", pSums: " << vn_L_num_accumulated_psums << std::endl;
 #endif
             if(vn_L_size == 1 && vn_L_size == vn_L_num_accumulated_psums) {
-              genOutput_ = true;
+              genOutput = true;
             } else {
-              output_packets_[0] = std::make_shared<CompilePacket>(vn_L, vn_L_size, vn_L_num_accumulated_psums);
+              SetOutput(0, vn_L, vn_L_size, vn_L_num_accumulated_psums);
             }
           }
           else {
-            mode_ = SGRS_Mode::Idle;
+            mode = SGRS_Mode::Idle;
           }
 
-          for(auto it : input_packets_) {
-            it->Invalidate();
+          for(int slot = in_base; slot < in_base + ReductionTree::SGRS_NUM_INPUTS; slot++) {
+            in.valid_[slot] = false;
           }
 
         } // End of void ProcessPackets()
 
+        void SetOutput(int port, int vn_id, int vn_size, int num_psums) {
+          auto& out = tree_->sgrs_out_;
+          int slot = OutSlot(port);
+          out.vn_id_[slot] = vn_id;
+          out.vn_size_[slot] = vn_size;
+          out.num_psums_[slot] = num_psums;
+          out.valid_[slot] = true;
+        }
+
         bool GetGenOutput() {
-          return genOutput_;
+          return tree_->sgrs_gen_output_[idx_];
         }
 
         SGRS_Mode GetMode() {
-          return mode_;
+          return tree_->sgrs_mode_[idx_];
         }
 
         int GetInput_ID_L() {
-          return input_ID_L_;
+          return tree_->sgrs_input_id_[InSlot(0)];
         }
 
         int GetInput_ID_R() {
-          return input_ID_R_;
+          return tree_->sgrs_input_id_[InSlot(1)];
         }
 
         int GetVN_Nums() {
-          return vn_nums;
+          return tree_->sgrs_vn_nums_[idx_];
         }
 
         bool CheckIfSameID(int vn_id) {
-          return vn == vn_id;
+          return tree_->sgrs_vn_[idx_] == vn_id;
         }
 
     };
@@ -27,6 +27,7 @@ Author: Hyoukjun Kwon (hyoukjun@gatech.edu), Yangyu Chen (yangyuchen@gatech.edu)
 #define RN_SWITCH_CONFIG_H_
 
 #include <string>
+#include <vector>
 
 #include "switch_modes.hpp"
 
@@ -165,6 +166,38 @@ namespace MAERI {
            return ret;
         }
     };
+
+    // Configuration of one in-order adder switch: an SGRS or one half of a DBRS
+    class AdderSwitchConfig {
+      public:
+        SwitchType type_ = SwitchType::None;
+        bool genOutput_ = false;
+        SGRS_Mode sgrs_mode_ = SGRS_Mode::Idle;
+        DBRS_SubMode dbrs_mode_ = DBRS_SubMode::Idle;
+
+        bool operator==(const AdderSwitchConfig& other) const {
+          return type_ == other.type_ && genOutput_ == other.genOutput_
+              && sgrs_mode_ == other.sgrs_mode_ && dbrs_mode_ == other.dbrs_mode_;
+        }
+
+        bool operator!=(const AdderSwitchConfig& other) const {
+          return !(*this == other);
+        }
+    };
+
+    /*
+      Compiled reduction network configuration in RN_Config.vmh order.
+      Entries of type None keep their slot in the 8-switch word but emit no bits.
+    */
+    class RNConfig {
+      public:
+        std::vector<AdderSwitchConfig> switches_;
+        std::vector<int> output_buff_valid_;   // In-order IDs of switches that generate outputs
+
+        bool operator==(const RNConfig& other) const {
+          return switches_ == other.switches_ && output_buff_valid_ == other.output_buff_valid_;
+        }
+    };
   };
 };
 
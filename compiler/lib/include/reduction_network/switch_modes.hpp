@@ -30,6 +30,7 @@ namespace MAERI {
 
     enum class DBRS_SubMode {Idle, AddOne, AddTwo, AddThree};
     enum class SGRS_Mode {Idle, AddTwo, FlowLeft, FlowRight};
+    enum class SwitchType {None, SGRS, DBRS};
 
   };
 };
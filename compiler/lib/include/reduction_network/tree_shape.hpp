@@ -0,0 +1,127 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef RN_TREE_SHAPE_H_
+#define RN_TREE_SHAPE_H_
+
+#include <vector>
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    /*
+      Shape of the augmented reduction tree of an array of any size.
+      An array of N multiplier switches uses the tree of P leaves, P being the
+      next power of two, truncated to its leftmost N leaves: leaves N..P-1 do
+      not exist, and neither does any adder switch all of whose leaves are
+      missing. The remaining adder switches are numbered in order, which is
+      the ID outputBuffValid reports; for a power of two this is the usual
+      in-order ID.
+    */
+    class TreeShape {
+      protected:
+        int num_mult_switches_;
+        int num_leaves_;
+        int num_levels_;
+        int num_adder_switches_;
+        std::vector<int> compact_id_;   // Per full-tree in-order ID; -1 if the switch does not exist
+
+      public:
+        static int NextPowerOfTwo(int n) {
+          int ret = 1;
+          while(ret < n) {
+            ret <<= 1;
+          }
+          return ret;
+        }
+
+        TreeShape(int numMultSwitches) :
+          num_mult_switches_(numMultSwitches),
+          num_leaves_(NextPowerOfTwo(numMultSwitches)),
+          num_levels_(0),
+          num_adder_switches_(0) {
+
+          while((1 << num_levels_) < num_leaves_) {
+            num_levels_++;
+          }
+
+          compact_id_.assign(num_leaves_ - 1, -1);
+          for(int id = 0; id < num_leaves_ - 1; id++) {
+            if(ExistsInorder(id)) {
+              compact_id_[id] = num_adder_switches_++;
+            }
+          }
+        }
+
+        int GetNumMultSwitches() const {
+          return num_mult_switches_;
+        }
+
+        // Leaves of the full tree, including missing ones
+        int GetNumLeaves() const {
+          return num_leaves_;
+        }
+
+        int GetNumLevels() const {
+          return num_levels_;
+        }
+
+        // Adder switches that exist
+        int GetNumAdderSwitches() const {
+          return num_adder_switches_;
+        }
+
+        bool IsTruncated() const {
+          return num_leaves_ != num_mult_switches_;
+        }
+
+        int InorderID(int level, int column) const {
+          int stride = 1 << (num_levels_ - 1 - level);
+          return stride - 1 + 2 * column * stride;
+        }
+
+        bool Exists(int level, int column) const {
+          return column * (1 << (num_levels_ - level)) < num_mult_switches_;
+        }
+
+        bool ExistsInorder(int inorder_id) const {
+          if(inorder_id < 0 || inorder_id >= num_leaves_ - 1) {
+            return false;
+          }
+          int stride = (inorder_id + 1) & -(inorder_id + 1);
+          return inorder_id + 1 - stride < num_mult_switches_;
+        }
+
+        int GetCompactID(int inorder_id) const {
+          return compact_id_[inorder_id];
+        }
+
+    }; // End of class TreeShape
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
@@ -0,0 +1,390 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu), Yangyu Chen (yangyuchen@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef RN_VN_PLACEMENT_H_
+#define RN_VN_PLACEMENT_H_
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tree_shape.hpp"
+
+//#define DEBUG
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    /*
+      Result of mapping a VN layout onto the multiplier switches (leaves).
+      Each leaf injects one packet with psum count 1 of the assigned VN.
+    */
+    class LeafAssignment {
+      public:
+        std::vector<int> vn_id_;    // -1: the leaf does not inject a packet
+        std::vector<int> vn_size_;
+
+        // First leaf from which the remaining leaves are registered as idle; -1 if none
+        int idle_start_ = -1;
+        bool valid_ = true;
+
+        LeafAssignment(int num_mult_switches) :
+          vn_id_(num_mult_switches, -1),
+          vn_size_(num_mult_switches, -1) {
+        }
+
+        void Assign(int leaf, int vn_id, int vn_size) {
+          vn_id_[leaf] = vn_id;
+          vn_size_[leaf] = vn_size;
+        }
+
+        bool IsAssigned(int leaf) const {
+          return vn_id_[leaf] != -1;
+        }
+
+        int GetNumLeaves() const {
+          return static_cast<int>(vn_id_.size());
+        }
+    }; // End of class LeafAssignment
+
+    /*
+      Placement rules of the lowest reduction network level.
+      The leftmost and rightmost leaf pairs feed the edge SGRSes; leaves
+      2 + 4 * d .. 5 + 4 * d feed ports 0..3 of DBRS d. Leaves follow the full
+      tree (see TreeShape), and leaves past the last multiplier switch are
+      never assigned.
+    */
+    class VNPlacement {
+      public:
+        static std::vector<int> ReadVNSizes(std::string filename) {
+          std::vector<int> vn_sizes;
+          std::ifstream readVNSizes(filename);
+          int size;
+
+          while (readVNSizes >> size) {
+            vn_sizes.push_back(size);
+          }
+          return vn_sizes;
+        }
+
+        static LeafAssignment PlaceUniform(int num_mult_switches, int vn_size, int vn_num) {
+          LeafAssignment ret(TreeShape::NextPowerOfTwo(num_mult_switches));
+          for(int leaf = 0; leaf < num_mult_switches; leaf++) {
+            int vn_id = leaf / vn_size;
+            if(vn_id < vn_num) {
+              ret.Assign(leaf, vn_id, vn_size);
+            } else {
+              ret.idle_start_ = leaf;
+              break;
+            }
+          }
+          return ret;
+        }
+
+        // Special case for vn_size = 1 (ps: vn_num cannot exceed num_multiplier / 2)
+        static LeafAssignment PlaceSingleVN(int num_mult_switches, int vn_num) {
+          int num_leaves = TreeShape::NextPowerOfTwo(num_mult_switches);
+          LeafAssignment ret(num_leaves);
+          int max_vn_num = num_mult_switches / 2;
+          if (vn_num > max_vn_num) {
+            std::cerr << "ERROR: Number of VNs exceeds the maximum number(num_multiplier / 2) allowed for VN SIZE 1" << std::endl;
+            ret.valid_ = false;
+            return ret;
+          }
+
+          for (int vn_id = 0; vn_id < vn_num; vn_id++) {
+            if (vn_id == 0) {
+              ret.Assign(0, vn_id, 1);
+            } else if (vn_id == num_leaves / 2 - 1) {
+              ret.Assign(num_leaves - 2, vn_id, 1);
+            } else {
+              int dbrs_id = (vn_id - 1) / 2;
+              int port_id = ((vn_id - 1) % 2 == 0) ? 0 : 3;
+              ret.Assign(2 + 4 * dbrs_id + port_id, vn_id, 1);
+            }
+          }
+          if (vn_num < max_vn_num) {
+            ret.idle_start_ = vn_num * 2;
+          }
+          return ret;
+        }
+
+        /*
+          VNs are placed left to right in list order. A VN of size 1 occupies a
+          whole edge SGRS, and the second VN entering a DBRS is filled from the
+          right so that the DBRS can reduce both of them.
+        */
+        static LeafAssignment PlaceNonUniform(int num_mult_switches, std::vector<int> vn_sizes) {
+          int num_leaves = TreeShape::NextPowerOfTwo(num_mult_switches);
+          LeafAssignment ret(num_leaves);
+
+          int count = 0;
+          for (auto size : vn_sizes) {
+            count += size;
+          }
+          // A full power-of-two array would need a VN to enter the already claimed right edge SGRS
+          if (count > num_mult_switches || (count == num_mult_switches && num_leaves == num_mult_switches)) {
+            std::cerr << "ERROR: Non-Uniform VN Sizes total exceeds the number of multiplier switches." << std::endl;
+            ret.valid_ = false;
+            return ret;
+          }
+
+          // Occupancy of the edge SGRSes and the lowest-level DBRSes
+          int sgrs_vn[2] = {-1, -1};
+          int num_dbrs = num_leaves / 4 - 1;
+          std::vector<int> dbrs_vn_nums(num_dbrs, 0);
+          std::vector<int> dbrs_free_ports(num_dbrs, 4);
+          std::vector<int> dbrs_vns(num_dbrs * 2, -1);
+
+          auto put_dbrs = [&](int dbrs_id, int port_id, int vn_id, int vn_size) {
+            ret.Assign(2 + 4 * dbrs_id + port_id, vn_id, vn_size);
+            dbrs_free_ports[dbrs_id]--;
+            if (dbrs_vn_nums[dbrs_id] == 0) {
+              dbrs_vns[dbrs_id * 2] = vn_id;
+              dbrs_vn_nums[dbrs_id]++;
+            } else if (dbrs_vn_nums[dbrs_id] == 1 && vn_id != dbrs_vns[dbrs_id * 2]) {
+              dbrs_vns[dbrs_id * 2 + 1] = vn_id;
+              dbrs_vn_nums[dbrs_id]++;
+            }
+          };
+
+          auto dbrs_has_vn = [&](int dbrs_id, int vn_id) {
+            return dbrs_vns[dbrs_id * 2] == vn_id || dbrs_vns[dbrs_id * 2 + 1] == vn_id;
+          };
+
+          int index = 0;
+          for (int vn_id = 0; vn_id < static_cast<int>(vn_sizes.size()); vn_id++) {
+            int vn_size = vn_sizes[vn_id];
+
+            int index_inc = vn_size;
+            for (int i = index; i < index + vn_size; i++) {
+#ifdef DEBUG
+              std::cout<< "VN Size: " << vn_size << ", VN ID: " << vn_id << std::endl;
+#endif
+              if (i < 2 || i > num_leaves - 3) {
+                int sgrs = (i < 2)? 0 : 1;
+                int leaf = (sgrs == 0)? i % 2 : num_leaves - 2 + i % 2;
+                if (sgrs_vn[sgrs] == -1) {
+                  ret.Assign(leaf, vn_id, vn_size);
+                  sgrs_vn[sgrs] = vn_id;
+                  if (vn_size < 2) {
+                    index_inc++;
+                  }
+                } else if (sgrs_vn[sgrs] == vn_id) {
+                  ret.Assign(leaf, vn_id, vn_size);
+                } else {
+                  std::cerr << "ERROR: One Single Switch inputs 2 kind of VNs" << std::endl;
+                  ret.valid_ = false;
+                  return ret;
+                }
+              } else {
+                int dbrs_id = (i - 2)/4;
+                int port_id = (i - 2) % 4;
+#ifdef DEBUG
+                std::cout << "dbrs_id: " << dbrs_id << ", port_id: " << port_id << std::endl;
+#endif
+                int vn_num_exist = dbrs_vn_nums[dbrs_id];
+                if (vn_num_exist == 0) {
+                  put_dbrs(dbrs_id, port_id, vn_id, vn_size);
+                } else if (vn_num_exist == 1) {
+                  int free_ports = dbrs_free_ports[dbrs_id];
+                  if (dbrs_has_vn(dbrs_id, vn_id)) {
+                    put_dbrs(dbrs_id, port_id, vn_id, vn_size);
+                  } else if (vn_size >= free_ports) { // this kind of vn first time entry, so the whole vn size have not being filled
+                    put_dbrs(dbrs_id, port_id, vn_id, vn_size);
+                  } else {
+                    // Fill double switch with the second VN kind from right to left. This is to utilize the property of double switch.
+                    for (int j = 0; j < vn_size; j++) {
+                      put_dbrs(dbrs_id, port_id + free_ports - 1 - j, vn_id, vn_size);
+                    }
+                    index_inc += (free_ports - vn_size);
+                    break;
+                  }
+                } else {
+                  if (dbrs_has_vn(dbrs_id, vn_id)) {
+                    put_dbrs(dbrs_id, port_id, vn_id, vn_size);
+                  } else {
+                    std::cerr << "ERROR: One Single Switch inputs 2 kind of VNs" << std::endl;
+                    ret.valid_ = false;
+                    return ret;
+                  }
+                }
+              }
+            }
+            index += index_inc;
+#ifdef DEBUG
+            std::cout << "Index add up: " << index_inc  << ", Index now: " << index << std::endl;
+#endif
+          }
+
+          int last_leaf = num_leaves - 1;
+          while (last_leaf >= 0 && !ret.IsAssigned(last_leaf)) {
+            last_leaf--;
+          }
+          if (index > num_leaves || last_leaf >= num_mult_switches) {
+            std::cerr << "ERROR: Non-Uniform VN Sizes total exceeds the number of multiplier switches.";
+            ret.valid_ = false;
+            return ret;
+          }
+
+          ret.idle_start_ = index;
+          ret.valid_ = CheckReducible(ret);
+          return ret;
+        }
+
+        /*
+          Follows the partial sums of every VN up the adder switches. An SGRS
+          adds its two inputs; a DBRS half adds its outer input and the
+          adjacent inner one, and takes the other half's inner input as well
+          (AddThree) only if that input belongs to none of the other half's
+          VN. A VN whose partial sums meet another VN's in an SGRS, sit on an
+          inner DBRS port that neither half can add, or reach the root before
+          adding up to the whole VN cannot be reduced to one output on this
+          network, whatever the switch modes; the first such VN is reported.
+        */
+        static bool CheckReducible(const LeafAssignment& leaves, bool report = true) {
+          int num_leaves = leaves.GetNumLeaves();
+          int num_levels = 0;
+          while((1 << num_levels) < num_leaves) {
+            num_levels++;
+          }
+
+          std::vector<int> in_vn(leaves.vn_id_), in_size(leaves.vn_size_), in_psums(num_leaves, 1);
+          std::vector<int> out_vn, out_size, out_psums;
+
+          auto fail = [&](int vn_id, int level, int column, const std::string& reason) {
+            if(report) {
+              std::cerr << "ERROR: VN " << vn_id << " cannot be reduced to one output: " << reason << " (switch at level " << level
+                        << ", column " << column << ")" << std::endl;
+            }
+            return false;
+          };
+
+          for(int level = num_levels - 1; level >= 0; level--) {
+            int num_columns = 1 << level;
+            out_vn.assign(num_columns, -1);
+            out_size.assign(num_columns, -1);
+            out_psums.assign(num_columns, 0);
+
+            // Adds the given inputs of the level below into one column; a complete VN leaves the column empty
+            auto reduce = [&](int column, std::initializer_list<int> inputs) {
+              for(auto input : inputs) {
+                out_vn[column] = in_vn[input];
+                out_size[column] = in_size[input];
+                out_psums[column] += in_psums[input];
+              }
+              if(out_vn[column] != -1 && out_psums[column] == out_size[column]) {
+                out_vn[column] = -1;
+              }
+            };
+
+            for(int column = 0; column < num_columns; column++) {
+              int first = 2 * column;
+              if(column == 0 || column == num_columns - 1) {
+                int vn_L = in_vn[first], vn_R = in_vn[first + 1];
+                if(vn_L != -1 && vn_R != -1 && vn_L != vn_R) {
+                  return fail(vn_R, level, column, "an SGRS also receives partial sums of VN " + std::to_string(vn_L));
+                }
+                if(vn_L != -1 && vn_R != -1) {
+                  reduce(column, {first, first + 1});
+                }
+                else if(vn_L != -1 || vn_R != -1) {
+                  reduce(column, {(vn_L != -1)? first : first + 1});
+                }
+                continue;
+              }
+              if(column % 2 == 0) {
+                continue;
+              }
+
+              // DBRS columns (column, column + 1) with ports LL, LR, RL, RR
+              int ll = in_vn[first], lr = in_vn[first + 1], rl = in_vn[first + 2], rr = in_vn[first + 3];
+              bool lr_to_L = (lr != -1 && lr == ll);
+              bool lr_to_R = (lr != -1 && !lr_to_L && lr == rl && lr == rr);
+              bool rl_to_R = (rl != -1 && rl == rr);
+              bool rl_to_L = (rl != -1 && !rl_to_R && rl == lr && rl == ll);
+              if(lr != -1 && !lr_to_L && !lr_to_R) {
+                return fail(lr, level, column, "a DBRS receives one of its partial sums on the inner port LR");
+              }
+              if(rl != -1 && !rl_to_L && !rl_to_R) {
+                return fail(rl, level, column + 1, "a DBRS receives one of its partial sums on the inner port RL");
+              }
+
+              if(ll != -1) {
+                if(rl_to_L) {
+                  reduce(column, {first, first + 1, first + 2});
+                }
+                else if(lr_to_L) {
+                  reduce(column, {first, first + 1});
+                }
+                else {
+                  reduce(column, {first});
+                }
+              }
+              if(rr != -1) {
+                if(lr_to_R) {
+                  reduce(column + 1, {first + 1, first + 2, first + 3});
+                }
+                else if(rl_to_R) {
+                  reduce(column + 1, {first + 2, first + 3});
+                }
+                else {
+                  reduce(column + 1, {first + 3});
+                }
+              }
+            }
+
+            in_vn.swap(out_vn);
+            in_size.swap(out_size);
+            in_psums.swap(out_psums);
+          }
+
+          if(in_vn[0] != -1) {
+            return fail(in_vn[0], 0, 0, "its partial sums reach the root without adding up to the whole VN");
+          }
+          return true;
+        }
+
+        static LeafAssignment Place(int num_mult_switches, int vn_size, int vn_num, bool non_uniform, std::string vn_sizes_file = "non_uniform_VN_sizes.txt") {
+          if (non_uniform) {
+            return PlaceNonUniform(num_mult_switches, ReadVNSizes(vn_sizes_file));
+          }
+          // special case handle: vn_size = 1 (ps: vn_num cannot exceed num_multiplier / 2)
+          auto ret = (vn_size == 1)? PlaceSingleVN(num_mult_switches, vn_num) : PlaceUniform(num_mult_switches, vn_size, vn_num);
+          if (ret.valid_ && !CheckReducible(ret)) {
+            std::cerr << "ERROR: " << vn_num << " VNs of size " << vn_size << " cannot be reduced on " << num_mult_switches << " multiplier switches" << std::endl;
+            ret.valid_ = false;
+          }
+          return ret;
+        }
+
+    }; // End of class VNPlacement
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
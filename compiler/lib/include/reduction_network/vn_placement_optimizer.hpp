@@ -0,0 +1,369 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef RN_VN_PLACEMENT_OPTIMIZER_H_
+#define RN_VN_PLACEMENT_OPTIMIZER_H_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+
+#include "vn_placement.hpp"
+
+namespace MAERI {
+  namespace ReductionNetwork {
+
+    class PlacementPlan {
+      public:
+        std::vector<int> order_;      // Original indices of the placed VNs, in placement order
+        std::vector<int> vn_sizes_;   // Sizes in placement order (non_uniform_VN_sizes.txt contents)
+        std::vector<int> dropped_;    // Original indices of the VNs that do not fit
+        int num_active_ = 0;          // Multiplier switches that receive a VN
+        bool exact_ = true;           // False if the search space was too large and a beam search was used
+    }; // End of class PlacementPlan
+
+    /*
+      Chooses the order (and, if they cannot all fit, the subset) of a
+      multiset of VN sizes that maximizes the number of active multiplier
+      switches under VNPlacement::PlaceNonUniform.
+      Placement is left to right, and the only state carried from one VN to
+      the next is the first free leaf: a boundary inside a lowest-level DBRS
+      always leaves exactly one VN in it. A VN smaller than the free ports of
+      such a DBRS is filled from the right and the ports in between stay idle;
+      a VN may not start on the last leaf, whose SGRS already holds another VN;
+      the sizes must total less than the number of multiplier switches, or at
+      most that many on a truncated tree, which has no right edge SGRS to share.
+      Every placed VN must also pass VNPlacement::CheckReducible, which only
+      depends on the leaves of that VN, so it is checked per transition.
+    */
+    class VNPlacementOptimizer {
+      protected:
+        const long MAX_EXACT_STATES = 1 << 16;
+        const int BEAM_WIDTH = 64;
+
+        int num_mult_switches_;
+        int num_leaves_;
+
+        // Keyed by index * (num_leaves_ + 1) + VN size: whether the VN NextIndex places there is reducible.
+        // Only the transitions the search visits are stored; a dense table would grow with the square of the leaves
+        std::unordered_map<long, bool> reducible_;
+
+        std::vector<int> distinct_sizes_;
+        std::vector<int> counts_;
+
+        class SearchEntry {
+          public:
+            int value_;    // Most additional active leaves
+            int choice_;   // Index into distinct_sizes_ of the next VN, -1 to stop
+        }; // End of class SearchEntry
+
+        std::unordered_map<std::string, SearchEntry> memo_;
+        bool search_aborted_;
+
+        std::string StateKey(int index, bool wasted) {
+          std::string key(reinterpret_cast<const char*>(counts_.data()), counts_.size() * sizeof(int));
+          key.append(reinterpret_cast<const char*>(&index), sizeof(int));
+          key.push_back(wasted? 1 : 0);
+          return key;
+        }
+
+        // Sizes total less than the number of multiplier switches unless some leaf was skipped
+        bool FitsTotal(int next_index, bool wasted) {
+          return wasted || next_index < num_mult_switches_ || TreeShape::NextPowerOfTwo(num_mult_switches_) != num_mult_switches_;
+        }
+
+        // NextIndex, or -1 if the VN placed at index cannot be reduced
+        int Advance(int index, int vn_size) {
+          int next_index = NextIndex(num_mult_switches_, index, vn_size);
+          if(next_index == -1) {
+            return -1;
+          }
+
+          long key = static_cast<long>(index) * (num_leaves_ + 1) + vn_size;
+          auto it = reducible_.find(key);
+          if(it == reducible_.end()) {
+            // A single-leaf VN on an edge SGRS skips the second leaf; one filled from the right ends at next_index
+            bool edge_single = (vn_size == 1 && (index == 0 || index == num_leaves_ - 2));
+            int first_leaf = edge_single? index : next_index - vn_size;
+            LeafAssignment leaves(num_leaves_);
+            for(int leaf = first_leaf; leaf < first_leaf + vn_size; leaf++) {
+              leaves.Assign(leaf, 0, vn_size);
+            }
+            it = reducible_.emplace(key, VNPlacement::CheckReducible(leaves, false)).first;
+          }
+          return it->second? next_index : -1;
+        }
+
+        int Search(int index, bool wasted) {
+          if(search_aborted_) {
+            return 0;
+          }
+
+          std::string key = StateKey(index, wasted);
+          auto it = memo_.find(key);
+          if(it != memo_.end()) {
+            return it->second.value_;
+          }
+          if(static_cast<long>(memo_.size()) >= MAX_EXACT_STATES) {
+            search_aborted_ = true;
+            return 0;
+          }
+
+          SearchEntry best = {0, -1};
+          for(int d = 0; d < static_cast<int>(distinct_sizes_.size()); d++) {
+            int size = distinct_sizes_[d];
+            if(counts_[d] == 0) {
+              continue;
+            }
+            int next_index = Advance(index, size);
+            bool next_wasted = wasted || (next_index - index != size);
+            if(next_index == -1 || !FitsTotal(next_index, next_wasted)) {
+              continue;
+            }
+
+            counts_[d]--;
+            int value = size + Search(next_index, next_wasted);
+            counts_[d]++;
+
+            if(value > best.value_) {
+              best.value_ = value;
+              best.choice_ = d;
+            }
+          }
+
+          memo_[key] = best;
+          return best.value_;
+        }
+
+        std::vector<int> ExactSearch() {
+          memo_.clear();
+          search_aborted_ = false;
+          Search(0, false);
+
+          std::vector<int> sequence;
+          if(search_aborted_) {
+            return sequence;
+          }
+
+          int index = 0;
+          bool wasted = false;
+          while(true) {
+            auto& entry = memo_[StateKey(index, wasted)];
+            if(entry.choice_ == -1) {
+              break;
+            }
+            int size = distinct_sizes_[entry.choice_];
+            int next_index = Advance(index, size);
+            wasted = wasted || (next_index - index != size);
+            index = next_index;
+            counts_[entry.choice_]--;
+            sequence.push_back(entry.choice_);
+          }
+          for(auto d : sequence) {
+            counts_[d]++;
+          }
+          memo_.clear();
+          return sequence;
+        }
+
+        class BeamState {
+          public:
+            int index_;
+            bool wasted_;
+            int active_;
+            int node_;                  // Last placed VN in nodes, -1 if none
+            std::vector<int> counts_;
+        }; // End of class BeamState
+
+        // Keeps, at every step, the partial layouts that waste the fewest leaves
+        std::vector<int> BeamSearch() {
+          std::vector<std::pair<int, int>> nodes;   // (parent node, index into distinct_sizes_)
+
+          BeamState initial = {0, false, 0, -1, counts_};
+          int best_active = 0;
+          int best_node = -1;
+          std::vector<BeamState> beam = {initial};
+
+          while(!beam.empty()) {
+            std::vector<BeamState> next_beam;
+            std::unordered_map<std::string, int> seen;
+            for(auto& state : beam) {
+              for(int d = 0; d < static_cast<int>(distinct_sizes_.size()); d++) {
+                int size = distinct_sizes_[d];
+                if(state.counts_[d] == 0) {
+                  continue;
+                }
+                int next_index = Advance(state.index_, size);
+                bool next_wasted = state.wasted_ || (next_index - state.index_ != size);
+                if(next_index == -1 || !FitsTotal(next_index, next_wasted)) {
+                  continue;
+                }
+
+                BeamState next = state;
+                next.index_ = next_index;
+                next.wasted_ = next_wasted;
+                next.active_ += size;
+                next.counts_[d]--;
+
+                std::string key(reinterpret_cast<const char*>(next.counts_.data()), next.counts_.size() * sizeof(int));
+                key.append(reinterpret_cast<const char*>(&next_index), sizeof(int));
+                if(!seen.emplace(key, 0).second) {
+                  continue;
+                }
+
+                next.node_ = static_cast<int>(nodes.size());
+                nodes.push_back(std::make_pair(state.node_, d));
+                if(next.active_ > best_active) {
+                  best_active = next.active_;
+                  best_node = next.node_;
+                }
+                next_beam.push_back(std::move(next));
+              }
+            }
+
+            std::stable_sort(next_beam.begin(), next_beam.end(), [](const BeamState& a, const BeamState& b) {
+              return a.index_ - a.active_ < b.index_ - b.active_;
+            });
+            if(static_cast<int>(next_beam.size()) > BEAM_WIDTH) {
+              next_beam.resize(BEAM_WIDTH);
+            }
+            beam.swap(next_beam);
+          }
+
+          std::vector<int> sequence;
+          for(int node = best_node; node != -1; node = nodes[node].first) {
+            sequence.push_back(nodes[node].second);
+          }
+          std::reverse(sequence.begin(), sequence.end());
+          return sequence;
+        }
+
+      public:
+        VNPlacementOptimizer(int numMultSwitches) :
+          num_mult_switches_(numMultSwitches),
+          num_leaves_(TreeShape::NextPowerOfTwo(numMultSwitches)),
+          search_aborted_(false) {
+        }
+
+        // First free leaf after placing a VN of vn_size at index, or -1 if PlaceNonUniform would reject it
+        static int NextIndex(int num_mult_switches, int index, int vn_size) {
+          int num_leaves = TreeShape::NextPowerOfTwo(num_mult_switches);
+          if(vn_size < 1 || index >= num_leaves - 1 || index >= num_mult_switches) {
+            return -1;
+          }
+
+          int next_index = index + vn_size;
+          int last_leaf = -1;
+          if(index == 0 || index == num_leaves - 2) {
+            // A single-leaf VN takes a whole edge SGRS
+            if(vn_size == 1) {
+              next_index = index + 2;
+              last_leaf = index;
+            }
+          }
+          else {
+            int port_id = (index - 2) % 4;
+            int free_ports = 4 - port_id;
+            if(port_id != 0 && vn_size < free_ports) {
+              next_index = index + free_ports;
+            }
+          }
+
+          if(last_leaf == -1) {
+            last_leaf = next_index - 1;
+          }
+          return (next_index > num_leaves || last_leaf >= num_mult_switches)? -1 : next_index;
+        }
+
+        PlacementPlan Optimize(const std::vector<int>& vn_sizes) {
+          PlacementPlan plan;
+
+          distinct_sizes_.clear();
+          counts_.clear();
+          for(auto size : vn_sizes) {
+            auto it = std::find(distinct_sizes_.begin(), distinct_sizes_.end(), size);
+            if(it == distinct_sizes_.end()) {
+              distinct_sizes_.push_back(size);
+              counts_.push_back(1);
+            } else {
+              counts_[it - distinct_sizes_.begin()]++;
+            }
+          }
+
+          std::vector<int> sequence = ExactSearch();
+          if(search_aborted_) {
+            plan.exact_ = false;
+            sequence = BeamSearch();
+          }
+
+          // Hand out the original indices of each size in input order
+          std::vector<bool> used(vn_sizes.size(), false);
+          for(auto d : sequence) {
+            int size = distinct_sizes_[d];
+            for(int vn_id = 0; vn_id < static_cast<int>(vn_sizes.size()); vn_id++) {
+              if(!used[vn_id] && vn_sizes[vn_id] == size) {
+                used[vn_id] = true;
+                plan.order_.push_back(vn_id);
+                plan.vn_sizes_.push_back(size);
+                plan.num_active_ += size;
+                break;
+              }
+            }
+          }
+          for(int vn_id = 0; vn_id < static_cast<int>(vn_sizes.size()); vn_id++) {
+            if(!used[vn_id]) {
+              plan.dropped_.push_back(vn_id);
+            }
+          }
+
+          return plan;
+        }
+
+        // Active leaves of the given order, or 0 if PlaceNonUniform rejects it
+        int GetNumActive(const std::vector<int>& vn_sizes) {
+          int index = 0;
+          int num_active = 0;
+          bool wasted = false;
+          for(auto size : vn_sizes) {
+            int next_index = Advance(index, size);
+            if(next_index == -1) {
+              return 0;
+            }
+            wasted = wasted || (next_index - index != size);
+            index = next_index;
+            num_active += size;
+          }
+          return FitsTotal(index, wasted)? num_active : 0;
+        }
+
+    }; // End of class VNPlacementOptimizer
+
+  }; // End of namespace ReductionNetwork
+}; // End of namespace MAERI
+
+#endif
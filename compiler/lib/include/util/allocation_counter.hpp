@@ -0,0 +1,85 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#ifndef UTIL_ALLOCATION_COUNTER_H_
+#define UTIL_ALLOCATION_COUNTER_H_
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace MAERI {
+  namespace Util {
+
+    /*
+      Counts calls to the global operator new.
+      The counting hooks are only installed in the translation unit that
+      defines MAERI_INSTALL_ALLOCATION_COUNTER before including this file;
+      without them the count stays at zero.
+    */
+    class AllocationCounter {
+      public:
+        static std::atomic<long>& Counter() {
+          static std::atomic<long> num_allocations(0);
+          return num_allocations;
+        }
+
+        static void Increment() {
+          Counter().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static long GetCount() {
+          return Counter().load(std::memory_order_relaxed);
+        }
+    }; // End of class AllocationCounter
+
+  }; // End of namespace Util
+}; // End of namespace MAERI
+
+#ifdef MAERI_INSTALL_ALLOCATION_COUNTER
+// Not inlined, so that GCC does not pair malloc() and free() with new and delete expressions (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define MAERI_ALLOCATION_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#define MAERI_ALLOCATION_COUNTER_NOINLINE
+#endif
+
+MAERI_ALLOCATION_COUNTER_NOINLINE void* operator new(std::size_t size) {
+  MAERI::Util::AllocationCounter::Increment();
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if(ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+MAERI_ALLOCATION_COUNTER_NOINLINE void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+MAERI_ALLOCATION_COUNTER_NOINLINE void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+#endif
+
+#endif
@@ -0,0 +1,185 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+
+#ifndef UTIL_TENSOR_FILE_H_
+#define UTIL_TENSOR_FILE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+#include "layer_file_parser.hpp"
+
+namespace MAERI {
+  namespace Util {
+
+    /*
+      A memory-mapped INT16 tensor: a .npy file ('<i2', C order, NPY
+      format 1.0 to 3.0) or, for any other extension, raw little-endian
+      int16 values. Elements are read straight from the mapping, so
+      tensors larger than memory are paged in as they are used.
+    */
+    class TensorFile {
+      protected:
+        std::string filename_;
+        std::unique_ptr<maestro::MappedFile> file_;
+        const char* data_ = nullptr;
+        size_t num_elements_ = 0;
+        std::vector<size_t> shape_;
+
+        bool Fail(const std::string& message) {
+          std::cerr << "ERROR: " << filename_ << ": " << message << std::endl;
+          return false;
+        }
+
+        // Value of 'key': ... in the NPY header dictionary, up to the next top-level comma or brace
+        static std::string_view GetHeaderField(std::string_view header, std::string_view key) {
+          auto pos = header.find("'" + std::string(key) + "'");
+          if(pos == std::string_view::npos) {
+            return std::string_view();
+          }
+          pos = header.find(':', pos);
+          if(pos == std::string_view::npos) {
+            return std::string_view();
+          }
+          auto begin = header.find_first_not_of(" ", pos + 1);
+          auto end = (header[begin] == '(')? header.find(')', begin) + 1 : header.find_first_of(",}", begin);
+          return header.substr(begin, end - begin);
+        }
+
+        bool ParseNpyHeader(std::string_view contents, size_t& data_offset) {
+          if(contents.size() < 10 || contents.substr(0, 6) != std::string_view("\x93NUMPY", 6)) {
+            return Fail("not an NPY file");
+          }
+          int major_version = static_cast<unsigned char>(contents[6]);
+          size_t header_len_size = (major_version == 1)? 2 : 4;
+          if(major_version < 1 || major_version > 3 || contents.size() < 8 + header_len_size) {
+            return Fail("unsupported NPY version " + std::to_string(major_version));
+          }
+          size_t header_len = 0;
+          for(size_t byte = 0; byte < header_len_size; byte++) {
+            header_len |= static_cast<size_t>(static_cast<unsigned char>(contents[8 + byte])) << (8 * byte);
+          }
+          data_offset = 8 + header_len_size + header_len;
+          if(contents.size() < data_offset) {
+            return Fail("truncated NPY header");
+          }
+
+          auto header = contents.substr(8 + header_len_size, header_len);
+          auto descr = GetHeaderField(header, "descr");
+          if(descr != "'<i2'" && descr != "'|i2'") {
+            return Fail("expected dtype int16 ('<i2'), got " + std::string(descr));
+          }
+          if(GetHeaderField(header, "fortran_order") != "False") {
+            return Fail("Fortran-ordered arrays are not supported");
+          }
+          auto shape = GetHeaderField(header, "shape");
+          if(shape.empty() || shape[0] != '(') {
+            return Fail("missing shape");
+          }
+          size_t dim = 0;
+          bool in_number = false;
+          for(auto ch : shape) {
+            if(ch >= '0' && ch <= '9') {
+              dim = dim * 10 + static_cast<size_t>(ch - '0');
+              in_number = true;
+            }
+            else if(in_number) {
+              shape_.push_back(dim);
+              dim = 0;
+              in_number = false;
+            }
+          }
+          return true;
+        }
+
+      public:
+        bool Open(const std::string& filename) {
+          filename_ = filename;
+          shape_.clear();
+          file_ = std::make_unique<maestro::MappedFile>(filename);
+          if(!file_->IsOpen()) {
+            return Fail(file_->GetError());
+          }
+
+          auto contents = file_->GetContents();
+          size_t data_offset = 0;
+          bool is_npy = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".npy") == 0;
+          if(is_npy && !ParseNpyHeader(contents, data_offset)) {
+            return false;
+          }
+
+          size_t num_bytes = contents.size() - data_offset;
+          if(num_bytes % sizeof(int16_t) != 0) {
+            return Fail("size is not a multiple of 2 bytes");
+          }
+          num_elements_ = num_bytes / sizeof(int16_t);
+          data_ = contents.data() + data_offset;
+          if(!is_npy) {
+            shape_.push_back(num_elements_);
+          }
+
+          size_t shape_elements = 1;
+          for(auto dim : shape_) {
+            shape_elements *= dim;
+          }
+          if(shape_elements != num_elements_) {
+            return Fail("holds " + std::to_string(num_elements_) + " elements but its shape has " + std::to_string(shape_elements));
+          }
+          return true;
+        }
+
+        // Fails with a message unless the tensor holds exactly num_elements values
+        bool CheckNumElements(size_t num_elements, const std::string& layout) {
+          if(num_elements_ != num_elements) {
+            return Fail("expected " + std::to_string(num_elements) + " elements (" + layout + "), got " + std::to_string(num_elements_));
+          }
+          return true;
+        }
+
+        size_t GetNumElements() const {
+          return num_elements_;
+        }
+
+        const std::vector<size_t>& GetShape() const {
+          return shape_;
+        }
+
+        int16_t Get(size_t idx) const {
+          int16_t value;
+          std::memcpy(&value, data_ + idx * sizeof(int16_t), sizeof(int16_t));
+          return value;
+        }
+    }; // End of class TensorFile
+
+  }; // End of namespace Util
+}; // End of namespace MAERI
+
+#endif
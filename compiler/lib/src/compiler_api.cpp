@@ -0,0 +1,69 @@
+/******************************************************************************
+Copyright (c) 2019 Georgia Instititue of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author: Hyoukjun Kwon (hyoukjun@gatech.edu)
+
+*******************************************************************************/
+
+#include "compiler_api.hpp"
+
+#include "switch_config.hpp"
+#include "vn_placement.hpp"
+#include "vmh_writer.hpp"
+
+namespace MAERI {
+  namespace Driver {
+
+    CompileResult Compile(const AcceleratorParams& params, const VNLayout& layout, std::shared_ptr<maestro::LoopInfoTable> loopInfoTable) {
+      CompileResult ret;
+
+      auto leaves = layout.non_uniform_?
+                    ReductionNetwork::VNPlacement::PlaceNonUniform(params.num_mult_switches_, layout.vn_sizes_) :
+                    ReductionNetwork::VNPlacement::Place(params.num_mult_switches_, layout.vn_size_, layout.vn_num_, false);
+      if(!leaves.valid_) {
+        return ret;
+      }
+
+      ReductionNetwork::RNConfig rn_config;
+      if(!GenerateRNConfig(params.rn_generator_, params.num_mult_switches_, leaves, rn_config)) {
+        return ret;
+      }
+
+      if(!CheckLayerLoops(loopInfoTable, "(in-memory)")) {
+        return ret;
+      }
+
+      MachineCodeGenerator::RNConfigEncoder rnConfigEncoder;
+      int num_words = rnConfigEncoder.GetNumRNConfigWords(rn_config);
+      for(int word = 0; word < num_words; word++) {
+        ret.rn_config_words_.push_back(rnConfigEncoder.GetRNConfigWordBits(rn_config, word));
+      }
+      ret.output_buff_valid_ = rn_config.output_buff_valid_;
+
+      MachineCodeGenerator::TileInfoEncoder tileInfoEncoder;
+      ret.tile_info_words_ = tileInfoEncoder.GetTileInfoWordBits(loopInfoTable, params.num_mult_switches_, layout.vn_size_, layout.vn_num_);
+
+      ret.success_ = true;
+      return ret;
+    }
+
+  }; // End of namespace Driver
+}; // End of namespace MAERI
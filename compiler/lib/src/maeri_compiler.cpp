@@ -21,56 +21,362 @@ Update (July 2021): Yangyu Chen (yangyuchen@gatech.edu)
 
 *******************************************************************************/
 
-#include "abstract_reduction_network.hpp"
+#define MAERI_INSTALL_ALLOCATION_COUNTER
+#include "allocation_counter.hpp"
+
 #include <memory>
+#include <thread>
+#include <filesystem>
 
 #include<iostream>
 #include<string>
 #include<cstdlib>
 
-#include "analysis-structure.hpp"
+#include <boost/program_options.hpp>
+
+#include "compile_job.hpp"
+#include "batch_compiler.hpp"
+#include "network_compiler.hpp"
+#include "design_space_explorer.hpp"
+#include "rn_config_cache.hpp"
 #include "parser.hpp"
-#include "vmh_writer.hpp"
+#include "cycle_model.hpp"
+#include "tile_autotuner.hpp"
+#include "config_image.hpp"
+#include "cycle_simulator.hpp"
+#include "functional_model.hpp"
+#include "data_image_writer.hpp"
+
+namespace po = boost::program_options;
+
+void PrintUsage(po::options_description& options) {
+  std::cout << "Usage: ./(ExeFile) (NumMultSwitches) (VNSize) (VNNum) (NonUniform) (LayerFileName) [options]" << std::endl;
+  std::cout << "       ./(ExeFile) --batch (ManifestFile) [options]" << std::endl;
+  std::cout << "       ./(ExeFile) --network (NetworkFile) [options]" << std::endl;
+  std::cout << "       ./(ExeFile) --dse (SpecFile) [options]" << std::endl;
+  std::cout << "       ./(ExeFile) --pack-config (ImageFile) (OutputDir)..." << std::endl;
+  std::cout << "       ./(ExeFile) --unpack-config (ImageFile) (OutputDir)" << std::endl;
+  std::cout << "       ./(ExeFile) --simulate (OutputDir) [options]" << std::endl;
+  std::cout << "       ./(ExeFile) --verify (OutputDir) [options]" << std::endl;
+  std::cout << "       ./(ExeFile) --gen-data (OutputDir) --weights (TensorFile)... --inputs (TensorFile)... [options]" << std::endl;
+  std::cout << options << std::endl;
+}
 
 int main(int argc, char* argv[]) {
+  std::string rn_generator;
+  std::string manifest;
+  std::string network;
+  std::string dse_spec;
+  std::string dse_output;
+  std::string tuned_layer;
+  std::string cache_dir;
+  std::string pack_image;
+  std::string unpack_image;
+  std::string simulate_dir;
+  std::string verify_dir;
+  unsigned verify_seed;
+  std::string simd;
+  std::string data_dir;
+  std::vector<std::string> weight_files;
+  std::vector<std::string> input_files;
+  int num_threads;
+  int distribution_bandwidth;
+  int collection_bandwidth;
 
-  if(argc != 6) {
-    std::cout << "Usage: ./(ExeFile) (NumMultSwitches) (VNSize) (VNNum) (NonUniform) (LayerFileName)" << std::endl;
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "print this message")
+    ("rn-generator", po::value<std::string>(&rn_generator)->default_value("simulation"),
+     "RN config generator: simulation, closed-form, or check (run both and compare)")
+    ("batch", po::value<std::string>(&manifest),
+     "compile every job of a manifest; one job per line: NumMultSwitches VNSize VNNum NonUniform LayerFile OutputDir [VNSizesFile]")
+    ("network", po::value<std::string>(&network),
+     "compile every layer of a network into multi-layer Layer_Info.vmh and RN_Config.vmh images, for hardware with MaxLayers of at least the layer count in AcceleratorConfig.bsv; lines: NumMultSwitches N, then LayerFile VNSize VNNum NonUniform [VNSizesFile] per layer")
+    ("dse", po::value<std::string>(&dse_spec),
+     "sweep accelerator parameters and VN mappings with the cycle model; spec lines: MultSwitches N..., DistributionBandwidth B..., CollectionBandwidth B..., [VNSizes S...], Layer LayerFile")
+    ("dse-output", po::value<std::string>(&dse_output)->default_value("pareto_front.csv"),
+     "CSV file receiving the Pareto front of cycles vs. multipliers vs. bandwidth")
+    ("jobs,j", po::value<int>(&num_threads)->default_value(static_cast<int>(std::thread::hardware_concurrency())),
+     "number of worker threads in batch, network and DSE modes")
+    ("cache-dir", po::value<std::string>(&cache_dir),
+     "reuse RN configs stored in this directory and store newly compiled ones")
+    ("compress-rn-config",
+     "also write the RN config dictionary-compressed, as RN_Config_Dict.vmh and RN_Config_Index.vmh, for hardware built with RN_CONFIG_COMPRESSED")
+    ("optimize-placement",
+     "reorder non-uniform VNs to maximize active multiplier switches; the chosen order is written to optimized_VN_sizes.txt, and the compile fails if some VN cannot be placed")
+    ("count-allocations",
+     "print the heap allocations of the RN config generator")
+    ("estimate-cycles",
+     "predict the Testbench_MAERI runtime of the layer with the analytical cycle model (uniform VNs only)")
+    ("autotune",
+     "choose the layer's tile sizes and the VN size and count with the fewest predicted cycles, overriding VNSize and VNNum; the tuned layer file is compiled")
+    ("tuned-layer", po::value<std::string>(&tuned_layer)->default_value("autotuned_layer.m"),
+     "layer file receiving the tile sizes chosen by --autotune")
+    ("distribution-bandwidth", po::value<int>(&distribution_bandwidth)->default_value(16),
+     "DistributionBandwidth of the accelerator, for --estimate-cycles, --autotune and --simulate")
+    ("collection-bandwidth", po::value<int>(&collection_bandwidth)->default_value(16),
+     "CollectionBandwidth of the accelerator, for --estimate-cycles, --autotune and --simulate")
+    ("pack-config", po::value<std::string>(&pack_image),
+     "pack the RN_Config.vmh, outputBuffValid.vmh and Layer_Info.vmh of every given output directory into one binary configuration image")
+    ("unpack-config", po::value<std::string>(&unpack_image),
+     "convert every entry of a binary configuration image back to VMH files, written to entry_<i> under the given output directory")
+    ("simulate", po::value<std::string>(&simulate_dir),
+     "run the RN_Config.vmh and Layer_Info.vmh of an output directory on the cycle-level simulator and print the Testbench_MAERI statistics; NumMultSwitches comes from Layer_Info.vmh")
+    ("verify", po::value<std::string>(&verify_dir),
+     "run random INT16 tensors through the RN_Config.vmh and Layer_Info.vmh of an output directory on the functional model and compare every output with a direct convolution")
+    ("seed", po::value<unsigned>(&verify_seed)->default_value(1),
+     "seed of the random tensors of --verify without --weights and --inputs; layer i uses seed + i")
+    ("simd", po::value<std::string>(&simd)->default_value("auto"),
+     "adder kernels of the --verify reduction-tree evaluator: auto, avx512, avx2 or scalar")
+    ("weights", po::value<std::vector<std::string>>(&weight_files)->composing(),
+     "INT16 weights (.npy or raw) of a layer as [K][C][R][S] of the lowered layer; give one per layer, for --gen-data and --verify")
+    ("inputs", po::value<std::vector<std::string>>(&input_files)->composing(),
+     "INT16 inputs (.npy or raw) of a layer as [C][Y][X] ([K][Y][X] for depthwise layers); give one per layer, for --gen-data and --verify")
+    ("gen-data", po::value<std::string>(&data_dir),
+     "write Weight_Data.vmh and Input_Data.vmh into an output directory: the --weights and --inputs of its Layer_Info.vmh layers in Testbench_MAERI's DN injection order, for hardware built with TESTBENCH_DATA_IMAGES");
+
+  po::options_description positional_args;
+  positional_args.add_options()
+    ("args", po::value<std::vector<std::string>>(), "positional arguments");
+
+  po::options_description all_args;
+  all_args.add(options).add(positional_args);
+
+  po::positional_options_description positional;
+  positional.add("args", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(all_args).positional(positional).run(), vm);
+    po::notify(vm);
+  }
+  catch(po::error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    PrintUsage(options);
+    return 1;
+  }
+
+  MAERI::Driver::RNGenerator generator;
+  if(!MAERI::Driver::ParseRNGenerator(rn_generator, generator)) {
+    std::cerr << "ERROR: Unknown RN generator " << rn_generator << std::endl;
+    return 1;
+  }
+
+  std::shared_ptr<MAERI::Driver::RNConfigCache> cache;
+  if(vm.count("cache-dir")) {
+    cache = std::make_shared<MAERI::Driver::RNConfigCache>(cache_dir);
+  }
+
+  if(vm.count("dse")) {
+    MAERI::Driver::DesignSpaceExplorer explorer;
+    if(!explorer.ReadSpec(dse_spec) || !explorer.ParseLayers()) {
+      return 1;
+    }
+    int num_points = explorer.Run(num_threads);
+    std::cout << "Evaluated " << num_points << " accelerator configurations, " << explorer.GetNumFeasiblePoints() << " can map every layer" << std::endl;
+    if(!explorer.WriteParetoFront(dse_output)) {
+      return 1;
+    }
+    std::cout << "Pareto front written to " << dse_output << std::endl;
     return 0;
   }
 
-  int numMultSwitches = atoi(argv[1]);
-  int vn_size = atoi(argv[2]);
-  int num_mapped_vns = atoi(argv[3]);
-  bool non_uniform = atoi(argv[4]) == 0 ? false : true;
+  if(vm.count("network")) {
+    MAERI::Driver::NetworkCompiler networkCompiler;
+    if(!networkCompiler.ReadNetwork(network) || !networkCompiler.Run(generator, num_threads, cache, vm.count("optimize-placement") > 0, vm.count("compress-rn-config") > 0)) {
+      return 1;
+    }
+    std::cout << "Linked " << networkCompiler.GetNumLayers() << " layers into Layer_Info.vmh and RN_Config.vmh" << std::endl;
+    return 0;
+  }
 
-  auto ars = std::make_shared<MAERI::ReductionNetwork::AbstractReductionNetwork>(numMultSwitches, vn_size, num_mapped_vns, non_uniform);
+  if(vm.count("batch")) {
+    MAERI::Driver::BatchCompiler batchCompiler;
+    if(!batchCompiler.ReadManifest(manifest)) {
+      return 1;
+    }
+    int num_failed = batchCompiler.Run(generator, num_threads, cache, vm.count("optimize-placement") > 0, vm.count("compress-rn-config") > 0);
+    std::cout << "Compiled " << batchCompiler.GetNumJobs() - num_failed << " of " << batchCompiler.GetNumJobs() << " jobs" << std::endl;
+    if(cache != nullptr) {
+      std::cout << "RN config cache: " << cache->GetNumHits() << " hits, " << cache->GetNumMisses() << " misses" << std::endl;
+    }
+    return (num_failed == 0)? 0 : 1;
+  }
 
-  MAERI::MachineCodeGenerator::RNConfigWriter outputFileWriter("RN_Config.vmh");
+  std::vector<std::string> args;
+  if(vm.count("args")) {
+    args = vm["args"].as<std::vector<std::string>>();
+  }
+
+  if(vm.count("pack-config")) {
+    MAERI::MachineCodeGenerator::ConfigImageWriter imageWriter;
+    for(auto& dir : args) {
+      std::string outputBuffValidFile = std::filesystem::exists(dir + "/outputBuffValid.vmh")? dir + "/outputBuffValid.vmh" : "";
+      if(!imageWriter.AddVmhFiles(dir + "/RN_Config.vmh", outputBuffValidFile, dir + "/Layer_Info.vmh")) {
+        return 1;
+      }
+    }
+    if(!imageWriter.Write(pack_image)) {
+      return 1;
+    }
+    std::cout << "Packed " << imageWriter.GetNumEntries() << " configurations into " << pack_image << std::endl;
+    return 0;
+  }
+
+  if(vm.count("unpack-config")) {
+    if(args.size() != 1) {
+      std::cerr << "ERROR: --unpack-config takes one output directory" << std::endl;
+      return 1;
+    }
+    MAERI::MachineCodeGenerator::ConfigImage image(unpack_image);
+    if(!image.IsValid()) {
+      return 1;
+    }
+    for(int idx = 0; idx < image.GetNumEntries(); idx++) {
+      std::string dir = args[0] + "/entry_" + std::to_string(idx);
+      std::error_code ec;
+      std::filesystem::create_directories(dir, ec);
+      if(ec || !image.GetEntry(idx).WriteVmhFiles(dir + "/RN_Config.vmh", dir + "/outputBuffValid.vmh", dir + "/Layer_Info.vmh")) {
+        std::cerr << "ERROR: Failed to unpack entry " << idx << " into " << dir << std::endl;
+        return 1;
+      }
+    }
+    std::cout << "Unpacked " << image.GetNumEntries() << " configurations into " << args[0] << std::endl;
+    return 0;
+  }
+
+  if(vm.count("simulate")) {
+    MAERI::PerformanceModel::CycleSimulator simulator(distribution_bandwidth, collection_bandwidth);
+    if(!simulator.Load(simulate_dir + "/RN_Config.vmh", simulate_dir + "/Layer_Info.vmh")) {
+      return 1;
+    }
+    std::cout << "Simulating " << simulator.GetNumLayers() << " layer(s) on " << simulator.GetNumMultSwitches() << " multiplier switches" << std::endl;
+    auto stats = simulator.Run(std::cout);
+    if(!stats.valid_) {
+      return 1;
+    }
+    stats.Print(std::cout);
+    return 0;
+  }
 
-  ars->ProcessAbstractReductionNetwork();
-  //ars->PrintConfig();
-  ars->PrintConfig_Inorder();
+  if(vm.count("verify") || vm.count("gen-data")) {
+    std::string dir = vm.count("verify")? verify_dir : data_dir;
+    MAERI::PerformanceModel::CompiledConfig compiled;
+    if(!compiled.Load(dir + "/RN_Config.vmh", dir + "/Layer_Info.vmh")) {
+      return 1;
+    }
+    int num_layers = static_cast<int>(compiled.layers_.size());
+    bool has_tensors = !weight_files.empty() || !input_files.empty();
+    if((has_tensors || vm.count("gen-data")) && (static_cast<int>(weight_files.size()) != num_layers || static_cast<int>(input_files.size()) != num_layers)) {
+      std::cerr << "ERROR: " << dir << " holds " << num_layers << " layer(s); give one --weights and one --inputs per layer" << std::endl;
+      return 1;
+    }
 
-  auto dbrsConfig = ars->GetDBRS_Switches();
-  auto mapping_DBRS = ars->GetDBRS_Inorder_Map();
+    if(vm.count("gen-data")) {
+      MAERI::MachineCodeGenerator::DataImageGenerator generator(data_dir + "/Weight_Data.vmh", data_dir + "/Input_Data.vmh",
+                                                                compiled.num_mult_switches_, distribution_bandwidth);
+      for(int layer = 0; layer < num_layers; layer++) {
+        MAERI::Util::TensorFile weights, inputs;
+        if(!weights.Open(weight_files[layer]) || !inputs.Open(input_files[layer])
+           || !generator.WriteLayer(compiled.layers_[layer], weights, inputs)) {
+          std::cerr << "ERROR: Failed to generate the data images of layer " << layer << std::endl;
+          return 1;
+        }
+      }
+      std::cout << "Wrote " << generator.GetNumWeightBeats() << " weight beats and " << generator.GetNumInputBeats()
+                << " input beats of " << num_layers << " layer(s) into " << data_dir << std::endl;
+      return 0;
+    }
 
-  auto sgrsConfig = ars->GetSGRS_Switches();
-  auto mapping_SGRS = ars->GetSGRS_Inorder_Map();
+    if(!MAERI::PerformanceModel::LaneAdder::SelectIsa(simd)) {
+      std::cerr << "ERROR: --simd " << simd << " is unknown or not supported by this CPU" << std::endl;
+      return 1;
+    }
+    MAERI::PerformanceModel::FunctionalModel model(compiled);
+    bool passed = true;
+    for(int layer = 0; layer < num_layers; layer++) {
+      MAERI::PerformanceModel::LayerTensors tensors(compiled.layers_[layer]);
+      if(has_tensors) {
+        MAERI::Util::TensorFile weights, inputs;
+        if(!weights.Open(weight_files[layer]) || !inputs.Open(input_files[layer]) || !tensors.Load(weights, inputs)) {
+          return 1;
+        }
+      }
+      else {
+        tensors.Randomize(verify_seed + layer);
+      }
+      passed = model.VerifyLayer(layer, tensors, std::cout) && passed;
+    }
+    if(!passed) {
+      return 1;
+    }
+    std::cout << "Verified " << num_layers << " layer(s)" << std::endl;
+    return 0;
+  }
 
-  int numLvs = static_cast<int>(log2(numMultSwitches));
-  int num_adder_switches = numMultSwitches - 1;
-  outputFileWriter.WriteVN_Config(dbrsConfig, sgrsConfig, mapping_DBRS, mapping_SGRS, numLvs, num_adder_switches);
+  if(vm.count("help") || args.size() != 5) {
+    PrintUsage(options);
+    return 0;
+  }
 
-  maestro::LayerParser layerParser(argv[5]);
+  int numMultSwitches = atoi(args[0].c_str());
+  int vn_size = atoi(args[1].c_str());
+  int num_mapped_vns = atoi(args[2].c_str());
+  bool non_uniform = atoi(args[3].c_str()) == 0 ? false : true;
+  std::string layer_file = args[4];
 
-  auto layerInfo = layerParser.ParseLayer();
-  std::cout << "Parse finished" << std::endl;
-  MAERI::MachineCodeGenerator::TileInfoWriter tileInfoWriter("Layer_Info.vmh");
+  if(vm.count("autotune")) {
+    if(non_uniform) {
+      std::cerr << "ERROR: The autotuner only produces uniform VN layouts" << std::endl;
+      return 1;
+    }
+    maestro::LayerParser layerParser(layer_file);
+    auto layerInfo = layerParser.ParseLayer();
+    if(!MAERI::Driver::CheckLayerLoops(layerInfo, layer_file)) {
+      return 1;
+    }
+    auto dims = MAERI::PerformanceModel::LayerDims::FromLoopInfoTable(layerInfo);
+    MAERI::PerformanceModel::TileAutotuner autotuner(MAERI::PerformanceModel::HardwareParams(numMultSwitches, distribution_bandwidth, collection_bandwidth));
+    auto result = autotuner.Tune(dims);
+    if(!result.valid_ || !autotuner.WriteLayerFile(tuned_layer, dims, result.tiles_)) {
+      return 1;
+    }
+    auto& tiles = result.tiles_;
+    std::cout << "Autotuner evaluated " << result.num_evaluated_ << " tilings; chose K " << tiles.k_ << ", C " << tiles.c_ << ", R " << tiles.r_
+              << ", S " << tiles.s_ << ", Y " << tiles.y_ << ", X " << tiles.x_ << " (VNSize " << result.vn_size_ << ", VNNum " << result.vn_num_ << ", "
+              << result.estimate_.total_cycles_ << " cycles), written to " << tuned_layer << std::endl;
 
-  std::cout << layerInfo->ToString() << std::endl;
+    vn_size = result.vn_size_;
+    num_mapped_vns = result.vn_num_;
+    layer_file = tuned_layer;
+  }
+
+  MAERI::Driver::CompileJob job(numMultSwitches, vn_size, num_mapped_vns, non_uniform, layer_file);
+  MAERI::Driver::CompileJobRunner runner(generator, true, cache, vm.count("optimize-placement") > 0, vm.count("compress-rn-config") > 0, vm.count("count-allocations") > 0);
 
-  tileInfoWriter.WriteTileInfo(layerInfo, numMultSwitches, vn_size, num_mapped_vns);
+  bool success = runner.Run(job);
+  if(cache != nullptr) {
+    std::cout << "RN config cache: " << cache->GetNumHits() << " hits, " << cache->GetNumMisses() << " misses" << std::endl;
+  }
 
-  return 0;
+  if(success && vm.count("estimate-cycles")) {
+    if(non_uniform) {
+      std::cerr << "ERROR: The cycle model only supports uniform VN layouts" << std::endl;
+      return 1;
+    }
+    maestro::LayerParser layerParser(layer_file);
+    MAERI::PerformanceModel::HardwareParams hw(numMultSwitches, distribution_bandwidth, collection_bandwidth);
+    MAERI::PerformanceModel::AnalyticalCycleModel model(hw);
+    auto layerInfo = layerParser.ParseLayer();
+    if(layerInfo == nullptr) {
+      return 1;
+    }
+    auto estimate = vm.count("autotune")? model.EstimateTiled(MAERI::PerformanceModel::LayerDims::FromLoopInfoTable(layerInfo), MAERI::PerformanceModel::LayerDims::TilesFromLoopInfoTable(layerInfo))
+                                        : model.Estimate(layerInfo, vn_size, num_mapped_vns);
+    if(!estimate.valid_) {
+      return 1;
+    }
+    estimate.Print();
+  }
+  return success? 0 : 1;
 }
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+# Expands RN_Config_Dict.vmh and RN_Config_Index.vmh (maeri_compiler
+# --compress-rn-config) the way CR_RN_ConfigurationMemory built with
+# RN_CONFIG_COMPRESSED does, and compares the words with RN_Config.vmh.
+# Usage: expand_rn_config.py [Directory]; exits nonzero on a difference.
+
+import os
+import sys
+
+INDICES_PER_WORD = 4
+
+
+# $readmemh image as {address: value}; "@" lines set the next address
+def read_vmh(filename):
+    memory = {}
+    address = 0
+    layer_addresses = []
+    with open(filename) as vmh:
+        for line in vmh:
+            line = line.strip()
+            if not line:
+                continue
+            if line.startswith("@"):
+                address = int(line[1:], 16)
+                layer_addresses.append(address)
+                continue
+            memory[address] = int(line, 16)
+            address += 1
+    return memory, layer_addresses
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else "."
+    rn_config, layer_addresses = read_vmh(os.path.join(directory, "RN_Config.vmh"))
+    dictionary, _ = read_vmh(os.path.join(directory, "RN_Config_Dict.vmh"))
+    indices, _ = read_vmh(os.path.join(directory, "RN_Config_Index.vmh"))
+
+    num_layers = len(layer_addresses)
+    if num_layers == 0 or len(indices) % num_layers != 0:
+        print("MISMATCH: %d index words do not split into %d layers" % (len(indices), num_layers))
+        return 1
+    index_words_per_layer = len(indices) // num_layers
+    layer_stride = layer_addresses[1] - layer_addresses[0] if num_layers > 1 else index_words_per_layer * INDICES_PER_WORD
+
+    if dictionary.get(0) != 0:
+        print("MISMATCH: dictionary entry 0 is not the zero word")
+        return 1
+
+    num_mismatches = 0
+    for layer in range(num_layers):
+        for word in range(index_words_per_layer * INDICES_PER_WORD):
+            index_word = indices[layer * index_words_per_layer + word // INDICES_PER_WORD]
+            entry = (index_word >> (8 * (word % INDICES_PER_WORD))) & 0xFF
+            if entry not in dictionary:
+                print("MISMATCH: layer %d word %d uses missing dictionary entry %d" % (layer, word, entry))
+                num_mismatches += 1
+                continue
+            # Indices past the layer stride pad the last index word and must be entry 0
+            expected = rn_config.get(layer * layer_stride + word, 0) if word < layer_stride else 0
+            if dictionary[entry] != expected:
+                print("MISMATCH: layer %d word %d expands to %x instead of %x" % (layer, word, dictionary[entry], expected))
+                num_mismatches += 1
+
+    num_words = sum(1 for address in rn_config if address < num_layers * layer_stride)
+    print("%d layers, %d RN config words, %d dictionary words, %d index words, %d mismatches"
+          % (num_layers, num_words, len(dictionary), len(indices), num_mismatches))
+    return 1 if num_mismatches else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())